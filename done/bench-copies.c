@@ -0,0 +1,105 @@
+/**
+ * @file bench-copies.c
+ * @brief bytes copied by the cache engine per access, on random word accesses
+ *        (one write in four) to write-through and write-back hierarchies of 2 and 3 levels.
+ *        Built with -DCACHE_COUNT_COPIES : make bench-copies, then ./bench-copies [ACCESSES [SEED]]
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "error.h"
+#include "cache_mng.h"
+
+#include <inttypes.h> // for PRIu64
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MEM_BYTES (1u << 22) // 4 MiB of memory : random accesses miss the 64 KiB L2, not the 1 MiB L3
+#define L3_LINES 4096u // 1 MiB L3 of 16 bytes lines
+#define L3_WAYS  16u
+
+//=========================================================================
+/**
+ * @brief run one configuration, return its bytes copied per access (negative on error)
+ */
+static double run(void* mem_space, size_t accesses, unsigned seed, int levels, cache_write_t write, double* seconds)
+{
+    cache_desc_t l1_desc, l2_desc, l3_desc;
+    if (cache_desc_preset(&l1_desc, L1_DCACHE) != ERR_NONE || cache_desc_preset(&l2_desc, L2_CACHE) != ERR_NONE
+        || cache_desc_init(&l3_desc, L3_LINES, L3_WAYS, L1_DCACHE_LINE, LRU) != ERR_NONE
+        || cache_desc_set_write(&l1_desc, write) != ERR_NONE || cache_desc_set_write(&l2_desc, write) != ERR_NONE
+        || cache_desc_set_write(&l3_desc, write) != ERR_NONE) return -1;
+
+    cache_store_t l1_icache, l1_dcache, l2_cache, l3_cache;
+    if (cache_init(&l1_icache, &l1_desc) != ERR_NONE || cache_init(&l1_dcache, &l1_desc) != ERR_NONE
+        || cache_init(&l2_cache, &l2_desc) != ERR_NONE || cache_init(&l3_cache, &l3_desc) != ERR_NONE) return -1;
+    cache_hrchy_t hrchy;
+    if (levels == 3 && (cache_hrchy_init(&hrchy) != ERR_NONE
+                        || cache_hrchy_add_level(&hrchy, &l1_icache, &l1_dcache) != ERR_NONE
+                        || cache_hrchy_add_level(&hrchy, &l2_cache, &l2_cache) != ERR_NONE
+                        || cache_hrchy_add_level(&hrchy, &l3_cache, &l3_cache) != ERR_NONE)) return -1;
+
+    srand(seed);
+    int err = ERR_NONE;
+    uint64_t copied = cache_copied_bytes();
+    clock_t start = clock();
+    for (size_t a = 0; a < accesses && err == ERR_NONE; a++) {
+        uint32_t addr = (uint32_t) (rand() % (MEM_BYTES / sizeof(word_t))) * (uint32_t) sizeof(word_t);
+        phy_addr_t paddr = { .phy_page_num = addr >> PAGE_OFFSET, .page_offset = addr & ((1u << PAGE_OFFSET) - 1) };
+        uint32_t word = (uint32_t) rand();
+        int store = rand() % 4 == 0;
+        if (levels == 3) {
+            err = store ? cache_hrchy_write(mem_space, &hrchy, &paddr, &word)
+                  : cache_hrchy_read(mem_space, &hrchy, &paddr, DATA, &word);
+        } else {
+            err = store ? cache_write(mem_space, &paddr, &l1_dcache, &l2_cache, &word, LRU)
+                  : cache_read(mem_space, &paddr, DATA, &l1_dcache, &l2_cache, &word, LRU);
+        }
+    }
+    *seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    copied = cache_copied_bytes() - copied;
+
+    cache_free(&l1_icache);
+    cache_free(&l1_dcache);
+    cache_free(&l2_cache);
+    cache_free(&l3_cache);
+    return err == ERR_NONE ? (double) copied / (double) accesses : -1;
+}
+
+//=========================================================================
+int main(int argc, char* argv[])
+{
+    size_t accesses = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000000;
+    unsigned seed = argc > 2 ? (unsigned) strtoul(argv[2], NULL, 10) : 1;
+    if (accesses == 0) {
+        fprintf(stderr, "usage: %s [ACCESSES [SEED]]\n", argv[0]);
+        return 1;
+    }
+    void* mem_space = calloc(MEM_BYTES, 1);
+    if (mem_space == NULL) {
+        fprintf(stderr, "cannot allocate %u bytes of memory\n", MEM_BYTES);
+        return 2;
+    }
+
+    printf("%zu random word accesses, 1 write in 4, seed %u\n", accesses, seed);
+    printf("%-24s %12s %10s\n", "hierarchy", "bytes/access", "seconds");
+    for (int levels = 2; levels <= 3; levels++) {
+        for (cache_write_t write = WRITE_THROUGH; write <= WRITE_BACK; write++) {
+            double seconds = 0;
+            double per_access = run(mem_space, accesses, seed, levels, write, &seconds);
+            if (per_access < 0) {
+                fprintf(stderr, "cannot run the %d levels hierarchy\n", levels);
+                free(mem_space);
+                return 3;
+            }
+            char name[32];
+            snprintf(name, sizeof(name), "%d levels, %s, %s", levels, levels == 2 ? "64 KiB" : "1 MiB",
+                     write == WRITE_THROUGH ? "WT" : "WB");
+            printf("%-24s %12.1f %10.2f\n", name, per_access, seconds);
+        }
+    }
+    free(mem_space);
+    return 0;
+}
@@ -2,7 +2,8 @@
 
 /**
  * @file cache.h
- * @brief definitions associated to a a two-level hierarchy of cache memories
+ * @brief definitions associated to a hierarchy of cache memories (L1 and L2 by default,
+ *        up to CACHE_MAX_LEVELS levels), whose geometry is given at runtime
  *
  * @author Mirjana Stojilovic
  * @date 2018-19
@@ -10,25 +11,36 @@
 
 #include "addr.h" // for word_t
 #include <stdint.h>
+#include <stddef.h> // for size_t
 
+/*
+ * Fixed configurations, used as the presets of the descriptors below
+ * (cache_desc_preset()) for which the compiler specialises the code.
+ */
 #define L1_ICACHE_WORDS_PER_LINE 4
 #define L1_ICACHE_LINE   16u // 16 bytes (4 words) per line
+#define L1_ICACHE_LINE_BITS 4 // log_2(L1_ICACHE_LINE)
 #define L1_ICACHE_WAYS   4u
 #define L1_ICACHE_LINES  64u  // Do not modify this!
+#define L1_ICACHE_LINES_BITS 6 // log_2(L1_ICACHE_LINES)
 #define L1_ICACHE_TAG_REMAINING_BITS   10 // 2(select byte) + 2(select word) + 6(select line)
 #define L1_ICACHE_TAG_BITS             22 // 32 - L1_ICACHE_TAG_REMAINING_BITS
 
 #define L1_DCACHE_WORDS_PER_LINE L1_ICACHE_WORDS_PER_LINE
 #define L1_DCACHE_LINE   L1_ICACHE_LINE
+#define L1_DCACHE_LINE_BITS L1_ICACHE_LINE_BITS
 #define L1_DCACHE_WAYS   L1_ICACHE_WAYS
 #define L1_DCACHE_LINES  L1_ICACHE_LINES
+#define L1_DCACHE_LINES_BITS L1_ICACHE_LINES_BITS
 #define L1_DCACHE_TAG_REMAINING_BITS L1_ICACHE_TAG_REMAINING_BITS
 #define L1_DCACHE_TAG_BITS           L1_ICACHE_TAG_BITS
 
 #define L2_CACHE_WORDS_PER_LINE L1_ICACHE_WORDS_PER_LINE
 #define L2_CACHE_LINE   L1_ICACHE_LINE
+#define L2_CACHE_LINE_BITS L1_ICACHE_LINE_BITS
 #define L2_CACHE_WAYS   8u
 #define L2_CACHE_LINES  512u  // Do not modify this!
+#define L2_CACHE_LINES_BITS 9 // log_2(L2_CACHE_LINES)
 #define L2_CACHE_TAG_REMAINING_BITS   13 // 2(select byte) + 2(select word) + 9(select line)
 #define L2_CACHE_TAG_BITS             19 // 32 - L1_ICACHE_TAG_REMAINING_BITS
 
@@ -40,7 +52,7 @@
  *  - 4 words/way, where word = 4 bytes (=> 128 bits/way)
  *  - 64 sets (= 64 blocks per way) (= 6 bits to index)
  *  - total capacity = 4kiB
- *  - write-through policy (no dirty bit)
+ *  - write-through policy (write-back with a dirty bit per line, see cache_write_t)
  *  - write-allocate on write miss
  *
  * L2 CACHE:
@@ -50,7 +62,7 @@
  *  - 4 words/way, where word = 4 bytes (=> 128 bits/way)
  *  - 512 sets (= 512 blocks per way) (= 9 bits to index)
  *  - total capacity = 64kiB
- *  - write-through policy (no dirty bit)
+ *  - write-through policy (write-back with a dirty bit per line, see cache_write_t)
  *  - write-allocate on write miss
  *
  *  Exclusive policy (https://en.wikipedia.org/wiki/Cache_inclusion_policy)
@@ -69,59 +81,539 @@
 
 
 
-// --------------------------------------------------
-#define cache_cast(TYPE) ((TYPE *)cache)
+/*
+ * enum that represents the different types of caches
+ */
+typedef enum {
+	L1_ICACHE, L1_DCACHE,L2_CACHE
+	} cache_t;
 
-// --------------------------------------------------
-#define cache_entry(TYPE, WAYS, LINE_INDEX, WAY) \
-        (cache_cast(TYPE) + (LINE_INDEX) * (WAYS) + (WAY))
+#define CACHE_NB (L2_CACHE + 1) // number of cache types (and of presets)
 
-// --------------------------------------------------
-#define cache_valid(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->v
+/*
+ * replacement policies (see replacement.h), with their state :
+ *  - LRU       : age of each way in the set, from 0 (most recently used) to ways - 1
+ *  - TREE_PLRU : binary tree of ways - 1 bits per set pointing to the victim (ways must be a power of 2)
+ *  - BIT_PLRU  : one "recently used" bit per way, cleared when all of them are set
+ *  - FIFO      : insertion order of each way (hits do not change it)
+ *  - RANDOM    : no state, victims drawn from the seed of the cache (see cache_set_seed())
+ *  - SRRIP     : 2 bits re-reference prediction value per way, lines inserted with a long prediction
+ *  - BRRIP     : as SRRIP, but lines mostly inserted with a distant prediction (scan resistant)
+ *  - LFU       : saturating count of the accesses to each way
+ */
+enum cache_replacement_policy { LRU, TREE_PLRU, BIT_PLRU, FIFO, RANDOM, SRRIP, BRRIP, LFU };
+typedef enum cache_replacement_policy cache_replace_t;
 
-// --------------------------------------------------
-#define cache_age(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->age
+#define CACHE_REPLACE_NB (LFU + 1) // number of replacement policies
 
-// --------------------------------------------------
-#define cache_tag(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->tag
+/*
+ * write policies :
+ *  - WRITE_THROUGH : every store is also written to memory
+ *  - WRITE_BACK    : stores only set the dirty bit of the line, memory is written
+ *                    when a dirty line leaves the hierarchy (evicted from the last level)
+ *                    or by cache_writeback_all()
+ */
+typedef enum {
+	WRITE_THROUGH, WRITE_BACK
+	} cache_write_t;
 
-// --------------------------------------------------
-#define cache_line(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->line
-// --------------------------------------------------
+/*
+ * write-miss policies :
+ *  - WRITE_ALLOCATE    : the line is read from memory and inserted in L1, then written
+ *  - NO_WRITE_ALLOCATE : the store goes around the caches, directly to memory
+ *                        (streaming stores do not evict the lines in use)
+ */
+typedef enum {
+	WRITE_ALLOCATE, NO_WRITE_ALLOCATE
+	} cache_alloc_t;
+
+/*
+ * coherence actions on the copies of a line held by a cache (see cache_snoop()) :
+ *  - SNOOP_PROBE   : only look the line up
+ *  - SNOOP_CLEAN   : write a dirty copy back to memory, the copy staying valid (M -> S)
+ *  - SNOOP_FLUSH   : write a dirty copy back to memory, then invalidate the copies (M -> I)
+ *  - SNOOP_DISCARD : invalidate the copies without writing them back (stale copies)
+ */
+typedef enum {
+	SNOOP_PROBE, SNOOP_CLEAN, SNOOP_FLUSH, SNOOP_DISCARD
+	} cache_snoop_t;
+
+/*
+ * Limits of a cache configured at runtime
+ */
+#define CACHE_MAX_LINES      32768u // line indexes are stored on 16 bits (HIT_INDEX_MISS excluded)
+#define CACHE_MAX_WAYS       128u   // ways and ages are stored on 8 bits (HIT_WAY_MISS excluded)
+#define CACHE_MAX_LINE_BYTES 256u
+#define CACHE_MAX_WORDS_PER_LINE (CACHE_MAX_LINE_BYTES / sizeof(word_t))
+#define CACHE_MAX_SECTORS    8u     // the sectors of a line are a mask stored on 8 bits
 
 /*
- * struct that reprensents an entry in the L1_ICACHE
+ * Geometry of a cache configured at runtime :
+ *  - lines              : number of sets (power of 2)
+ *  - ways               : associativity (1 = direct mapped)
+ *  - line_bytes         : size of a line in bytes (power of 2, at least one word)
+ *  - replace            : replacement policy
+ *  - write              : write policy (WRITE_THROUGH by default)
+ *  - alloc              : write-miss policy (WRITE_ALLOCATE by default)
+ *  - sectors            : sectors per line (1 by default : the line is not sectored, see cache_desc_set_sectors())
+ *  - words_per_line     : line_bytes / sizeof(word_t), derived
+ *  - line_bits          : log_2(line_bytes) (select word + select byte), derived
+ *  - lines_bits         : log_2(lines) (select line), derived
+ *  - tag_remaining_bits : line_bits + lines_bits, derived
+ *  - tag_bits           : 32 - tag_remaining_bits, derived
+ *  - set_words          : words of metadata per set, derived from ways, replace and sectors (see cache_store_t)
+ *  - age_bits           : bits of the age of a way, derived from ways and replace (see cache_age_bits())
+ *  - age_chunk          : ways whose ages fit in 32 bits, read or written at once (see cache_ages_load()), derived
+ *  - age_lanes          : bit 0 of the ages of the even ways of such a chunk (see cache_ages_bump()), derived
+ *  - dirty_bit, sector_bit, age_bit, state_bit : first bit of the dirty bits, valid sector masks,
+ *                         ages and state of the bits of a set (see cache_store_t), derived
  */
 typedef struct {
-	uint8_t v    : 1;
-	uint8_t age  : 2;
-	uint32_t tag : L1_ICACHE_TAG_BITS;
-	word_t line[L1_ICACHE_WORDS_PER_LINE];
-	 }l1_icache_entry_t;
+	uint32_t lines;
+	uint32_t ways;
+	uint32_t line_bytes;
+	cache_replace_t replace;
+	cache_write_t write;
+	cache_alloc_t alloc;
+	uint32_t sectors;
+	uint32_t words_per_line;
+	uint8_t line_bits;
+	uint8_t lines_bits;
+	uint8_t tag_remaining_bits;
+	uint8_t tag_bits;
+	uint32_t set_words;
+	uint8_t age_bits;
+	uint8_t age_chunk;
+	uint32_t age_lanes;
+	uint16_t dirty_bit;
+	uint16_t sector_bit;
+	uint16_t age_bit;
+	uint16_t state_bit;
+	} cache_desc_t;
+
 /*
- * L1_ICACHE for testing
+ * Entry of a cache configured at runtime, as exchanged with cache_insert() and
+ * cache_entry_init() : only the words_per_line first words of line are used.
+ * A cache does not store its entries as such (see cache_store_t).
  */
- typedef l1_icache_entry_t l1_icache[L1_ICACHE_LINES*L1_ICACHE_WAYS];
+typedef struct {
+	uint8_t v;
+	uint8_t age;
+	uint8_t dirty;
+	uint32_t tag;
+	word_t line[CACHE_MAX_WORDS_PER_LINE];
+	} cache_entry_t;
+
+#define CACHE_NO_PRESET (-1)
+#define NOTHING_FOUND (-1)   // no way found (no empty way, no victim)
+#define CACHE_PREFETCHED 2u  // valid state of a prefetched line not used yet by a demand access (see prefetch.h)
+#define CACHE_ALIGN 64u // size of a host cache line
+
 /*
- * struct that reprensents an entry in the L1_DCACHE
+ * Set of ways of a cache, one bit per way (see partition.h)
  */
-typedef l1_icache_entry_t l1_dcache_entry_t;
+typedef struct {
+	uint64_t bits[CACHE_MAX_WAYS / 64];
+	} cache_way_mask_t;
+
+#define cache_way_in(mask, way) (((mask)->bits[(way) / 64] >> ((way) % 64)) & 1u)
+
 /*
- * struct that represents an entry in the L2_CACHE
+ * Memory traffic of a cache, in lines :
+ *  - mem_reads  : lines read from memory into the cache (fills)
+ *  - mem_writes : stores sent to memory by the cache (write-through and write-around stores, write-backs),
+ *                 possibly merged by a write buffer
+ *  - writebacks : dirty lines written back (evictions and cache_writeback_all())
  */
 typedef struct {
-	uint8_t v    : 1;
-	uint8_t age  : 3;
-	uint32_t tag : L2_CACHE_TAG_BITS;
-	word_t line[L2_CACHE_WORDS_PER_LINE];
-	} l2_cache_entry_t;
+	uint64_t mem_reads;
+	uint64_t mem_writes;
+	uint64_t writebacks;
+	} cache_counters_t;
+
 /*
- * enum that represents the different types of caches
+ * Block accesses starting at a cache (see cache_read_block(), cache_write_block()) :
+ *  - reads, writes : block reads and writes
+ *  - bytes         : bytes they accessed
+ *  - lines         : lines they accessed (one lookup of the hierarchy each)
+ */
+typedef struct {
+	uint64_t reads;
+	uint64_t writes;
+	uint64_t bytes;
+	uint64_t lines;
+	} cache_block_counters_t;
+
+/*
+ * Activity of a cache that depends on the inclusion policy of its hierarchy (see cache_inclusion_t) :
+ *  - fills              : lines placed in the cache (from memory, or from another level)
+ *  - evictions          : valid lines replaced in the cache
+ *  - back_invalidations : copies invalidated in the cache because a level below evicted them (inclusive)
+ *  - victim_fills       : lines placed in the cache because the level above evicted them (exclusive)
+ *  - promotions         : lines found in the cache and moved to L1, leaving the cache (exclusive)
+ *  - copies             : lines found in the cache and copied into the levels above, staying in the cache (inclusive, NINE)
+ */
+typedef struct {
+	uint64_t fills;
+	uint64_t evictions;
+	uint64_t back_invalidations;
+	uint64_t victim_fills;
+	uint64_t promotions;
+	uint64_t copies;
+	} cache_inclusion_counters_t;
+
+/*
+ * Activity of a sectored cache (see cache_desc_set_sectors()), in sectors :
+ *  - misses     : accesses finding their line in the cache, but not all the sectors they need
+ *  - reads      : sectors read from memory into the cache (misses of their line, then of the sectors themselves)
+ *  - writebacks : dirty sectors written back, only they being written to memory
+ */
+typedef struct {
+	uint64_t misses;
+	uint64_t reads;
+	uint64_t writebacks;
+	} cache_sector_counters_t;
+
+struct write_buffer; // see write_buffer.h
+struct miss_class;   // see miss_class.h
+struct prefetcher;   // see prefetch.h
+struct timing;       // see timing.h
+struct victim_cache; // see victim_cache_t below
+struct mshr;         // see mshr.h
+struct way_partition; // see partition.h
+
+/*
+ * Cache configured at runtime, stored as a structure of arrays :
+ *  - desc   : its geometry
+ *  - preset : the cache_t whose fixed configuration is equal to desc
+ *             (specialised code is then used), CACHE_NO_PRESET otherwise
+ *  - meta   : metadata of the sets, cache_set_words(desc) words per set : the tags of its ways,
+ *             then the bits of the set (see cache_meta_bits()), packed from bit 0 of the next word :
+ *             a valid mask and a prefetched mask (a bit per way each), the dirty bits of the ways
+ *             (sectors bits per way : the mask of the dirty sectors of a sectored line), the masks of
+ *             the valid sectors of their lines (sectors bits per way, sectored caches only), the ages
+ *             of the ways (age_bits bits per way, see cache_age_bits()), then the replacement state of
+ *             the whole set, only kept by the policies which need one (the ways bits of the tree of
+ *             TREE_PLRU), rounded up to a word (see cache_meta_words()). Fields may straddle two words ;
+ *             a spare word follows the last set.
+ *  - lines  : the lines (data), lines * ways * words_per_line words, the ways of a set being contiguous
+ *  - counters : memory traffic of the cache
+ *  - blocks : block accesses starting at the cache (an L1)
+ *  - inclusion : activity of the cache under the inclusion policy of its hierarchy
+ *  - sectors : activity of the sectors of its lines (a sectored cache)
+ *  - wbuf   : write buffer between the cache and memory, NULL if none (not owned)
+ *  - seed   : state of the pseudo-random generator of the RANDOM and BRRIP policies
+ *  - mclass : classifier of the misses of the cache, NULL if none (not owned)
+ *  - pf     : prefetcher observing the accesses of the cache, NULL if none (not owned)
+ *  - timing : timing model charged for the accesses starting at the cache (an L1), NULL if none (not owned)
+ *  - victim : victim cache of the cache (an L1), NULL if none (not owned)
+ *  - mshr   : MSHRs making the cache (an L1) non-blocking, NULL if none (not owned)
+ *  - partition : ways of the cache each tenant sharing it may fill, NULL if it is not partitioned (not owned)
+ * Both arrays are aligned on CACHE_ALIGN.
+ */
+typedef struct {
+	cache_desc_t desc;
+	int preset;
+	uint32_t* meta;
+	word_t* lines;
+	cache_counters_t counters;
+	cache_block_counters_t blocks;
+	cache_inclusion_counters_t inclusion;
+	cache_sector_counters_t sectors;
+	struct write_buffer* wbuf;
+	uint32_t seed;
+	struct miss_class* mclass;
+	struct prefetcher* pf;
+	struct timing* timing;
+	struct victim_cache* victim;
+	struct mshr* mshr;
+	struct way_partition* partition;
+	} cache_store_t;
+
+/*
+ * Activity of a victim cache :
+ *  - probes    : lookups, by the accesses missing its L1
+ *  - hits      : lines found, swapped back into the L1
+ *  - fills     : lines evicted from the L1 into the victim cache
+ *  - evictions : lines evicted from the victim cache to make room, going down to the next level
+ */
+typedef struct {
+	uint64_t probes;
+	uint64_t hits;
+	uint64_t fills;
+	uint64_t evictions;
+	} cache_victim_counters_t;
+
+/*
+ * Victim cache of an L1 (see cache_set_victim()) : a few fully associative LRU entries
+ * between the L1 and the next level, filled by the lines the L1 evicts. The accesses
+ * missing the L1 look it up before the next level, a line found there going back to
+ * the L1 in exchange for the line the L1 evicts.
+ *  - store    : its entries, a cache of a single set
+ *  - counters : its activity
+ */
+typedef struct victim_cache {
+	cache_store_t store;
+	cache_victim_counters_t counters;
+	} victim_cache_t;
+
+#define CACHE_MAX_LEVELS 4u // L1 to L4
+#define CACHE_MAX_VICTIMS CACHE_MAX_WAYS // entries of a victim cache, at most
+
+/*
+ * Inclusion policy between the levels of a hierarchy of caches :
+ *  - CACHE_EXCLUSIVE : a line is in one level at most. A line fetched from memory goes into L1 only,
+ *                      a line found below L1 moves up into L1, and a line evicted from a level is
+ *                      placed in the next one (see cache_read)
+ *  - CACHE_INCLUSIVE : every level holds the lines of the levels above it. A line fetched from memory
+ *                      goes into every level, a line found below L1 is copied into the levels above,
+ *                      and a line evicted from a level is invalidated in the levels above it
+ *                      (back-invalidation), their dirty copy being written back
+ *  - CACHE_NINE      : non-inclusive non-exclusive, the lines are filled as for CACHE_INCLUSIVE but
+ *                      the levels never invalidate each other : a line evicted from a level is dropped
+ * Under the last two policies, a dirty line leaving a level is written into its closest copy below,
+ * memory if there is none, and a write-through store updates every copy of its line.
  */
 typedef enum {
-	L1_ICACHE, L1_DCACHE,L2_CACHE
-	} cache_t;
+	CACHE_EXCLUSIVE, CACHE_INCLUSIVE, CACHE_NINE
+	} cache_inclusion_t;
+
+/*
+ * Hierarchy of caches configured at runtime, from level 0 (L1) to level levels - 1
+ * (the last level cache), following an inclusion policy :
+ *  - levels : number of levels in use
+ *  - icache : cache of each level looked up by the instruction fetches
+ *  - dcache : cache of each level looked up by the data accesses
+ *             (the same as icache for a unified level)
+ *  - inclusion : its inclusion policy (CACHE_EXCLUSIVE by default, see cache_hrchy_set_inclusion())
+ * The caches of a hierarchy have the same line size, write policy and write buffer,
+ * but each one has its own geometry and replacement policy.
+ */
+typedef struct {
+	size_t levels;
+	cache_store_t* icache[CACHE_MAX_LEVELS];
+	cache_store_t* dcache[CACHE_MAX_LEVELS];
+	cache_inclusion_t inclusion;
+	} cache_hrchy_t;
+
+// --------------------------------------------------
+/**
+ * @brief ceil(log_2(N)), N up to CACHE_MAX_WAYS
+ */
+#define cache_log_2_ceil(N) \
+        ((N) > 64u ? 7u : (N) > 32u ? 6u : (N) > 16u ? 5u : (N) > 8u ? 4u : (N) > 4u ? 3u : (N) > 2u ? 2u : (N) > 1u ? 1u : 0u)
+
+/**
+ * @brief bits of the age of a way of WAYS ways under the replacement policy REPLACE : what its
+ *        state needs (an age from 0 to WAYS - 1 for LRU and FIFO, a bit for BIT_PLRU, a 2 bits
+ *        prediction for SRRIP and BRRIP, an 8 bits count for LFU, nothing otherwise)
+ */
+#define cache_age_bits(WAYS, REPLACE) \
+        ((REPLACE) == LRU || (REPLACE) == FIFO ? cache_log_2_ceil(WAYS) : (REPLACE) == BIT_PLRU ? 1u \
+         : (REPLACE) == SRRIP || (REPLACE) == BRRIP ? 2u : (REPLACE) == LFU ? 8u : 0u)
+
+/**
+ * @brief ways of WAYS ways under the policy REPLACE whose ages fit in 32 bits (all of them if the ages take no bit)
+ */
+#define cache_age_chunk(WAYS, REPLACE) (cache_age_bits(WAYS, REPLACE) == 0u ? (WAYS) : 32u / cache_age_bits(WAYS, REPLACE))
+
+/**
+ * @brief bit 0 of the ages of the even ways of a chunk of cache_age_chunk(WAYS, REPLACE) ways
+ *        (one every 2 * cache_age_bits(WAYS, REPLACE) bits)
+ */
+#define cache_age_lanes(WAYS, REPLACE) \
+        (cache_age_bits(WAYS, REPLACE) == 0u ? 0u \
+         : (uint32_t) ((((uint64_t) 1 << (2u * cache_age_bits(WAYS, REPLACE) * ((cache_age_chunk(WAYS, REPLACE) + 1u) / 2u))) - 1u) \
+                       / (((uint64_t) 1 << (2u * cache_age_bits(WAYS, REPLACE))) - 1u)))
+
+/*
+ * first bit of each field of the bit-packed metadata of a set (see cache_store_t)
+ */
+#define cache_dirty_bit(WAYS) (2u * (WAYS))
+#define cache_sector_bit(WAYS, SECTORS) (cache_dirty_bit(WAYS) + (WAYS) * (SECTORS))
+#define cache_age_bit(WAYS, SECTORS) (cache_sector_bit(WAYS, SECTORS) + ((SECTORS) > 1u ? (WAYS) * (SECTORS) : 0u))
+#define cache_state_bit(WAYS, REPLACE, SECTORS) (cache_age_bit(WAYS, SECTORS) + (WAYS) * cache_age_bits(WAYS, REPLACE))
+
+// --------------------------------------------------
+/**
+ * @brief words of metadata of a set of WAYS ways under the replacement policy REPLACE, with SECTORS
+ *        sectors per line (see cache_store_t) : a tag word per way, then the bits of the set
+ */
+#define cache_meta_words(WAYS, REPLACE, SECTORS) \
+        ((WAYS) + (cache_state_bit(WAYS, REPLACE, SECTORS) + ((REPLACE) == TREE_PLRU ? (WAYS) : 0u) + 31u) / 32u)
+
+// --------------------------------------------------
+#define cache_set_words(desc) ((desc)->set_words)
+
+// --------------------------------------------------
+#define CACHE_BITS_INLINE static inline __attribute__((always_inline))
+
+/**
+ * @brief N bits set (N below 64)
+ */
+#define cache_bits_ones(N) (((uint64_t) 1 << (N)) - 1u)
+
+/**
+ * @brief the COUNT bits (at most 32) of an array of bits from bit FIRST on (bit n of the array is bit n % 32
+ *        of its word n / 32) : they lie in two words at most, both read (the metadata of a cache
+ *        has a spare word at its end, see cache_init())
+ */
+CACHE_BITS_INLINE uint64_t cache_bits_load(const uint32_t* bits, uint32_t first, uint32_t count){
+	const uint32_t* word = bits + first / 32u;
+	uint64_t value = word[0] | (uint64_t) word[1] << 32;
+	return (value >> (first % 32u)) & cache_bits_ones(count);
+	}
+
+/**
+ * @brief set the COUNT bits (at most 32) of an array of bits from bit FIRST on to VALUE
+ */
+CACHE_BITS_INLINE void cache_bits_store(uint32_t* bits, uint32_t first, uint32_t count, uint64_t value){
+	uint32_t* word = bits + first / 32u;
+	uint32_t shift = first % 32u;
+	uint64_t mask = cache_bits_ones(count) << shift;
+	uint64_t field = ((word[0] | (uint64_t) word[1] << 32) & ~mask) | ((value << shift) & mask);
+	word[0] = (uint32_t) field;
+	word[1] = (uint32_t) (field >> 32);
+	}
+
+/*
+ * a field of up to 32 bits (always within two words)
+ */
+#define cache_bits_get(bits, FIRST, WIDTH) ((uint32_t) cache_bits_load(bits, FIRST, WIDTH))
+#define cache_bits_set(bits, FIRST, WIDTH, VALUE) cache_bits_store(bits, FIRST, WIDTH, VALUE)
+
+/**
+ * @brief index of the first clear bit among the COUNT bits of an array of bits from bit FIRST on, COUNT if none
+ */
+CACHE_BITS_INLINE uint32_t cache_bits_first_zero(const uint32_t* bits, uint32_t first, uint32_t count){
+	for (uint32_t i = 0; i < count; i += 32u){
+		uint32_t width = count - i < 32u ? count - i : 32u;
+		uint32_t zeros = ~cache_bits_get(bits, first + i, width) & (uint32_t) cache_bits_ones(width);
+		if (zeros != 0) return i + (uint32_t) __builtin_ctz(zeros);
+		}
+	return count;
+	}
+
+// --------------------------------------------------
+#define cache_tags(cache, desc, LINE_INDEX) \
+        ((cache)->meta + (size_t)(LINE_INDEX) * cache_set_words(desc))
+
+// --------------------------------------------------
+/**
+ * @brief the bits of a set, after its tags : its valid mask comes first (bit WAY : the way is valid)
+ */
+#define cache_meta_bits(cache, desc, LINE_INDEX) \
+        (cache_tags(cache, desc, LINE_INDEX) + (desc)->ways)
+
+// --------------------------------------------------
+#define cache_valids(cache, desc, LINE_INDEX) cache_meta_bits(cache, desc, LINE_INDEX)
+
+// --------------------------------------------------
+/**
+ * @brief valid state of a way : 0 (invalid), 1 (valid) or CACHE_PREFETCHED (its prefetched bit is set too)
+ */
+#define cache_valid(cache, desc, LINE_INDEX, WAY) \
+        cache_bits_valid(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->ways, (uint32_t) (WAY))
+
+CACHE_BITS_INLINE uint8_t cache_bits_valid(const uint32_t* bits, uint32_t ways, uint32_t way){
+	return cache_bits_get(bits, way, 1u) ? (uint8_t) (1u + cache_bits_get(bits, ways + way, 1u)) : 0u;
+	}
+
+#define cache_valid_set(cache, desc, LINE_INDEX, WAY, VALID) \
+        cache_bits_set_valid(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->ways, (uint32_t) (WAY), VALID)
+
+CACHE_BITS_INLINE void cache_bits_set_valid(uint32_t* bits, uint32_t ways, uint32_t way, uint32_t valid){
+	cache_bits_set(bits, way, 1u, valid != 0);
+	cache_bits_set(bits, ways + way, 1u, valid == CACHE_PREFETCHED);
+	}
+
+// --------------------------------------------------
+#define cache_age(cache, desc, LINE_INDEX, WAY) \
+        cache_bits_get(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->age_bit + (uint32_t) (WAY) * (desc)->age_bits, (desc)->age_bits)
+
+#define cache_age_set(cache, desc, LINE_INDEX, WAY, AGE) \
+        cache_bits_set(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->age_bit + (uint32_t) (WAY) * (desc)->age_bits, (desc)->age_bits, AGE)
+
+/**
+ * @brief copy the ages of the ways of a set (from its bits) into ages, a byte per way
+ */
+CACHE_BITS_INLINE void cache_ages_load(const uint32_t* bits, const cache_desc_t* desc, uint8_t* ages){
+	uint32_t width = desc->age_bits, chunk = desc->age_chunk;
+	for (uint32_t first = 0; first < desc->ways; first += chunk){
+		uint32_t count = desc->ways - first < chunk ? desc->ways - first : chunk;
+		uint32_t window = cache_bits_get(bits, desc->age_bit + first * width, count * width);
+		for (uint32_t way = 0; way < count; way++) ages[first + way] = (uint8_t) ((window >> (way * width)) & cache_bits_ones(width));
+		}
+	}
+
+/**
+ * @brief store the ages of the ways of a set (a byte per way) into its bits
+ */
+CACHE_BITS_INLINE void cache_ages_store(uint32_t* bits, const cache_desc_t* desc, const uint8_t* ages){
+	uint32_t width = desc->age_bits, chunk = desc->age_chunk;
+	for (uint32_t first = 0; first < desc->ways; first += chunk){
+		uint32_t count = desc->ways - first < chunk ? desc->ways - first : chunk;
+		uint32_t window = 0;
+		for (uint32_t way = 0; way < count; way++) window |= (uint32_t) ages[first + way] << (way * width);
+		cache_bits_set(bits, desc->age_bit + first * width, count * width, window);
+		}
+	}
+
+/**
+ * @brief bit 0 of the ages (of width bits, each with width free bits above it, their bits 0 being lanes)
+ *        which are at most max : each age is subtracted from max plus a guard bit above it, which is
+ *        left set if it is not borrowed (all the ages are compared at once)
+ */
+CACHE_BITS_INLINE uint64_t cache_ages_at_most(uint64_t ages, uint64_t lanes, uint32_t width, uint32_t max){
+	uint64_t guards = lanes << width;
+	uint64_t diff = (guards | lanes * max) - (ages & lanes * cache_bits_ones(width));
+	return (diff & guards) >> width;
+	}
+
+/**
+ * @brief add one to the ages of the ways of a set below limit, then reset the age of way to 0
+ *        (LRU and FIFO : the ages being at most limit, the additions do not carry over to the next age)
+ */
+CACHE_BITS_INLINE void cache_ages_bump(uint32_t* bits, const cache_desc_t* desc, uint32_t way, uint32_t limit){
+	uint32_t width = desc->age_bits, chunk = desc->age_chunk;
+	if (width == 0) return;
+	for (uint32_t first = 0; first < desc->ways; first += chunk){
+		uint32_t count = desc->ways - first < chunk ? desc->ways - first : chunk;
+		uint64_t ages = cache_bits_load(bits, desc->age_bit + first * width, count * width);
+		if (limit > 0){ // the even ways, then the odd ones
+			ages += cache_ages_at_most(ages, desc->age_lanes & cache_bits_ones(count * width), width, limit - 1)
+			        | cache_ages_at_most(ages >> width, desc->age_lanes & cache_bits_ones((count - 1) * width), width, limit - 1) << width;
+			}
+		if (way - first < count) ages &= ~(cache_bits_ones(width) << ((way - first) * width));
+		cache_bits_store(bits, desc->age_bit + first * width, count * width, ages);
+		}
+	}
+
+// --------------------------------------------------
+/**
+ * @brief dirty bit of a way, the mask of the dirty sectors of a sectored line
+ */
+#define cache_dirty(cache, desc, LINE_INDEX, WAY) \
+        ((uint8_t) cache_bits_get(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->dirty_bit + (uint32_t) (WAY) * (desc)->sectors, (desc)->sectors))
+
+#define cache_dirty_set(cache, desc, LINE_INDEX, WAY, DIRTY) \
+        cache_bits_set(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->dirty_bit + (uint32_t) (WAY) * (desc)->sectors, (desc)->sectors, DIRTY)
+
+// --------------------------------------------------
+/**
+ * @brief mask of the valid sectors of a line (sectored caches only)
+ */
+#define cache_sector_mask(cache, desc, LINE_INDEX, WAY) \
+        ((uint8_t) cache_bits_get(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->sector_bit + (uint32_t) (WAY) * (desc)->sectors, (desc)->sectors))
+
+#define cache_sector_mask_set(cache, desc, LINE_INDEX, WAY, MASK) \
+        cache_bits_set(cache_meta_bits(cache, desc, LINE_INDEX), (desc)->sector_bit + (uint32_t) (WAY) * (desc)->sectors, (desc)->sectors, MASK)
+
+// --------------------------------------------------
+#define cache_tag(cache, desc, LINE_INDEX, WAY) \
+        cache_tags(cache, desc, LINE_INDEX)[WAY]
+
+// --------------------------------------------------
+#define cache_line(cache, desc, LINE_INDEX, WAY) \
+        ((cache)->lines + ((size_t)(LINE_INDEX) * (desc)->ways + (WAY)) * (desc)->words_per_line)
+// --------------------------------------------------
@@ -1,11 +1,37 @@
 #include "error.h"
 #include "cache_mng.h"
-#include "lru.h"
+#include "replacement.h"
+#include "write_buffer.h"
+#include "miss_class.h"
+#include "prefetch.h"
+#include "timing.h"
+#include "mshr.h"
+#include "partition.h"
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "addr_mng.h"
+#include "simd_util.h"
 //=========================================================================
 //=========================== HELPER FUNCTIONS ============================
+/**
+ * @brief helpers of the engine are forced inline so that the code called with the
+ *        presets below is specialised by the compiler (constant lines, ways and line size)
+ */
+#define CACHE_INLINE static inline __attribute__((always_inline))
+/**
+ * @brief copy bytes of lines (memory, levels, buffers), counted with -DCACHE_COUNT_COPIES (see cache_copied_bytes())
+ */
+#ifdef CACHE_COUNT_COPIES
+static uint64_t copied_bytes = 0;
+#define copy_bytes(dest, src, n) (copied_bytes += (n), memcpy(dest, src, n))
+uint64_t cache_copied_bytes(void){
+	return copied_bytes;
+	}
+#else
+#define copy_bytes(dest, src, n) memcpy(dest, src, n)
+#endif
 /**
  * @brief convert a paddr_t into a uint32t
  */
@@ -13,139 +39,398 @@
 /**
  * @brief extract the line_index from a phy_addr
  */
-#define extract_line_index(phy_addr, CACHE_TYPE) (((phy_addr)/(sizeof(word_t)*(CACHE_TYPE ## _WORDS_PER_LINE))) % (CACHE_TYPE ## _LINES))
+#define extract_line_index(phy_addr, desc) (((phy_addr) >> (desc)->line_bits) & ((desc)->lines - 1))
 /**
  * @brief extract the word_index from a phy_addr
  */
-#define extract_word_index(phy_addr, CACHE_TYPE) (((phy_addr)/(sizeof(word_t))) % (CACHE_TYPE ## _WORDS_PER_LINE))
+#define extract_word_index(phy_addr, desc) (((phy_addr)/(sizeof(word_t))) & ((desc)->words_per_line - 1))
+/**
+ * @brief extract the tag from a phy_addr
+ */
+#define extract_tag(phy_addr, desc) ((uint32_t)(phy_addr) >> (desc)->tag_remaining_bits)
+/**
+ * @brief compute address aligned on line_index (for memory accesses), in words
+ */
+#define compute_addr_line_aligned(phy_addr, desc) ((((phy_addr) >> (desc)->line_bits) << (desc)->line_bits) / sizeof(word_t))
+/**
+ * @brief function that accesses memory, simply copies a whole line of words from dest to src
+ */
+void access_memory(const word_t* src, word_t* dest, uint32_t WORDS_PER_LINE){
+	copy_bytes(dest, src, WORDS_PER_LINE*sizeof(word_t));
+	}
+
 /**
- * @brief cast an l1 void* entry to the type given by access
+ * @brief Reads a whole line in memory at the address given by the phy_addr
+ *
+ * @param mem_space pointer to the memory space
+ * @param paddr uint corresponding to a physical address
+ * @param line pointer to the line to set after reading the memory
+ * @param desc geometry of the cache the line is meant for
+ * @return nothing (void)
  */
-#define cast_l1_entry(access, entry) ( ((access) == INSTRUCTION)? ((l1_icache_entry_t*)(entry)): ((l1_dcache_entry_t*)(entry)))
+CACHE_INLINE void read_memory(const void * mem_space, uint32_t phy_addr, word_t* line, const cache_desc_t* desc) {
+	size_t addr = compute_addr_line_aligned(phy_addr, desc); //gets the word addressed phy addr and sets line using memory
+	access_memory((const word_t*)(mem_space) + addr, line, desc->words_per_line);   //let us assume that WORDS_PER_LINE*sizeof(word_t) is not going to overflow
+	}
+
 /**
- * @brief return the instance of cache_type_t given by access 
+ * mask of all the words of a line (see store_memory)
  */
-#define to_l1_cache(access) (((access) == INSTRUCTION)?L1_ICACHE:L1_DCACHE)
+#define all_words(desc) ((desc)->words_per_line == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << (desc)->words_per_line) - 1)
+
 /**
- * @brief compute address aligned on line_index (for memory accesses)
+ * @brief Writes some words of a line to memory, through the write buffer of the cache if it has one
+ *
+ * @param mem_space pointer to the memory space
+ * @param cache the cache the words come from (counted as a memory write)
+ * @param phy_addr uint corresponding to a physical address in the line
+ * @param line the words of the line
+ * @param mask bit i set if line[i] has to be written
+ * @param desc geometry of the cache
  */
-#define compute_addr_line_aligned(phy_addr,CACHE_TYPE) (((phy_addr/sizeof(word_t))/(CACHE_TYPE ## _WORDS_PER_LINE))*(CACHE_TYPE ## _WORDS_PER_LINE))
+CACHE_INLINE void store_memory(void * mem_space, cache_store_t* cache, uint32_t phy_addr, const word_t* line, uint64_t mask,
+                               const cache_desc_t* desc){
+	cache->counters.mem_writes++;
+	if (cache->wbuf != NULL){
+		write_buffer_store(mem_space, cache->wbuf, phy_addr, line, mask);
+		return;
+		}
+	word_t* dest = (word_t*)(mem_space) + compute_addr_line_aligned(phy_addr, desc);
+	for (; mask != 0; mask &= mask - 1){
+		int i = __builtin_ctzll(mask);
+		dest[i] = line[i];
+		}
+	}
+
 /**
- * @brief function that accesses memory, simply copies a whole line of words from dest to src 
+ * @brief Reads a whole line in memory (see read_memory), with the words still in the write buffer of the cache
  */
-void access_memory(const word_t* src, word_t* dest, uint8_t WORDS_PER_LINE){
-	memcpy (dest, src, WORDS_PER_LINE*sizeof(word_t));
+CACHE_INLINE void load_memory(const void * mem_space, const cache_store_t* cache, uint32_t phy_addr, word_t* line, const cache_desc_t* desc){
+	read_memory(mem_space, phy_addr, line, desc);
+	if (cache->wbuf != NULL) write_buffer_forward(cache->wbuf, phy_addr, line);
 	}
-/*******************************************************************/
+
+//=========================================================================
+/**
+ * whether the lines of a cache are sectored (see cache_desc_set_sectors)
+ */
+#define sectored(desc) ((desc)->sectors > 1u)
+
+/**
+ * mask of all the sectors of a line (a line not sectored being a single one)
+ */
+#define all_sectors(desc) ((uint8_t) ((1u << (desc)->sectors) - 1u))
+
 /**
- * Macros defined as the ones in cache.h but that can be used with any cache name
- **/
- 
-// --------------------------------------------------
-#define cache_cast_any(TYPE, CACHE) ((TYPE *)CACHE)
+ * bytes of a sector
+ */
+#define sector_bytes(desc) ((desc)->line_bytes / (desc)->sectors)
 
-// --------------------------------------------------
-#define cache_entry_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE) \
-        (cache_cast_any(TYPE, CACHE) + (LINE_INDEX) * (WAYS) + (WAY))
+/**
+ * @brief mask of the sectors of a line holding the LENGTH bytes from the one of phy_addr
+ */
+#define range_sectors(phy_addr, desc, LENGTH)                                                                          \
+	(sectored(desc) ? (uint8_t) (((2u << ((((phy_addr) & ((desc)->line_bytes - 1)) + (LENGTH) - 1) / sector_bytes(desc))) - 1u) \
+	                             & ~((1u << (((phy_addr) & ((desc)->line_bytes - 1)) / sector_bytes(desc))) - 1u))      \
+	                : (uint8_t) 1u)
 
-// --------------------------------------------------
-#define cache_valid_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE) \
-        cache_entry_any(TYPE, WAYS, LINE_INDEX, WAY,CACHE)->v
+/**
+ * @brief mask of the words of a line (see store_memory) held by some of its sectors
+ */
+CACHE_INLINE uint64_t sector_words(const cache_desc_t* desc, uint8_t sectors){
+	if (!sectored(desc)) return all_words(desc);
+	uint32_t words = desc->words_per_line / desc->sectors; // less than 64
+	uint64_t mask = 0;
+	for (; sectors != 0; sectors &= (uint8_t) (sectors - 1))
+		mask |= (((uint64_t) 1 << words) - 1) << (__builtin_ctz(sectors) * words);
+	return mask;
+	}
 
-// --------------------------------------------------
-#define cache_age_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE) \
-        cache_entry_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE)->age
+/**
+ * @brief valid sectors of a line (all of them if the cache is not sectored)
+ */
+#define line_sectors(cache, desc, LINE_INDEX, WAY) \
+	(sectored(desc) ? cache_sector_mask(cache, desc, LINE_INDEX, WAY) : all_sectors(desc))
 
-// --------------------------------------------------
-#define cache_tag_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE) \
-        cache_entry_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE)->tag
+/**
+ * @brief set the valid sectors of a line (nothing to do if the cache is not sectored)
+ */
+CACHE_INLINE void set_line_sectors(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, uint8_t way, uint8_t sectors){
+	if (sectored(desc)) cache_sector_mask_set(cache, desc, line_index, way, sectors);
+	}
 
-// --------------------------------------------------
-#define cache_line_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE) \
-        cache_entry_any(TYPE, WAYS, LINE_INDEX, WAY, CACHE)->line
-// --------------------------------------------------
+/**
+ * @brief copy some sectors of a line into another one
+ */
+CACHE_INLINE void copy_sectors(word_t* dest, const word_t* src, const cache_desc_t* desc, uint8_t sectors){
+	for (; sectors != 0; sectors &= (uint8_t) (sectors - 1)){
+		size_t offset = (size_t) __builtin_ctz(sectors) * sector_bytes(desc);
+		copy_bytes((uint8_t*) dest + offset, (const uint8_t*) src + offset, sector_bytes(desc));
+		}
+	}
 
 /**
- * @brief debug function and macro to print an entry 
+ * @brief a line read from memory into a sectored cache holds the given sectors only
  */
-#define print_entry_generic(TYPE, entry) \
-		fprintf(stderr, "Type : "#TYPE", Valid : %d, Age : %d, Tag : %"PRIx32", Data [", entry->v, entry->age, entry->tag); \
-		for(int i = 0; i < L1_DCACHE_WORDS_PER_LINE; i++)										\
-			fprintf(stderr, "%" PRIx32 ",", entry->line[i]);									\
-		fprintf(stderr, "]\n");																	\
+CACHE_INLINE void fill_sectors(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, uint8_t way, uint8_t sectors){
+	if (!sectored(desc)) return;
+	cache_sector_mask_set(cache, desc, line_index, way, sectors);
+	cache->sectors.reads += (uint64_t) __builtin_popcount(sectors);
+	}
 
-void print_entry(cache_t type, void* entry){
-	switch(type){
-		case L1_DCACHE: print_entry_generic(l1_dcache_entry_t,((l1_dcache_entry_t*) entry)); break;
-		case L1_ICACHE: print_entry_generic(l1_icache_entry_t,((l1_icache_entry_t*) entry)); break;
-		case L2_CACHE : print_entry_generic(l2_cache_entry_t, ((l2_cache_entry_t* ) entry)); break;
+/**
+ * @brief the line of phy_addr has been found in a cache, at (line_index, way) : read the sectors
+ *        holding the LENGTH bytes from phy_addr which it lacks from memory (a sector miss)
+ */
+CACHE_INLINE void fetch_sectors(const void * mem_space, cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, uint8_t way,
+                                uint32_t phy_addr, size_t length){
+	if (!sectored(desc)) return;
+	uint8_t missing = (uint8_t) (range_sectors(phy_addr, desc, length) & ~cache_sector_mask(cache, desc, line_index, way));
+	if (missing == 0) return;
+	word_t line[CACHE_MAX_WORDS_PER_LINE];
+	load_memory(mem_space, cache, phy_addr, line, desc);
+	copy_sectors(cache_line(cache, desc, line_index, way), line, desc, missing);
+	cache_sector_mask_set(cache, desc, line_index, way, cache_sector_mask(cache, desc, line_index, way) | missing);
+	cache->sectors.misses++;
+	cache->sectors.reads += (uint64_t) __builtin_popcount(missing);
 	}
-}
-//=========================================================================
+
 /**
- * @brief Cleans a cache with type type
- *
- * @param type     : type of cache (l1_icache_entry_t, l1_dcache_entry_t, l2_cache_entry_t)
- * @param cache    : the (generic) pointer to the cache
- * @param CACHE_TYPE : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
- * 
- * it first test the overflow of sizeof(type)*NB_LINE*WAYS
+ * the fixed configurations of cache.h, as descriptors (indexed by cache_t)
+ */
+#define preset_desc(CACHE_TYPE) \
+	{ CACHE_TYPE ## _LINES, CACHE_TYPE ## _WAYS, CACHE_TYPE ## _LINE, LRU, WRITE_THROUGH, WRITE_ALLOCATE, 1u, CACHE_TYPE ## _WORDS_PER_LINE, \
+	  CACHE_TYPE ## _LINE_BITS, CACHE_TYPE ## _LINES_BITS, CACHE_TYPE ## _TAG_REMAINING_BITS, CACHE_TYPE ## _TAG_BITS, \
+	  cache_meta_words(CACHE_TYPE ## _WAYS, LRU, 1u), cache_age_bits(CACHE_TYPE ## _WAYS, LRU), \
+	  cache_age_chunk(CACHE_TYPE ## _WAYS, LRU), cache_age_lanes(CACHE_TYPE ## _WAYS, LRU), cache_dirty_bit(CACHE_TYPE ## _WAYS), \
+	  cache_sector_bit(CACHE_TYPE ## _WAYS, 1u), cache_age_bit(CACHE_TYPE ## _WAYS, 1u), cache_state_bit(CACHE_TYPE ## _WAYS, LRU, 1u) }
+static const cache_desc_t CACHE_PRESETS[CACHE_NB] = {
+	[L1_ICACHE] = preset_desc(L1_ICACHE),
+	[L1_DCACHE] = preset_desc(L1_DCACHE),
+	[L2_CACHE]  = preset_desc(L2_CACHE)
+	};
+
+/**
+ * @brief debug function to print an entry
+ */
+void print_entry(const cache_entry_t* entry, const cache_desc_t* desc){
+	fprintf(stderr, "Valid : %d, Age : %d, Tag : %"PRIx32", Data [", entry->v, entry->age, entry->tag);
+	for(uint32_t i = 0; i < desc->words_per_line; i++)
+		fprintf(stderr, "%" PRIx32 ",", entry->line[i]);
+	fprintf(stderr, "]\n");
+	}
+
+/**
+ * @brief round a size up to a multiple of CACHE_ALIGN (as required by aligned_alloc)
+ */
+#define align_size(size) ((((size) + CACHE_ALIGN - 1) / CACHE_ALIGN) * CACHE_ALIGN)
+
+/**
+ * @brief size of the metadata of a cache : its sets, and a spare word (the fields of the last set are
+ *        read and written two words at a time, see cache_bits_load())
+ */
+#define meta_size(desc) (((size_t) (desc)->lines * cache_set_words(desc) + 1u) * sizeof(uint32_t))
+
+/**
+ * @brief log_2 of a power of 2
+ */
+static uint8_t log_2(uint32_t n){
+	uint8_t bits = 0;
+	while (((uint32_t) 1 << bits) < n) ++bits;
+	return bits;
+	}
+
+/**
+ * @brief derive the layout of the metadata of a set (see cache_store_t) from the geometry and policy of desc
+ */
+static void set_meta_layout(cache_desc_t* desc){
+	desc->set_words = cache_meta_words(desc->ways, desc->replace, desc->sectors);
+	desc->age_bits = (uint8_t) cache_age_bits(desc->ways, desc->replace);
+	desc->age_chunk = (uint8_t) cache_age_chunk(desc->ways, desc->replace);
+	desc->age_lanes = cache_age_lanes(desc->ways, desc->replace);
+	desc->dirty_bit = (uint16_t) cache_dirty_bit(desc->ways);
+	desc->sector_bit = (uint16_t) cache_sector_bit(desc->ways, desc->sectors);
+	desc->age_bit = (uint16_t) cache_age_bit(desc->ways, desc->sectors);
+	desc->state_bit = (uint16_t) cache_state_bit(desc->ways, desc->replace, desc->sectors);
+	}
+
+/**
+ * @brief whether two descriptors describe the same cache (the other fields being derived)
+ *        the write policy is not compared : it is read at runtime
  */
-#define flush_generic(type, cache, CACHE_TYPE)                                                                   \
-	 M_REQUIRE(((CACHE_TYPE ## _LINES) <= SIZE_MAX/(CACHE_TYPE ## _WAYS)), ERR_SIZE, "Could not memset : overflow, %c", " ");                    \
-	 M_REQUIRE((((CACHE_TYPE ## _LINES)*(CACHE_TYPE ## _WAYS)) < SIZE_MAX/sizeof(type)), ERR_SIZE, "Could not memset : overflow, %c", " ");  /*overflow checks*/   \
-	 memset(cache , 0, sizeof(type)*(CACHE_TYPE ## _LINES)*(CACHE_TYPE ## _WAYS));   /* Memsets the full cache to 0*/                                                      
+static bool desc_equal(const cache_desc_t* a, const cache_desc_t* b){
+	return a->lines == b->lines && a->ways == b->ways && a->line_bytes == b->line_bytes && a->replace == b->replace
+	       && a->sectors == b->sectors;
+	}
+
+//=========================================================================
+int cache_desc_init(cache_desc_t * desc, uint32_t lines, uint32_t ways, uint32_t line_bytes, cache_replace_t replace){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(lines != 0 && lines <= CACHE_MAX_LINES && (lines & (lines - 1)) == 0, ERR_SIZE,
+	          "number of lines (%"PRIu32") must be a power of 2 up to %u", lines, CACHE_MAX_LINES);
+	M_REQUIRE(1 <= ways && ways <= CACHE_MAX_WAYS, ERR_SIZE, "number of ways (%"PRIu32") must be between 1 and %u", ways, CACHE_MAX_WAYS);
+	M_REQUIRE(sizeof(word_t) <= line_bytes && line_bytes <= CACHE_MAX_LINE_BYTES && (line_bytes & (line_bytes - 1)) == 0, ERR_SIZE,
+	          "line size (%"PRIu32") must be a power of 2 between one word and %u bytes", line_bytes, CACHE_MAX_LINE_BYTES);
+	M_REQUIRE(LRU <= replace && replace < CACHE_REPLACE_NB, ERR_BAD_PARAMETER, "%d is not a valid instance of cache_replace_t", replace);
+	M_REQUIRE(replace != TREE_PLRU || (ways & (ways - 1)) == 0, ERR_BAD_PARAMETER,
+	          "tree-PLRU needs a power of 2 number of ways (%"PRIu32")", ways);
+	desc->lines = lines;
+	desc->ways = ways;
+	desc->line_bytes = line_bytes;
+	desc->replace = replace;
+	desc->write = WRITE_THROUGH;
+	desc->alloc = WRITE_ALLOCATE;
+	desc->sectors = 1;
+	desc->words_per_line = line_bytes / sizeof(word_t);
+	desc->line_bits = log_2(line_bytes);
+	desc->lines_bits = log_2(lines);
+	desc->tag_remaining_bits = (uint8_t)(desc->line_bits + desc->lines_bits);
+	desc->tag_bits = (uint8_t)(32 - desc->tag_remaining_bits); //the tag is what remains of a 32 bits physical address
+	set_meta_layout(desc);
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_desc_preset(cache_desc_t * desc, cache_t cache_type){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(L1_ICACHE <= cache_type && cache_type <= L2_CACHE, ERR_BAD_PARAMETER, "%d is not a valid cache_type \n", cache_type);
+	*desc = CACHE_PRESETS[cache_type];
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_desc_set_write(cache_desc_t * desc, cache_write_t write){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(write == WRITE_THROUGH || write == WRITE_BACK, ERR_BAD_PARAMETER, "%d is not a valid write policy", write);
+	desc->write = write;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_desc_set_alloc(cache_desc_t * desc, cache_alloc_t alloc){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(alloc == WRITE_ALLOCATE || alloc == NO_WRITE_ALLOCATE, ERR_BAD_PARAMETER, "%d is not a valid write-miss policy", alloc);
+	desc->alloc = alloc;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_desc_set_sectors(cache_desc_t * desc, uint32_t sectors){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(1 <= sectors && sectors <= CACHE_MAX_SECTORS && (sectors & (sectors - 1)) == 0, ERR_SIZE,
+	          "number of sectors (%"PRIu32") must be a power of 2 up to %u", sectors, CACHE_MAX_SECTORS);
+	M_REQUIRE(desc->line_bytes / sectors >= sizeof(word_t), ERR_SIZE,
+	          "a sector (line of %"PRIu32" bytes) must hold a word at least", desc->line_bytes);
+	desc->sectors = sectors;
+	set_meta_layout(desc);
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_set_seed(cache_store_t * cache, uint32_t seed){
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE(seed != 0, ERR_BAD_PARAMETER, "the seed must be non zero %c", ' ');
+	cache->seed = seed;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_init(cache_store_t * cache, const cache_desc_t * desc){
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE_NON_NULL(desc);
+	memset(cache, 0, sizeof(cache_store_t));
+	int err = ERR_NONE;
+	//checks desc and derives its other fields
+	if ((err = cache_desc_init(&cache->desc, desc->lines, desc->ways, desc->line_bytes, desc->replace)) != ERR_NONE) return err;
+	if ((err = cache_desc_set_write(&cache->desc, desc->write)) != ERR_NONE) return err;
+	if ((err = cache_desc_set_alloc(&cache->desc, desc->alloc)) != ERR_NONE) return err;
+	if ((err = cache_desc_set_sectors(&cache->desc, desc->sectors)) != ERR_NONE) return err;
+	cache->seed = CACHE_DEFAULT_SEED;
+	cache->preset = CACHE_NO_PRESET;
+#ifndef CACHE_NO_PRESETS // defined to always use the generic code (e.g. to compare it with the specialised one)
+	for (int t = CACHE_NB - 1; t >= L1_ICACHE; t--){
+		if (desc_equal(&cache->desc, &CACHE_PRESETS[t])) cache->preset = t;
+		}
+#endif
+	//sizes are bounded by CACHE_MAX_LINES, CACHE_MAX_WAYS and CACHE_MAX_LINE_BYTES : no overflow
+	size_t nb_entries = (size_t) cache->desc.lines * cache->desc.ways;
+	cache->meta = aligned_alloc(CACHE_ALIGN, align_size(meta_size(&cache->desc)));
+	cache->lines = aligned_alloc(CACHE_ALIGN, align_size(nb_entries * cache->desc.line_bytes));
+	if (cache->meta == NULL || cache->lines == NULL){
+		cache_free(cache);
+		M_EXIT_ERR(ERR_MEM, ", cannot allocate %zu entries", nb_entries);
+		}
+	return cache_flush(cache);
+	}
+
+//=========================================================================
+void cache_free(cache_store_t * cache){
+	if (cache == NULL) return;
+	free(cache->meta);
+	free(cache->lines);
+	cache->meta = NULL;
+	cache->lines = NULL;
+	}
+
 //=========================================================================
 /**
  * @brief Clean a cache (invalidate, reset...).
  *
  * This function erases all cache data.
  * @param cache pointer to the cache
- * @param cache_type an enum to distinguish between different caches
  * @return error code
  */
-int cache_flush(void *cache, cache_t cache_type){
+int cache_flush(cache_store_t * cache){
 	M_REQUIRE_NON_NULL(cache);
-	// test if the tlb_type is a valid instance of tlb_t
-	M_REQUIRE(L1_ICACHE <= cache_type && cache_type <= L2_CACHE, ERR_BAD_PARAMETER, "%d is not a valid cache_type \n", cache_type);
-
-	// for each cache type call the generic macro defined before
-	switch (cache_type) {
-        case L1_ICACHE : flush_generic(l1_icache_entry_t, cache, L1_ICACHE); break;
-        case L1_DCACHE : flush_generic(l1_dcache_entry_t, cache, L1_DCACHE); break;
-        case L2_CACHE  : flush_generic(l2_cache_entry_t , cache, L2_CACHE) ; break;
-        default        : return ERR_BAD_PARAMETER; break;
-    }
-	
+	M_REQUIRE_NON_NULL(cache->meta);
+	M_REQUIRE_NON_NULL(cache->lines);
+	/* Memsets the full cache to 0*/
+	memset(cache->meta, 0, meta_size(&cache->desc));
+	memset(cache->lines, 0, (size_t) cache->desc.lines * cache->desc.ways * cache->desc.line_bytes);
+	if (cache->victim != NULL) return cache_flush(&cache->victim->store);
 	return ERR_NONE;
 	}
-	
+
 //=========================================================================
+/*
+ * from this associativity on, sets are probed by the SIMD kernel (simd_probe_u32),
+ * below it the inlined loop (specialised for the presets) is faster than the call
+ */
+#ifndef CACHE_SIMD_MIN_WAYS
+#define CACHE_SIMD_MIN_WAYS 32
+#endif
 /**
- * @brief generic helper function for cache_hit
- * 
- * @param type               : type of cache (l1_icache_entry_t, l1_dcache_entry_t, l2_cache_entry_t)
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
+ * @brief probe a set (same contract as simd_probe_u32)
  */
-#define cache_hit_generic(type, CACHE_TYPE)    \
-	uint16_t line_index = extract_line_index(phy_addr, CACHE_TYPE);      \
-	uint32_t tag = phy_addr >> (CACHE_TYPE ## _TAG_REMAINING_BITS);                                     \
-	foreach_way(Way, CACHE_TYPE ## _WAYS) {  /*iterate on each way : if a cold start or a hit is*/    \
-		                                              /*found  stop the execution */   \
-		if (!cache_valid(type, CACHE_TYPE ## _WAYS, line_index, Way) ){/* found a place*/             \
-			/*LRU_age_increase(type, WAYS, line_index, way);update*/                   \
-			return ERR_NONE;                                                           \
-			}                                                                          \
-		else if (cache_tag(type, CACHE_TYPE ## _WAYS, line_index, Way) == tag){/*hit*/                \
-			*p_line = cache_line(type,CACHE_TYPE ## _WAYS, line_index, Way); /*if hit, set way and index*/\
-			*hit_way = Way;                                                            \
-			*hit_index = line_index;                                                   \
-			LRU_age_update(type, CACHE_TYPE ## _WAYS, Way,line_index);/*update ages*/                 \
-			return ERR_NONE;                                                           \
-		}                                                                              \
-	}                                                                                  \
-	/*if we arrive here no entry has been found*/                                      \
-	return ERR_NONE;
+CACHE_INLINE size_t probe_set(const uint32_t* tags, const uint32_t* valids, size_t ways, uint32_t tag, size_t* first_invalid){
+	if (ways >= CACHE_SIMD_MIN_WAYS) return simd_probe_u32(tags, valids, ways, tag, first_invalid);
+	*first_invalid = ways;
+	for (size_t Way = 0; Way < ways; Way++){ /*iterate on each way : if a hit is found stop the execution */
+		if (!((valids[Way / 32] >> (Way % 32)) & 1u)) { if (*first_invalid == ways) *first_invalid = Way; }/* found a place*/
+		else if (tags[Way] == tag) return Way; /*hit*/
+		}
+	return ways;
+	}
+
+/**
+ * @brief generic core of cache_hit, for a cache described by desc
+ *        (invalid ways do not stop the probe : lines moved to L1 leave holes in L2 sets)
+ * @return on a miss, the first invalid way of the set (NOTHING_FOUND if the set is full)
+ */
+CACHE_INLINE int cache_hit_core(cache_store_t* cache, const cache_desc_t* desc, uint32_t phy_addr,
+                                const uint32_t ** p_line, uint8_t *hit_way, uint16_t *hit_index){
+	uint16_t line_index = (uint16_t) extract_line_index(phy_addr, desc);
+	size_t first_invalid = desc->ways;
+	size_t Way = probe_set(cache_tags(cache, desc, line_index), cache_valids(cache, desc, line_index),
+	                       desc->ways, extract_tag(phy_addr, desc), &first_invalid);
+	if (Way == desc->ways) /*miss : no entry has been found*/
+		return first_invalid == desc->ways ? NOTHING_FOUND : (int) first_invalid;
+	*p_line = cache_line(cache, desc, line_index, Way); /*if hit, set way and index*/
+	*hit_way = (uint8_t) Way;
+	*hit_index = line_index;
+	replacement_touch(cache, desc, line_index, (uint8_t) Way);/*update ages*/
+	return NOTHING_FOUND;
+	}
 
 
 //=========================================================================
@@ -156,98 +441,93 @@ int cache_flush(void *cache, cache_t cache_type){
  * On miss, return miss (0).
  *
  * @param mem_space starting address of the memory space
- * @param cache pointer to the beginning of the cache
+ * @param cache pointer to the cache
  * @param paddr pointer to physical address
  * @param p_line pointer to a cache-line-size chunk of data to return
  * @param hit_way (modified) cache way where hit was detected, HIT_WAY_MISS on miss
  * @param hit_index (modified) cache line index where hit was detected, HIT_INDEX_MISS on miss
- * @param cache_type to distinguish between different caches
  * @return  error code
  */
 
-int cache_hit (const void * mem_space, void * cache, phy_addr_t * paddr, const uint32_t ** p_line, uint8_t *hit_way, uint16_t *hit_index, cache_t cache_type){
+int cache_hit (const void * mem_space, cache_store_t * cache, phy_addr_t * paddr, const uint32_t ** p_line, uint8_t *hit_way, uint16_t *hit_index){
 	M_REQUIRE_NON_NULL(mem_space); //check all requirements
 	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE_NON_NULL(cache->meta);
 	M_REQUIRE_NON_NULL(paddr);
 	M_REQUIRE_NON_NULL(p_line);
 	M_REQUIRE_NON_NULL(hit_way);
 	M_REQUIRE_NON_NULL(hit_index);
-	M_REQUIRE(L1_ICACHE <= cache_type && cache_type <= L2_CACHE, ERR_BAD_PARAMETER, "%d is not a valid cache_type \n", cache_type);
 	*hit_way = HIT_WAY_MISS;//init to miss first and set to hit otherwise
 	*hit_index = HIT_INDEX_MISS;
 	*p_line = NULL;
 	uint32_t phy_addr = phy_to_int(paddr);
-	
-	switch(cache_type){ //use the generic macro depending on the type of the cache
-		case L1_ICACHE:{ cache_hit_generic(l1_icache_entry_t, L1_ICACHE);break;}
-		case L1_DCACHE:{ cache_hit_generic(l1_dcache_entry_t, L1_DCACHE);break;}
-		case L2_CACHE :{ cache_hit_generic(l2_cache_entry_t, L2_CACHE);break;}
-		default: return ERR_BAD_PARAMETER;
+
+	switch(cache->preset){ //use the specialised code if the cache is a preset
+		case L1_ICACHE : cache_hit_core(cache, &CACHE_PRESETS[L1_ICACHE], phy_addr, p_line, hit_way, hit_index); break;
+		case L2_CACHE  : cache_hit_core(cache, &CACHE_PRESETS[L2_CACHE] , phy_addr, p_line, hit_way, hit_index); break;
+		default        : cache_hit_core(cache, &cache->desc, phy_addr, p_line, hit_way, hit_index); break;
+		}
+	return ERR_NONE;
 	}
-}
 
 //=========================================================================
 /**
- * @brief generic helper function for cache_insert
- * 
- * @param type               : type of cache (l1_icache_entry_t, l1_dcache_entry_t, l2_cache_entry_t)
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
+ * @brief generic core of cache_insert : copy an entry in a cache described by desc
  */
-#define cache_insert_generic(TYPE, CACHE_TYPE)                                                                              \
-    /*verify that the way and lines are valid */                                                                                \
-	M_REQUIRE(cache_way < (CACHE_TYPE ## _WAYS) && cache_line_index < (CACHE_TYPE ## _LINES), ERR_BAD_PARAMETER, "cache way and index have to match %c", ' '); \
-	*cache_entry(TYPE, (CACHE_TYPE ## _WAYS), cache_line_index, cache_way ) = *(TYPE*)cache_line_in; /*sets the entry to be the entry given in argument*/ \
-	return ERR_NONE;
+CACHE_INLINE void cache_insert_core(cache_store_t* cache, const cache_desc_t* desc, uint16_t cache_line_index,
+                                    uint8_t cache_way, const cache_entry_t* cache_line_in){
+	/*sets the entry to be the entry given in argument*/
+	cache_valid_set(cache, desc, cache_line_index, cache_way, cache_line_in->v);
+	cache_age_set(cache, desc, cache_line_index, cache_way, cache_line_in->age);
+	cache_dirty_set(cache, desc, cache_line_index, cache_way, cache_line_in->dirty);
+	cache_tag(cache, desc, cache_line_index, cache_way) = cache_line_in->tag;
+	set_line_sectors(cache, desc, cache_line_index, cache_way, all_sectors(desc)); // a whole line
+	copy_bytes(cache_line(cache, desc, cache_line_index, cache_way), cache_line_in->line, desc->words_per_line * sizeof(word_t));
+	}
 //=========================================================================
 /**
  * @brief Insert an entry to a cache.
  *
  * @param cache_line_index the number of the line to overwrite
  * @param cache_way the number of the way where to insert
- * @param cache_line_in pointer to the cache line to insert
+ * @param cache_line_in pointer to the cache entry to insert
  * @param cache pointer to the cache
- * @param cache_type to distinguish between different caches
  * @return  error code
  */
 
-int cache_insert(uint16_t cache_line_index,uint8_t cache_way,const void * cache_line_in,
-                 void * cache, cache_t cache_type){
+int cache_insert(uint16_t cache_line_index,uint8_t cache_way,const cache_entry_t * cache_line_in, cache_store_t * cache){
 	M_REQUIRE_NON_NULL(cache);//check requirements
+	M_REQUIRE_NON_NULL(cache->meta);
 	M_REQUIRE_NON_NULL(cache_line_in);
-	M_REQUIRE(L1_ICACHE <= cache_type && cache_type <= L2_CACHE, ERR_BAD_PARAMETER, "cache type is not a valid value : %d", cache_type);
-	
-	switch (cache_type) { //use the generic macro depending on the type of the cache
-         case L1_ICACHE : cache_insert_generic(l1_icache_entry_t, L1_ICACHE); break;
-         case L1_DCACHE : cache_insert_generic(l1_dcache_entry_t, L1_DCACHE); break;
-         case L2_CACHE  : cache_insert_generic(l2_cache_entry_t,  L2_CACHE) ; break;
-         default        : return ERR_BAD_PARAMETER; break;
-    }	
-}
+	/*verify that the way and lines are valid */
+	M_REQUIRE(cache_way < cache->desc.ways && cache_line_index < cache->desc.lines, ERR_BAD_PARAMETER, "cache way and index have to match %c", ' ');
+	cache_insert_core(cache, &cache->desc, cache_line_index, cache_way, cache_line_in);
+	return ERR_NONE;
+	}
 
 //=========================================================================
 /**
  * initialize an entry with the given parameters
  */
-#define cache_init_entry_with_param(entry, phy_addr, input_line, CACHE_TYPE)            \
+#define cache_init_entry_with_param(entry, phy_addr, input_line, desc)            \
 	(entry)->v = 1;     /* valid when we insert*/                                                                     \
 	(entry)->age = 0;   /* entry age is 0 when we insert*/                                                            \
-	(entry)->tag = phy_addr >> (CACHE_TYPE ## _TAG_REMAINING_BITS);  /*sets the tag depending on the type of the cache*/         \
+	(entry)->dirty = 0; /* clean (as in memory) */                                                                    \
+	(entry)->tag = extract_tag(phy_addr, desc);  /*sets the tag depending on the geometry of the cache*/               \
 	/*copy content of input entry to entry*/                                                                          \
-	memcpy((entry)->line, input_line, (CACHE_TYPE ## _WORDS_PER_LINE)*sizeof(word_t));
+	copy_bytes((entry)->line, input_line, (desc)->words_per_line*sizeof(word_t));
 /**
- * @brief                          : generic helper function for cache_entry_init
- * @param type                     : type of cache
- * @param cache_entry              : entry to init
- * @param phy_addr                 : physical address, to extract the tag
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
+ * @brief                          : generic core of cache_entry_init
  * @param mem_space                : starting address of the memory space
+ * @param phy_addr                 : physical address, to extract the tag
+ * @param entry                    : entry to init
+ * @param desc                     : geometry of the cache
  */
-#define cache_entry_init_generic(type, cache_entry, phy_addr, CACHE_TYPE, mem_space) {     				 \
-	type* entry = cache_entry;                                                                                             				 \
-	uint32_t addr =  compute_addr_line_aligned(phy_addr,CACHE_TYPE) ;    /*get the right word addressed line*/			     \
-	cache_init_entry_with_param(entry, phy_addr,  ((word_t*)(mem_space) + addr), CACHE_TYPE);              \
-}
- 
+CACHE_INLINE void cache_entry_init_core(const void* mem_space, uint32_t phy_addr, cache_entry_t* entry, const cache_desc_t* desc){
+	size_t addr = compute_addr_line_aligned(phy_addr, desc);    /*get the right word addressed line*/
+	cache_init_entry_with_param(entry, phy_addr, ((const word_t*)(mem_space) + addr), desc);
+	}
+
 // ========================================================================
 /**
  * @brief Initialize a cache entry (write to the cache entry for the first time)
@@ -255,356 +535,859 @@ int cache_insert(uint16_t cache_line_index,uint8_t cache_way,const void * cache_
  * @param mem_space starting address of the memory space, must be non null
  * @param paddr pointer to physical address, to extract the tag, must be non null
  * @param cache_entry pointer to the entry to be initialized, must be non null
- * @param cache_type to distinguish between different caches
+ * @param cache the cache the entry is meant for
  * @return  error code
- * 
+ *
  */
-int cache_entry_init(const void * mem_space, const phy_addr_t * paddr,void * cache_entry,cache_t cache_type){
+int cache_entry_init(const void * mem_space, const phy_addr_t * paddr, cache_entry_t * cache_entry, const cache_store_t * cache){
 	M_REQUIRE_NON_NULL(mem_space); //basic checks
 	M_REQUIRE_NON_NULL(paddr);
 	M_REQUIRE_NON_NULL(cache_entry);
-	M_REQUIRE((L1_ICACHE<=cache_type)&&(cache_type <= L2_CACHE),ERR_BAD_PARAMETER,"Wrong instance of cache_type %c",' '); //ctype has to be a part of the enum
-	
-	uint32_t phy_addr = phy_to_int(paddr);
-	switch (cache_type) { //use the generic macro depending on the type of the cache
-		case L1_ICACHE : cache_entry_init_generic(l1_icache_entry_t, cache_entry, phy_addr, L1_ICACHE, mem_space) ; break;
-		case L1_DCACHE : cache_entry_init_generic(l1_dcache_entry_t, cache_entry, phy_addr, L1_DCACHE, mem_space) ; break;
-		case L2_CACHE  : cache_entry_init_generic(l2_cache_entry_t,  cache_entry, phy_addr, L2_CACHE , mem_space) ; break;
-		default: return ERR_BAD_PARAMETER; break; //should not arrive here
-	}
+	M_REQUIRE_NON_NULL(cache);
+	cache_entry_init_core(mem_space, phy_to_int(paddr), cache_entry, &cache->desc);
 	return ERR_NONE;
 	}
 
 //=========================================================================
 //======================== helper functions cache read ====================
 //=========================================================================
-/*flag to say that no empty way has been found */
-#define NOTHING_FOUND (-1)
 /**
- * @brief the generic funcion of find_empty_slot
- * 
- * @param type               : type of cache (l1_icache_entry_t, l1_dcache_entry_t, l2_cache_entry_t)
+ * @brief function that find an empty slot (way) in the cache at the given line or return NOTHING_FOUND
+ *        (among the ways the tenant accessing a partitioned cache may fill, see partition.h)
+ *
  * @param cache : the cache where we need to find the empty slot
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
+ * @param desc : its geometry
  * @param line_index : index of the cache line
  */
-#define find_empty_slot_generic(TYPE, cache, LINE_INDEX, CACHE_TYPE)    {                                           \
-	foreach_way(way, (CACHE_TYPE ## _WAYS)){    /*simply iterate on each way and stop as soon as a invalid cache entry is found*/    \
-		if (!cache_valid(TYPE, (CACHE_TYPE ## _WAYS), LINE_INDEX, way)) {return way;}                                                \
-		}                                                                                                           \
-		return NOTHING_FOUND;                                                                                       \
-	}        
+CACHE_INLINE int find_empty_slot(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index){
+	/*the valid bits of a set are a mask : look for the first 0*/
+	const uint32_t* valids = cache_valids(cache, desc, line_index);
+	if (cache->partition != NULL){
+		const cache_way_mask_t* mask = partition_mask(cache->partition);
+		for (uint32_t way = 0; way < desc->ways; way++){
+			if (!cache_bits_get(valids, way, 1u) && cache_way_in(mask, way)) return (int) way;
+			}
+		return NOTHING_FOUND;
+		}
+	uint32_t empty = cache_bits_first_zero(valids, 0, desc->ways);
+	return empty == desc->ways ? NOTHING_FOUND : (int) empty;
+	}
 /**
- * @brief function that find an empty slot (way) in the cache at the given line or return NOTHING_FOUND
- * 
- * @param cache_type : type of cache
- * @param cache : the cache where we need to find the empty slot
- * @param line_index : index of the cache line
+ * @brief : function that evicts an entry of the given cache at line_index and returns its way
+ *          (chosen by the replacement policy of the cache, see replacement.h, among the ways
+ *          the tenant accessing a partitioned cache may fill)
+ *          its tag, age and line stay readable until the way is reused
+ * @param cache      : cache from which we want to evict
+ * @param desc       : its geometry
+ * @param line_index : index of the line
+ * @param valid      : (modified) the valid state of the evicted entry (1, or CACHE_PREFETCHED)
+ * @param returns the way of the evicted entry or NOTHING_FOUND in case of an error
  */
-int find_empty_slot(cache_t cache_type, void* cache, uint16_t line_index){
-	switch (cache_type){ //use the generic macro depending on the type of the cache
-		case L1_ICACHE: find_empty_slot_generic(l1_icache_entry_t, cache, line_index, L1_ICACHE);break;
-		case L1_DCACHE: find_empty_slot_generic(l1_dcache_entry_t, cache, line_index, L1_DCACHE);break;
-		case L2_CACHE : find_empty_slot_generic(l2_cache_entry_t , cache, line_index, L2_CACHE) ;break;
-		default: return NOTHING_FOUND;break;
-		}
-	} 
-/**
- * @brief generic helper function for evict
- * @param TYPE : type of cache
- * @param LINE_INDEX : index of the line of the cache where we want to evict
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
- * @param returns the evicted entry or NULL in case of an error
- */                                                                                           
-#define evict_generic(TYPE, LINE_INDEX, CACHE_TYPE)    {                                                       \
-	unsigned int max_age = 0 ;                                                                           \
-	TYPE* entry_to_evict = NULL;                                                                         \
-	foreach_way(way, CACHE_TYPE ## _WAYS){ /*iterate on every way to find the entry with max age (LRU)*/                \
-		TYPE* entry = cache_entry(TYPE, CACHE_TYPE ## _WAYS, LINE_INDEX, way);                                          \
-		if (entry->v && entry->age >= max_age) { /*get the entry with the biggest age*/                  \
-		    max_age = entry->age;                                                                        \
-		    entry_to_evict = entry;                                                                      \
-			}                                                                                            \
-		}                                                                                                \
-		if (entry_to_evict != NULL) entry_to_evict->v = 0; /*entry_to_evict should always be != NULL in practice*/   \
-		return entry_to_evict;                                                                           \
-	}
-/**
- * @brief : function that evicts an entry of the given cache at line_index and returns it (with LRU policy)
- * @param cache_type : type of cache
- * @param cache      : cache from which we want to evict 
- * @param line_index : index of the line 
- * @param returns the evicted entry or NULL in case of an error
- */
-void* evict(cache_t cache_type, void* cache, uint16_t line_index) {
-	switch (cache_type){ //use the generic macro depending on the type of the cache
-		case L1_ICACHE: evict_generic(l1_icache_entry_t, line_index, L1_ICACHE);break;
-		case L1_DCACHE: evict_generic(l1_dcache_entry_t, line_index, L1_DCACHE);break;
-		case L2_CACHE : evict_generic(l2_cache_entry_t , line_index, L2_CACHE) ;break;
-		default: return NULL;break;
-		}
-	}
-/**
- * @brief this function updates the ages of the given cache 
- * 
- * @param cache_type : type of cache 
+CACHE_INLINE int evict(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, uint8_t* valid) {
+	int way_to_evict = cache->partition == NULL ? replacement_victim(cache, desc, line_index)
+	                   : replacement_victim_masked(cache, desc, line_index, partition_mask(cache->partition));
+	if (way_to_evict != NOTHING_FOUND){ /*should always be found in practice*/
+		*valid = cache_valid(cache, desc, line_index, way_to_evict);
+		cache_valid_set(cache, desc, line_index, way_to_evict, 0);
+		}
+	return way_to_evict;
+	}
+/**
+ * @brief this function updates the ages of the given cache after an insertion
+ *
  * @param cache      : pointer to the cache that needs to be updated
- * @param way        : way where a place has been found to put the line or NOTHING_FOUND if no place has been found
+ * @param desc       : its geometry
+ * @param way        : way where the line has been inserted
  * @param line_index : index of the line to be updated
+ * @param isColdStart : whether the way was empty
  */
-void modify_ages(cache_t cache_type,void *cache, uint8_t Way, uint16_t Line_index,bool isColdStart){
-	switch (cache_type){
-		case L1_ICACHE: if (!isColdStart) {LRU_age_update(l1_icache_entry_t, L1_ICACHE_WAYS, Way, Line_index) }else {LRU_age_increase(l1_icache_entry_t, L1_ICACHE_WAYS, Way, Line_index);}break;
-		case L1_DCACHE: if (!isColdStart) {LRU_age_update(l1_dcache_entry_t, L1_DCACHE_WAYS, Way, Line_index) }else {LRU_age_increase(l1_dcache_entry_t, L1_DCACHE_WAYS, Way, Line_index);}break;
-		case L2_CACHE : if (!isColdStart) {LRU_age_update(l2_cache_entry_t , L2_CACHE_WAYS , Way, Line_index) }else {LRU_age_increase(l2_cache_entry_t , L2_CACHE_WAYS , Way, Line_index);}break;
-		default         : fprintf(stderr, "wrong instance of mem access at modify ages"); break;
-		}
+CACHE_INLINE void modify_ages(cache_store_t* cache, const cache_desc_t* desc, uint8_t Way, uint16_t Line_index, bool isColdStart){
+	replacement_insert(cache, desc, Line_index, Way, isColdStart);
 	}
 
 /**
- * @brief          : function that inserts an entry in l2 cache
- * @param cache    : L2 cache where we want to insert entry
- * @param entry    : entry to insert
- * @param phy_addr : physical address
- * @return         : error code
+ * @brief : fonction used to recompute old phyaddr for an entry that is evicted from l1 and pushed to l2
+ * @param tag : tag of the L1 entry
+ * @param desc : geometry of the L1 cache
+ * @param index : index of the line where the entry has been placed in  L1
  */
-int insert_level2(l2_cache_entry_t* cache, l2_cache_entry_t* entry, uint32_t phy_addr){
-	uint16_t line_index = extract_line_index(phy_addr, L2_CACHE);
-	int err = ERR_NONE;                                                 //err propagation
-	bool isColdStart = true;
-	int cache_way = find_empty_slot(L2_CACHE, cache, line_index);       //find a place
-	if (cache_way == NOTHING_FOUND){                                    // there is no empty slot in l2 cache => evict
-		l2_cache_entry_t* evicted = evict(L2_CACHE, cache, line_index); //eviction
-		if (evicted == NULL) return ERR_MEM;                            // error propagation
-		entry->age = evicted->age;                                      // prepare for modify_ages
-		isColdStart = false;                                            // if we evict an entry it is no longer a cold start
-		cache_way = find_empty_slot(L2_CACHE, cache, line_index);       //update cache_way with the way where evicted entry was
-		}
-	 //insert in l2 cache (here we are sure that there is at least an empt way)
-	if ((err = cache_insert(line_index,cache_way,entry,cache, L2_CACHE))!= ERR_NONE) return err;//error propagation
-	modify_ages(L2_CACHE, cache, cache_way, line_index, isColdStart);//update ages
-	return ERR_NONE;
+#define recomputeOldPhyAddr(tag, desc, index) ((((uint32_t)(tag))<<((desc)->tag_remaining_bits)) | (((uint32_t)(index))<< (desc)->line_bits))
+/**
+ * @brief write a dirty line of a cache back to memory (its dirty sectors), the line stays valid but clean
+ * @param mem_space  : pointer to the memory space
+ * @param cache      : the cache
+ * @param desc       : its geometry
+ * @param line_index : index of the line
+ * @param way        : way of the line
+ */
+CACHE_INLINE void write_back_line(void * mem_space, cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, uint8_t way){
+	uint8_t dirty = (uint8_t) cache_dirty(cache, desc, line_index, way);
+	store_memory(mem_space, cache, recomputeOldPhyAddr(cache_tag(cache, desc, line_index, way), desc, line_index),
+	             cache_line(cache, desc, line_index, way), sector_words(desc, dirty), desc);
+	cache_dirty_set(cache, desc, line_index, way, 0);
+	cache->counters.writebacks++;
+	if (sectored(desc)) cache->sectors.writebacks += (uint64_t) __builtin_popcount(dirty);
 	}
 
 /**
- * constant used in the L1-L2 convertion entry in case of an eviction from L1
+ * @brief record a lookup of a cache in its miss classifier, if it has one
  */
-#define SHIFT_BITS_CAST_TAG_L1_TO_L2 3
+#define classify_lookup(cache, phy_addr, hit) \
+	do { if ((cache)->mclass != NULL) miss_class_access((cache)->mclass, phy_addr, hit); } while (0)
+
 /**
- * = TAG_REMAINING_BITS - LINE_REMAINING_BITS and is always equals to 4 for all caches
+ * @brief count a fill of a cache for the tenant accessing it, if it is partitioned
  */
-#define TAG_AND_LINE_INDEX_REMAINING_BITS 4
+#define count_partition(cache, evicted) \
+	do { if ((cache)->partition != NULL) partition_fill((cache)->partition, evicted); } while (0)
+
+#define CACHE_PATH_LEVELS (CACHE_MAX_LEVELS + 1) // the levels of a hierarchy, and the victim cache of its L1
+#define VICTIM_LEVEL 1u // level of a path taken by the victim cache of its L1, if any
+
 /**
- * @brief : fonction used to recompute old phyaddr for an entry that is evicted from l1 and pushed to l2
- * @param tag : tag of the L1 entry
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
- * @param index : index of the line where the entry has been placed in  L1
+ * path of an access through a hierarchy : the cache of each level looked up by the access
+ * (L1 ICACHE or L1 DCACHE, its victim cache if any, then the next levels) and its geometry
+ *  - victim    : whether level VICTIM_LEVEL is the victim cache of the L1
+ *  - inclusion : the inclusion policy of the hierarchy
+ *  - sibling   : the other cache of each split level (not looked up by the access), NULL for a unified one
  */
-#define recomputeOldPhyAddr(tag, CACHE_TYPE, index) ((((uint32_t)(tag))<<(CACHE_TYPE ## _TAG_REMAINING_BITS)) | (((uint32_t)(index))<< TAG_AND_LINE_INDEX_REMAINING_BITS))
+typedef struct {
+	size_t levels;
+	cache_store_t* cache[CACHE_PATH_LEVELS];
+	const cache_desc_t* desc[CACHE_PATH_LEVELS];
+	bool victim;
+	cache_inclusion_t inclusion;
+	cache_store_t* sibling[CACHE_PATH_LEVELS];
+	} cache_path_t;
+
 /**
- * @brief          : function that inserts a L1 entry into l1_cache (and deal with eviction if needed)
- * @param access   : to distinguish between fetching instructions and reading/writing data
- * @param l1_cache : pointer to the beginning of L1 CACHE
- * @param l2_cache : pointer to the beginning of L2 CACHE
- * @param entry    : pointer to the entry to be inserted in L1_cache
- * @param phy_addr : physical address
- * @return         : error code
+ * @brief path through an L1 and an L2 cache, described by D1 and D2 (see cache_read) : an exclusive hierarchy
  */
-int insert_level1(mem_access_t access,void * l1_cache, void * l2_cache, void* entry, uint32_t phy_addr){
-	
-	int err = ERR_NONE;
-	cache_t cache_type = (access == INSTRUCTION) ? L1_ICACHE: L1_DCACHE;
-	bool isColdStart = true;
-	uint16_t line_index = (access == INSTRUCTION) ? extract_line_index(phy_addr, L1_ICACHE): extract_line_index(phy_addr, L1_DCACHE);
-	int cache_way = find_empty_slot(cache_type, l1_cache, line_index); //find a place
-	if (cache_way == NOTHING_FOUND){// there is no empty slot in l1 cache => evict an entry and move it to L2
-		void* evicted_entry = evict(cache_type, l1_cache, line_index); //eviction
-		if (evicted_entry == NULL) return ERR_MEM; // error propagation 
-		uint32_t oldPhyAddr = (access == INSTRUCTION)? recomputeOldPhyAddr(cast_l1_entry(access,evicted_entry)->tag, L1_ICACHE, line_index ) : recomputeOldPhyAddr(cast_l1_entry(access,evicted_entry)->tag, L1_DCACHE, line_index );
-		l2_cache_entry_t l2_entry; // cast evicted_entry to an l2 entry
-		cache_init_entry_with_param(&l2_entry, oldPhyAddr, cast_l1_entry(access,evicted_entry)->line, L2_CACHE);
-		// move entry to level 2
-		if ((err = insert_level2((l2_cache_entry_t*)l2_cache, &l2_entry, oldPhyAddr))!= ERR_NONE) return err; //error propagation
-		cast_l1_entry(access,entry)->age = cast_l1_entry(access, evicted_entry)->age; //prepare for modifying ages policy 
-		isColdStart = false; // if we evict an entry it is no longer a cold start
-		cache_way = find_empty_slot(cache_type, l1_cache, line_index); //update cache_way with the way where evicted entry was
-		}
-    //insert in l1 cache (here we are sure that there is at least an empt way)
-    if ((err = cache_insert(line_index,cache_way, cast_l1_entry(access,entry), l1_cache,cache_type))!= ERR_NONE) return err; // error propagation
-	modify_ages(cache_type,l1_cache, cache_way,line_index, isColdStart);//update ages
-	return ERR_NONE;
-	} 
-//====================================================================================================
+#define two_levels(L1, D1, L2, D2) { 2, { L1, L2 }, { D1, D2 }, false, CACHE_EXCLUSIVE, { NULL, NULL } }
+
 /**
- * @brief this the generic function corresponding to move_entry_to_level1
- * 
- * @param access             : used to distinguish between fetching instructions and reading/writing data
- * @param type               : type of cache entry (l1_icache_entry_t, l1_dcache_entry_t, l2_cache_entry_t)
- * @param l1_cache           : pointer to the beginning of L1 CACHE
- * @param l2_cache           : pointer to the beginning of L2 CACHE
- * @param l2_entry           : the entry that needs to be moved from l2 to l1
- * @param phy_addr           : the physical address
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
- * @return error code
+ * @brief level of a path taken by a level of the hierarchy (0 : L1)
  */
-#define move_entry_to_level1_generic(access, type, l2_entry, l1_cache, l2_cache, phy_addr, CACHE_TYPE)     \
-	type l1_entry;    /*create L1 entry for casting form l2_entry*/                                                \
-	/* cast it */                                                                                                  \
-	cache_init_entry_with_param(&l1_entry, phy_addr, l2_entry->line, CACHE_TYPE)                                    \
-	/* insert new entry in l1_cache and if needed, do the error propagation*/                                      \
-	int err = ERR_NONE; 																					  	   \
-	(l2_entry)->v = 0;      /*invalidate l2_entry*/                                                                \
-	if ((err = insert_level1(access,l1_cache, l2_cache, &l1_entry, phy_addr))!= ERR_NONE) return err; 
-
-/**
- * @brief this function moves an entry from l2 cache to l1 cache
- * 
- * @param access   :used to distinguish between fetching instructions and reading/writing data
- * @param l1_cache :pointer to the beginning of L1 CACHE
- * @param l2_cache : pointer to the beginning of L2 CACHE
- * @param l2_entry : the entry that needs to be moved from l2 to l1
- * @param phy_addr :the physical address
- * @return error code
+#define path_level(path, LEVEL) ((LEVEL) + ((path)->victim && (LEVEL) >= VICTIM_LEVEL))
+
+/**
+ * @brief insert the victim cache of the L1 of a path, if it has one, right below the L1
  */
-int move_entry_to_level1(mem_access_t access,void * l1_cache, void * l2_cache, l2_cache_entry_t* l2_entry, const uint32_t phy_addr){
-	switch(access){ //use the generic macro depending on the type of the cache
-		case INSTRUCTION: {move_entry_to_level1_generic(access, l1_icache_entry_t, l2_entry,l1_cache, l2_cache, phy_addr, L1_ICACHE);}break;
-		case DATA       : {move_entry_to_level1_generic(access, l1_dcache_entry_t, l2_entry,l1_cache, l2_cache, phy_addr, L1_DCACHE);}break;
-		default: return ERR_BAD_PARAMETER; break;
+CACHE_INLINE void with_victim(cache_path_t* path){
+	victim_cache_t* victim = path->cache[0]->victim;
+	path->victim = victim != NULL;
+	if (victim == NULL) return;
+	for (size_t level = path->levels; level > VICTIM_LEVEL; level--){
+		path->cache[level] = path->cache[level - 1];
+		path->desc[level] = path->desc[level - 1];
+		path->sibling[level] = path->sibling[level - 1];
 		}
-
-	return ERR_NONE;
+	path->cache[VICTIM_LEVEL] = &victim->store;
+	path->desc[VICTIM_LEVEL] = &victim->store.desc;
+	path->sibling[VICTIM_LEVEL] = NULL;
+	path->levels++;
 	}
-// ========================================================================
+
 /**
- * @brief generic helper function for search_in_memory_and_affect
- * 
- * @param type               : type of cache entry (l1_icache_entry_t, l1_dcache_entry_t, l2_cache_entry_t)
- * @param cache_type         : corresponds to an instance of the enum cache_type_t (L1_DCACHE_...)
- * @param CACHE_TYPE         : type of cache (in caps like L1_DCACHE, L1_ICACHE, L2_CACHE)
+ * ways taken by a line filled into a level of a path : the way given to the line at the first level,
+ * then, level by level, the way given to the line evicted from the level above, up to the last level
+ * of the chain (an empty way, a copy of the line already there, or a line leaving the hierarchy).
+ * The lines are then moved directly from way to way, from the last level up (see fill_chain).
+ *  - first, last : levels of the chain
+ *  - index, way  : set and way taken at each level
+ *  - addr        : physical address of the line coming in at each level
+ *  - evicted     : whether the way held a line, evicted to make room
+ *  - valid       : the valid byte of that line (1, or CACHE_PREFETCHED)
+ *  - copy_found  : (write-back) the line coming in the last level was already there, in way
+ *                  (both caches of a split level held it) : a single copy is kept, the dirty one if any
  */
-#define search_in_memory_and_affect_generic(type, CACHE_TYPE) {                                           \
-	type entry;                                                                                                                                         \
-	if ((err = cache_entry_init(mem_space,paddr,&entry,CACHE_TYPE))!= ERR_NONE) return err; /*error propagation, init the entry from memory*/           \
-	if ((err = insert_level1(access,l1_cache, l2_cache, &entry,phy_addr))!= ERR_NONE) return err; /*error propagation, insert the entry in memory*/     \
-	*word = entry.line[extract_word_index(phy_addr,CACHE_TYPE)]; /*sets the word using the entry*/                                                  \
-	}
+typedef struct {
+	size_t first;
+	size_t last;
+	uint16_t index[CACHE_PATH_LEVELS];
+	uint8_t way[CACHE_PATH_LEVELS];
+	uint32_t addr[CACHE_PATH_LEVELS];
+	bool evicted[CACHE_PATH_LEVELS];
+	uint8_t valid[CACHE_PATH_LEVELS];
+	bool copy_found;
+	} fill_chain_t;
+
 /**
- * @brief search the cache line in memory and insert it in level 1 cache and affect word
- * 
- * @param access to distinguish between fetching instructions and reading/writing data
- * @param word pointer to the word of data that is returned by cache
- * @param mem_space pointer to the memory space
- * @param paddr pointer to a physical address
- * @param phy_addr : phy_addr casted in uint32
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @brief          : choose the ways of a fill (see fill_chain_t) : an empty way of each set, or the
+ *                   one of the line evicted to make room, which then goes down one level
+ *                   (the evicted lines stay readable until their way is reused)
+ * @param path     : the caches
+ * @param level    : the level where the line is filled (L1 for the demand accesses)
+ * @param phy_addr : its physical address
+ * @param empty    : first invalid way of its set, as given by its probe (NOTHING_FOUND if it is full),
+ *                   looked for again in a partitioned cache
+ * @param write_back : whether the caches are write-back
+ * @param chain    : (modified) the ways
+ * @return         : error code
  */
-int search_in_memory_and_affect(mem_access_t access, uint32_t * word, phy_addr_t * paddr, uint32_t phy_addr, const void* mem_space, void * l1_cache, void * l2_cache){
-	int err = ERR_NONE;
-	switch (access){
-		case INSTRUCTION: search_in_memory_and_affect_generic(l1_icache_entry_t, L1_ICACHE);break;
-		case DATA       : search_in_memory_and_affect_generic(l1_dcache_entry_t, L1_DCACHE);break;
-		default         : return ERR_BAD_PARAMETER; break;
+CACHE_INLINE int plan_fill(const cache_path_t* path, size_t level, uint32_t phy_addr, int empty, bool write_back, fill_chain_t* chain){
+	chain->first = level;
+	chain->copy_found = false;
+	for (size_t l = level; ; l++){
+		cache_store_t* cache = path->cache[l];
+		const cache_desc_t* desc = path->desc[l];
+		uint16_t line_index = (uint16_t) extract_line_index(phy_addr, desc);
+		chain->last = l;
+		chain->index[l] = line_index;
+		chain->addr[l] = phy_addr;
+		if (l > level){
+			if (write_back){ // the victim may already be in this level : keep a single copy
+				size_t first_invalid;
+				size_t way = probe_set(cache_tags(cache, desc, line_index), cache_valids(cache, desc, line_index), desc->ways,
+				                       extract_tag(phy_addr, desc), &first_invalid);
+				if (way != desc->ways){
+					chain->way[l] = (uint8_t) way;
+					chain->copy_found = true;
+					return ERR_NONE;
+					}
+				}
+			}
+		if (l > level || cache->partition != NULL) empty = find_empty_slot(cache, desc, line_index);
+		chain->evicted[l] = empty == NOTHING_FOUND;
+		if (empty != NOTHING_FOUND){
+			chain->way[l] = (uint8_t) empty;
+			return ERR_NONE;
+			}
+		int evicted = evict(cache, desc, line_index, &chain->valid[l]); //eviction
+		if (evicted == NOTHING_FOUND) return ERR_MEM;
+		chain->way[l] = (uint8_t) evicted;
+		if (l + 1 >= path->levels) return ERR_NONE; // the victim leaves the hierarchy
+		phy_addr = recomputeOldPhyAddr(cache_tag(cache, desc, line_index, evicted), desc, line_index);
 		}
-	return ERR_NONE;
 	}
-//=========================================================================
+
 /**
- * @brief Ask cache for a word of data.
- *  Exclusive policy (https://en.wikipedia.org/wiki/Cache_inclusion_policy)
- *      Consider the case when L2 is exclusive of L1. Suppose there is a
- *      processor read request for block X. If the block is found in L1 cache,
- *      then the data is read from L1 cache and returned to the processor. If
- *      the block is not found in the L1 cache, but present in the L2 cache,
- *      then the cache block is moved from the L2 cache to the L1 cache. If
- *      this causes a block to be evicted from L1, the evicted block is then
- *      placed into L2. This is the only way L2 gets populated. Here, L2
- *      behaves like a victim cache. If the block is not found in both L1 and
- *      L2, then it is fetched from main memory and placed just in L1 and not
- *      in L2.
- *
- * @param mem_space pointer to the memory space
- * @param paddr pointer to a physical address
- * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
- * @param word pointer to the word of data that is returned by cache
- * @param replace replacement policy
- * @return  error code
+ * @brief          : move the lines of a fill planned by plan_fill, from the last level of the chain up :
+ *                   each line is copied directly from its way to the one it takes in the next level, once
+ *                   that one has been freed ; a line leaving the hierarchy is written back if dirty.
+ *                   The lines going through the victim cache of the L1 are counted there.
+ *                   The way of the filled line is then prepared (tag, valid and clean, all its sectors valid, ages updated).
+ * @param mem_space : pointer to the memory space (for write-backs)
+ * @param path     : the caches
+ * @param chain    : the ways of the fill
+ * @return         : the filled way, whose line is for the caller to fill in
  */
-int cache_read(const void * mem_space,phy_addr_t * paddr, mem_access_t access,
-               void * l1_cache, void * l2_cache, uint32_t * word, cache_replace_t replace){
-	M_REQUIRE_NON_NULL(mem_space);
-	M_REQUIRE_NON_NULL(paddr);
-	M_REQUIRE_NON_NULL(l1_cache);
-	M_REQUIRE_NON_NULL(l2_cache);
-	M_REQUIRE_NON_NULL(word);
-	M_REQUIRE(replace == LRU, ERR_BAD_PARAMETER, "replace is not a valid instance of cache_replace_t %c", ' ');
-	M_REQUIRE(access == INSTRUCTION || access == DATA, ERR_BAD_PARAMETER, "access is not a valid instance of mem_access_t %c", ' ');
-	M_REQUIRE((paddr->page_offset % sizeof(word_t)) == 0, ERR_BAD_PARAMETER, "paddr should be word aligned for cache_read  %c",' ');
-
-	int err = ERR_NONE; // used to propagate errors
-	uint32_t phy_addr = phy_to_int(paddr);
-	const uint32_t * p_line = 0;
-	uint8_t hit_way = 0;
-	uint16_t hit_index = 0;
-	
-	if ((err = cache_hit(mem_space, l1_cache, paddr,&p_line,&hit_way,&hit_index, to_l1_cache(access))) != ERR_NONE) return err;//error handling, check if word is in l1
-	if  (hit_way != HIT_WAY_MISS){//if found found in level 1 nothing to be done, just affect word
-		*word = p_line[(access == INSTRUCTION) ? extract_word_index(phy_addr, L1_ICACHE) : extract_word_index(phy_addr, L1_DCACHE) ]; //set word since we found it in either l1_i or l1_d
-		}
-	else{//not found in l1 => search in l2
-		if((err = cache_hit(mem_space, l2_cache, paddr,&p_line,&hit_way,&hit_index, L2_CACHE)) != ERR_NONE) return err; //check if it is in l2, error propagate
-		if (hit_way != HIT_WAY_MISS) { // found in level 2 => move entry to level 1 and affect word
-			*word = p_line[extract_word_index(phy_addr,L2_CACHE)];
-			if ((err = move_entry_to_level1(access,l1_cache, l2_cache, cache_entry_any(l2_cache_entry_t, L2_CACHE_WAYS, hit_index, hit_way, l2_cache), phy_addr))!= ERR_NONE){return err;}//error propagation
+CACHE_INLINE uint8_t fill_chain(void * mem_space, const cache_path_t* path, const fill_chain_t* chain){
+	for (size_t l = chain->last; l > chain->first; l--){
+		cache_store_t* cache = path->cache[l];
+		const cache_desc_t* desc = path->desc[l];
+		cache_store_t* above = path->cache[l - 1];
+		const cache_desc_t* desc_above = path->desc[l - 1];
+		uint16_t index = chain->index[l], index_above = chain->index[l - 1];
+		uint8_t way = chain->way[l], way_above = chain->way[l - 1];
+		uint8_t dirty = cache_dirty(above, desc_above, index_above, way_above); // a dirty line stays dirty in the next level
+		uint8_t sectors = line_sectors(above, desc_above, index_above, way_above); // and keeps its sectors
+		if (chain->copy_found && l == chain->last){
+			if (dirty){ // the sectors of the copy above are the most recent
+				copy_sectors(cache_line(cache, desc, index, way), cache_line(above, desc_above, index_above, way_above), desc, sectors);
+				cache_valid_set(cache, desc, index, way, chain->valid[l - 1]);
+				cache_age_set(cache, desc, index, way, 0);
+				cache_dirty_set(cache, desc, index, way, cache_dirty(cache, desc, index, way) | dirty);
+				set_line_sectors(cache, desc, index, way, line_sectors(cache, desc, index, way) | sectors);
+				}
+			replacement_touch(cache, desc, index, way);
+			continue;
 			}
-		else { // not found in L2 => search in memory
-			search_in_memory_and_affect(access, word, paddr, phy_addr, mem_space, l1_cache, l2_cache);
+		cache->inclusion.fills++;
+		cache->inclusion.victim_fills++;
+		if (chain->evicted[l]) cache->inclusion.evictions++;
+		count_partition(cache, chain->evicted[l]);
+		if (path->victim && l == VICTIM_LEVEL){ // a line evicted from the L1 goes into its victim cache
+			cache_victim_counters_t* counters = &path->cache[0]->victim->counters;
+			counters->fills++;
+			if (chain->evicted[l]) counters->evictions++;
 			}
+		if (chain->evicted[l] && l + 1 >= path->levels && cache_dirty(cache, desc, index, way)) // the line leaves the hierarchy
+			write_back_line(mem_space, cache, desc, index, way);
+		copy_bytes(cache_line(cache, desc, index, way), cache_line(above, desc_above, index_above, way_above), desc->line_bytes);
+		cache_valid_set(cache, desc, index, way, chain->valid[l - 1]); // a prefetched line not used yet stays so
+		cache_dirty_set(cache, desc, index, way, dirty);
+		set_line_sectors(cache, desc, index, way, sectors);
+		cache_tag(cache, desc, index, way) = extract_tag(chain->addr[l], desc);
+		if (!chain->evicted[l]) cache_age_set(cache, desc, index, way, 0);
+		modify_ages(cache, desc, way, index, !chain->evicted[l]);
 		}
-	return ERR_NONE;
+	size_t l = chain->first;
+	cache_store_t* cache = path->cache[l];
+	const cache_desc_t* desc = path->desc[l];
+	uint16_t index = chain->index[l];
+	uint8_t way = chain->way[l];
+	if (chain->evicted[l] && l + 1 >= path->levels && cache_dirty(cache, desc, index, way))
+		write_back_line(mem_space, cache, desc, index, way);
+	cache->inclusion.fills++;
+	if (chain->evicted[l]) cache->inclusion.evictions++;
+	count_partition(cache, chain->evicted[l]);
+	cache_valid_set(cache, desc, index, way, 1);
+	cache_dirty_set(cache, desc, index, way, 0);
+	set_line_sectors(cache, desc, index, way, all_sectors(desc));
+	cache_tag(cache, desc, index, way) = extract_tag(chain->addr[l], desc);
+	if (!chain->evicted[l]) cache_age_set(cache, desc, index, way, 0);
+	modify_ages(cache, desc, way, index, !chain->evicted[l]);
+	return way;
+	}
 
-}
-//=========================================================================
 /**
- * /!\ used for read_bytes and write_bytes
- * 
- * @brief : function that compute word aligned p_addr and cast the resulting word into a byte_t pointer
- * @param ACCESS : memory access, DATA or INSTRUCTION
- * @param P_ADDR : P_ADDR : physical address that needs to be word_aligned
+ * @brief          : make room for a line in a level of the hierarchy (see plan_fill and fill_chain),
+ *                   the lines evicted going down the path
+ * @param way      : (modified) the way taken in the set of phy_addr, whose line is to be filled in by the caller
+ * @return         : error code
  */
-#define cache_read_deal_with_bytes(ACCESS, P_ADDR) {                                                               \
-	byte_index = P_ADDR->page_offset % sizeof(word_t);  /*index of the byte inside of the word*/                   \
-	phy_addr = *P_ADDR;                                 /*value of paddr from pointer*/                            \
-	phy_addr.page_offset -= byte_index;                 /*remove the byte index to use cache read*/                \
-	if ((err = cache_read(mem_space,&phy_addr, ACCESS,l1_cache, l2_cache, &word, replace)) != ERR_NONE) return err;\
-													    /*error propagation, read word from memory*/               \
-	word_as_byte = (byte_t*)&word;                      /*cast to byte to get the byte we want only*/              \
-    }
-//=========================================================================
+CACHE_INLINE int insert_level(void * mem_space, const cache_path_t* path, size_t level, uint32_t phy_addr, int empty, bool write_back,
+                              uint8_t* way){
+	fill_chain_t chain;
+	int err = plan_fill(path, level, phy_addr, empty, write_back, &chain);
+	if (err != ERR_NONE) return err;
+	*way = fill_chain(mem_space, path, &chain);
+	return ERR_NONE;
+	}
+//====================================================================================================
 /**
- * @brief Ask cache for a byte of data. Endianess: LITTLE.
+ * @brief this function moves an entry from a level of the hierarchy to level 1
+ *        (directly, unless the line evicted down to that level takes its way : it then goes through a copy)
  *
- * @param mem_space pointer to the memory space
- * @param p_addr pointer to a physical address
- * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_icache pointer to the beginning of L1 ICACHE
- * @param l1_dcache pointer to the beginning of L1 DCACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
- * @param byte pointer to the byte to be returned
- * @param replace replacement policy
- * @return  error code
+ * @param path     : the caches
+ * @param level    : the level of the entry that needs to be moved to l1
+ * @param index    : its line index
+ * @param way      : its way
+ * @param phy_addr :the physical address
+ * @param l1_empty : first invalid way of the L1 set (see insert_level)
+ * @param mem_space : pointer to the memory space (for write-backs)
+ * @param write_back : whether the caches are write-back
+ * @return error code
+ */
+CACHE_INLINE int move_entry_to_level1(const cache_path_t* path, size_t level, uint16_t index, uint8_t way, const uint32_t phy_addr,
+                                      int l1_empty, void * mem_space, bool write_back){
+	cache_store_t* cache = path->cache[level];
+	const cache_desc_t* desc = path->desc[level];
+	uint8_t dirty = cache_dirty(cache, desc, index, way);       /* a dirty line stays dirty in L1*/
+	uint8_t sectors = line_sectors(cache, desc, index, way);    /* with its sectors */
+	cache_valid_set(cache, desc, index, way, 0);                /*invalidate the entry of the level*/
+	cache->inclusion.promotions++;
+	fill_chain_t chain;
+	int err = plan_fill(path, 0, phy_addr, l1_empty, write_back, &chain);
+	if (err != ERR_NONE) return err;
+	const word_t* src = cache_line(cache, desc, index, way);
+	word_t spare[CACHE_MAX_WORDS_PER_LINE];
+	if (chain.last >= level && chain.index[level] == index && chain.way[level] == way){ // the lines swap places
+		copy_bytes(spare, src, desc->line_bytes);
+		src = spare;
+		}
+	uint8_t l1_way = fill_chain(mem_space, path, &chain);
+	copy_bytes(cache_line(path->cache[0], path->desc[0], chain.index[0], l1_way), src, path->desc[0]->line_bytes);
+	cache_dirty_set(path->cache[0], path->desc[0], chain.index[0], l1_way, dirty);
+	set_line_sectors(path->cache[0], path->desc[0], chain.index[0], l1_way, sectors);
+	return ERR_NONE;
+	}
+// ========================================================================
+/**
+ * @brief copy LENGTH bytes of a line, from the one of phy_addr
+ */
+#define copy_from_line(bytes, line, phy_addr, desc, LENGTH) \
+	copy_bytes(bytes, (const uint8_t*) (line) + ((phy_addr) & ((desc)->line_bytes - 1)), LENGTH)
+
+/**
+ * @brief copy LENGTH bytes into a line, from the one of phy_addr
+ */
+#define copy_to_line(line, phy_addr, desc, bytes, LENGTH) \
+	copy_bytes((uint8_t*) (line) + ((phy_addr) & ((desc)->line_bytes - 1)), bytes, LENGTH)
+
+/**
+ * @brief mask of the words of a line (see store_memory) holding the LENGTH bytes from the one of phy_addr
+ */
+#define range_words(phy_addr, desc, LENGTH)                                                                      \
+	((all_words(desc) >> ((desc)->words_per_line - 1 - ((((phy_addr) & ((desc)->line_bytes - 1)) + (LENGTH) - 1) / sizeof(word_t)))) \
+	 & ~(((uint64_t) 1 << extract_word_index(phy_addr, desc)) - 1))
+
+//================================ inclusive and NINE hierarchies ================================
+/**
+ * @brief way of the line of phy_addr in the set index of a cache, desc->ways if it is not there
+ */
+CACHE_INLINE size_t find_line(cache_store_t* cache, const cache_desc_t* desc, uint32_t phy_addr, uint16_t index){
+	size_t first_invalid;
+	return probe_set(cache_tags(cache, desc, index), cache_valids(cache, desc, index), desc->ways, extract_tag(phy_addr, desc), &first_invalid);
+	}
+
+/**
+ * @brief (inclusive, NINE) a dirty line leaves a level : its data goes into the closest copy of the line
+ *        below the level, which becomes dirty, or back to memory if there is none
+ */
+CACHE_INLINE void spill_line(void * mem_space, const cache_path_t* path, size_t level, uint16_t index, uint8_t way){
+	cache_store_t* cache = path->cache[level];
+	const cache_desc_t* desc = path->desc[level];
+	uint32_t line_addr = recomputeOldPhyAddr(cache_tag(cache, desc, index, way), desc, index);
+	for (size_t l = level + 1; l < path->levels; l++){
+		cache_store_t* lower = path->cache[l];
+		const cache_desc_t* d = path->desc[l];
+		uint16_t i = (uint16_t) extract_line_index(line_addr, d);
+		size_t w = find_line(lower, d, line_addr, i);
+		if (w != d->ways){
+			copy_bytes(cache_line(lower, d, i, w), cache_line(cache, desc, index, way), desc->line_bytes);
+			cache_dirty_set(lower, d, i, w, 1);
+			cache_dirty_set(cache, desc, index, way, 0);
+			return;
+			}
+		}
+	write_back_line(mem_space, cache, desc, index, way);
+	}
+
+/**
+ * @brief (inclusive) a line is evicted from a level : invalidate its copies in the caches of the levels
+ *        above it (both caches of a split level), the data of a dirty one going into the evicted line
+ *        (the closer to L1, the more recent)
+ */
+CACHE_INLINE void back_invalidate(const cache_path_t* path, size_t level, uint16_t index, uint8_t way){
+	cache_store_t* cache = path->cache[level];
+	const cache_desc_t* desc = path->desc[level];
+	uint32_t line_addr = recomputeOldPhyAddr(cache_tag(cache, desc, index, way), desc, index);
+	for (size_t l = level; l-- > 0; ){
+		for (int side = 0; side < 2; side++){
+			cache_store_t* upper = side == 0 ? path->cache[l] : path->sibling[l];
+			if (upper == NULL) continue;
+			const cache_desc_t* d = side == 0 ? path->desc[l] : &upper->desc;
+			uint16_t i = (uint16_t) extract_line_index(line_addr, d);
+			size_t w = find_line(upper, d, line_addr, i);
+			if (w == d->ways) continue;
+			if (cache_dirty(upper, d, i, w)){
+				copy_bytes(cache_line(cache, desc, index, way), cache_line(upper, d, i, w), desc->line_bytes);
+				cache_dirty_set(cache, desc, index, way, 1);
+				}
+			cache_valid_set(upper, d, i, w, 0);
+			cache_dirty_set(upper, d, i, w, 0);
+			upper->inclusion.back_invalidations++;
+			}
+		}
+	}
+
+/**
+ * @brief (inclusive, NINE) make room for the line of phy_addr in a level which does not hold it :
+ *        an empty way, or the one of a line evicted (invalidated above it under the inclusive policy,
+ *        then spilled if dirty). The way is prepared (tag, valid and clean, ages updated).
+ * @param way (modified) the way, whose line is for the caller to fill in
+ * @return error code
+ */
+CACHE_INLINE int place_line(void * mem_space, const cache_path_t* path, size_t level, uint32_t phy_addr, uint8_t* way){
+	cache_store_t* cache = path->cache[level];
+	const cache_desc_t* desc = path->desc[level];
+	uint16_t index = (uint16_t) extract_line_index(phy_addr, desc);
+	int empty = find_empty_slot(cache, desc, index);
+	bool evicted = empty == NOTHING_FOUND;
+	if (evicted){
+		uint8_t valid = 0;
+		if ((empty = evict(cache, desc, index, &valid)) == NOTHING_FOUND) return ERR_MEM;
+		cache->inclusion.evictions++;
+		if (path->inclusion == CACHE_INCLUSIVE) back_invalidate(path, level, index, (uint8_t) empty);
+		if (cache_dirty(cache, desc, index, empty)) spill_line(mem_space, path, level, index, (uint8_t) empty);
+		}
+	*way = (uint8_t) empty;
+	cache->inclusion.fills++;
+	count_partition(cache, evicted);
+	cache_valid_set(cache, desc, index, *way, 1);
+	cache_dirty_set(cache, desc, index, *way, 0);
+	cache_tag(cache, desc, index, *way) = extract_tag(phy_addr, desc);
+	if (!evicted) cache_age_set(cache, desc, index, *way, 0);
+	modify_ages(cache, desc, *way, index, !evicted);
+	return ERR_NONE;
+	}
+
+/**
+ * @brief (inclusive, NINE) copy the line of phy_addr, held at (index, way) of level from, into the levels
+ *        from - 1 up to level to, from the lowest one up. Its dirty bit follows it to level to.
+ * @param way (modified) its way in level to
+ * @return error code
+ */
+CACHE_INLINE int copy_up(void * mem_space, const cache_path_t* path, size_t from, size_t to, uint32_t phy_addr, uint16_t index, uint8_t* way){
+	bool dirty = cache_dirty(path->cache[from], path->desc[from], index, *way);
+	cache_dirty_set(path->cache[from], path->desc[from], index, *way, 0);
+	for (size_t l = from; l-- > to; ){
+		const cache_desc_t* desc = path->desc[l];
+		uint16_t i = (uint16_t) extract_line_index(phy_addr, desc);
+		uint8_t w = 0;
+		int err = place_line(mem_space, path, l, phy_addr, &w);
+		if (err != ERR_NONE) return err;
+		copy_bytes(cache_line(path->cache[l], desc, i, w), cache_line(path->cache[l + 1], path->desc[l + 1], index, *way), desc->line_bytes);
+		index = i;
+		*way = w;
+		}
+	cache_dirty_set(path->cache[to], path->desc[to], index, *way, dirty);
+	return ERR_NONE;
+	}
+
+/**
+ * @brief (inclusive, NINE) fetch the line of phy_addr from memory into the levels from the last one up
+ *        to level to, its read being counted for the last level (a demand one) if counted
+ * @param way (modified) its way in level to
+ * @return error code
+ */
+CACHE_INLINE int fill_from_memory(void * mem_space, const cache_path_t* path, size_t to, uint32_t phy_addr, bool counted, uint8_t* way){
+	size_t last = path->levels - 1;
+	cache_store_t* cache = path->cache[last];
+	const cache_desc_t* desc = path->desc[last];
+	uint16_t index = (uint16_t) extract_line_index(phy_addr, desc);
+	int err = place_line(mem_space, path, last, phy_addr, way);
+	if (err != ERR_NONE) return err;
+	load_memory(mem_space, cache, phy_addr, cache_line(cache, desc, index, *way), desc);
+	if (counted) cache->counters.mem_reads++;
+	return copy_up(mem_space, path, last, to, phy_addr, index, way);
+	}
+
+/**
+ * @brief (inclusive, NINE) a write-through store : update the copies of its line below L1
+ */
+CACHE_INLINE void write_lower_copies(const cache_path_t* path, uint32_t phy_addr, const uint8_t * bytes, size_t length){
+	for (size_t l = 1; l < path->levels; l++){
+		cache_store_t* cache = path->cache[l];
+		const cache_desc_t* desc = path->desc[l];
+		uint16_t index = (uint16_t) extract_line_index(phy_addr, desc);
+		size_t way = find_line(cache, desc, phy_addr, index);
+		if (way != desc->ways) copy_to_line(cache_line(cache, desc, index, way), phy_addr, desc, bytes, length);
+		}
+	}
+
+// ========================================================================
+/**
+ * @brief search the cache line in memory and insert it in level 1 cache and affect bytes
+ *
+ * @param bytes the bytes of data that are returned by cache
+ * @param length their number (they are all in the line of phy_addr)
+ * @param phy_addr : phy_addr casted in uint32, address of the first byte
+ * @param mem_space pointer to the memory space
+ * @param path the caches
+ * @param l1_empty first invalid way of the L1 set (see insert_level)
+ * @param write_back whether the caches are write-back
+ */
+CACHE_INLINE int search_in_memory_and_affect(uint8_t * bytes, size_t length, uint32_t phy_addr, void* mem_space, const cache_path_t* path,
+                                             int l1_empty, bool write_back){
+	int err = ERR_NONE;
+	cache_store_t* l1_cache = path->cache[0];
+	const cache_desc_t* d1 = path->desc[0];
+	uint8_t way = 0;
+	if ((err = insert_level(mem_space, path, 0, phy_addr, l1_empty, write_back, &way))!= ERR_NONE) return err; /*error propagation, make room in L1*/
+	uint16_t line_index = (uint16_t) extract_line_index(phy_addr, d1);
+	word_t* line = cache_line(l1_cache, d1, line_index, way);
+	load_memory(mem_space, l1_cache, phy_addr, line, d1); /*read the line from memory, in place*/
+	l1_cache->counters.mem_reads++;
+	fill_sectors(l1_cache, d1, line_index, way, range_sectors(phy_addr, d1, length)); /*only the sectors read are valid*/
+	copy_from_line(bytes, line, phy_addr, d1, length); /*sets the bytes using the line*/
+	return ERR_NONE;
+	}
+/**
+ * outcome of a demand access, for the prefetchers :
+ *  - level      : level of the path where the line was found (path->levels : in memory)
+ *  - prefetched : whether the line had been prefetched and not used yet
+ */
+typedef struct {
+	size_t level;
+	bool prefetched;
+	} access_outcome_t;
+
+/**
+ * @brief a demand access found its line at (INDEX, WAY) of level LEVEL : a prefetched line becomes an ordinary one
+ */
+#define use_line(CACHE, DESC, INDEX, WAY, LEVEL, outcome) {                                        \
+	(outcome)->level = (LEVEL);                                                                   \
+	(outcome)->prefetched = cache_valid(CACHE, DESC, INDEX, WAY) == CACHE_PREFETCHED;             \
+	if ((outcome)->prefetched) cache_valid_set(CACHE, DESC, INDEX, WAY, 1);                       \
+	}
+
+//=========================================================================
+/**
+ * @brief whether a line is in one of the levels of a path (the replacement state is left untouched)
+ */
+static bool in_path(const cache_path_t* path, uint32_t phy_addr){
+	for (size_t level = 0; level < path->levels; level++){
+		cache_store_t* cache = path->cache[level];
+		const cache_desc_t* desc = path->desc[level];
+		uint16_t line_index = (uint16_t) extract_line_index(phy_addr, desc);
+		size_t first_invalid;
+		if (probe_set(cache_tags(cache, desc, line_index), cache_valids(cache, desc, line_index), desc->ways,
+		              extract_tag(phy_addr, desc), &first_invalid) != desc->ways) return true;
+		}
+	return false;
+	}
+
+/**
+ * @brief fill a prefetched line into a level of the hierarchy (the last one if the path is shorter),
+ *        unless it is already in the path. Its memory read is not counted as a demand one.
+ * @return whether the line has been filled
+ */
+static bool prefetch_fill(void * mem_space, const cache_path_t* path, size_t level, uint32_t line_addr, bool write_back){
+	if (in_path(path, line_addr)) return false;
+	level = path_level(path, level); // never the victim cache
+	if (level >= path->levels) level = path->levels - 1;
+	cache_store_t* cache = path->cache[level];
+	const cache_desc_t* desc = path->desc[level];
+	uint16_t line_index = (uint16_t) extract_line_index(line_addr, desc);
+	uint8_t way = 0;
+	if (path->inclusion != CACHE_EXCLUSIVE){ // into every level from the last one up to level
+		if (fill_from_memory(mem_space, path, level, line_addr, false, &way) != ERR_NONE) return false;
+		cache_valid_set(cache, desc, line_index, way, CACHE_PREFETCHED);
+		return true;
+		}
+	if (insert_level(mem_space, path, level, line_addr, find_empty_slot(cache, desc, line_index), write_back, &way) != ERR_NONE) return false;
+	load_memory(mem_space, cache, line_addr, cache_line(cache, desc, line_index, way), desc);
+	fill_sectors(cache, desc, line_index, way, all_sectors(desc));
+	cache_valid_set(cache, desc, line_index, way, CACHE_PREFETCHED);
+	return true;
+	}
+
+/**
+ * @brief let the prefetchers of the caches looked up by a demand access observe it, issue
+ *        their predictions and fill the lines whose prefetch has landed
+ *        (the demand counters and classifiers of the caches are left untouched)
+ */
+static void prefetch_after_access(void * mem_space, const cache_path_t* path, uint32_t phy_addr, const access_outcome_t* outcome,
+                                  bool write_back){
+	if (outcome->prefetched){ // credited to the closest prefetcher filling the level which hit or one above it
+		for (size_t level = outcome->level + 1; level-- > 0; ){
+			prefetcher_t* pf = path->cache[level]->pf;
+			if (pf != NULL && (path_level(path, pf->level) <= outcome->level || outcome->level == path->levels - 1)){
+				pf->counters.useful++;
+				break;
+				}
+			}
+		}
+	size_t looked_up = outcome->level < path->levels ? outcome->level + 1 : path->levels;
+	for (size_t level = 0; level < looked_up; level++){
+		prefetcher_t* pf = path->cache[level]->pf;
+		if (pf == NULL) continue;
+		if (outcome->level == path->levels) pf->counters.misses++;
+		uint32_t lines[PREFETCH_MAX_INFLIGHT]; // at least PREFETCH_MAX_DEGREE
+		uint32_t ready = 0;
+		uint32_t n = prefetcher_observe(pf, phy_addr, level != outcome->level, outcome->prefetched && level == outcome->level, lines);
+		for (uint32_t i = 0; i < n; i++){
+			if (!in_path(path, lines[i]) && prefetcher_issue(pf, lines[i], &ready) && prefetch_fill(mem_space, path, pf->level, ready, write_back))
+				pf->counters.fills++;
+			}
+		n = prefetcher_ready(pf, lines);
+		for (uint32_t i = 0; i < n; i++){
+			if (prefetch_fill(mem_space, path, pf->level, lines[i], write_back)) pf->counters.fills++;
+			}
+		}
+	}
+
+/**
+ * @brief latency of a demand access through a path, found at level LEVEL of it (see timing_cache_cycles),
+ *        the victim cache of the L1 being charged its own latency
+ */
+static uint64_t access_cycles(const cache_path_t* path, size_t level){
+	const timing_t* timing = path->cache[0]->timing;
+	if (!path->victim || level < VICTIM_LEVEL) return timing_cache_cycles(timing, level, path->levels - path->victim);
+	return timing->latencies.victim + timing_cache_cycles(timing, level - 1, path->levels - 1);
+	}
+
+/**
+ * @brief end of a successful demand access through a path : the lookup of the victim cache of
+ *        its L1, its latency, charged to the timing model of its L1 cache (through its MSHRs if
+ *        it is non-blocking), and the work of its prefetchers, if any
+ * @return err
+ */
+CACHE_INLINE int after_access(void * mem_space, const cache_path_t* path, uint32_t phy_addr, const access_outcome_t* outcome,
+                              bool write_back, timing_access_t access, int err){
+	if (err != ERR_NONE) return err;
+	if (path->victim && outcome->level >= VICTIM_LEVEL){
+		cache_victim_counters_t* counters = &path->cache[0]->victim->counters;
+		counters->probes++;
+		if (outcome->level == VICTIM_LEVEL) counters->hits++;
+		}
+	timing_t* timing = path->cache[0]->timing;
+	if (timing != NULL){
+		uint64_t cycles = access_cycles(path, outcome->level);
+		mshr_t* mshr = path->cache[0]->mshr;
+		if (mshr != NULL){ // non-blocking L1 : a miss only holds the processor for the lookup of the L1 (a store going around the caches fetches no line)
+			bool fill = outcome->level > 0 && !(access == TIMING_WRITE && path->cache[0]->desc.alloc == NO_WRITE_ALLOCATE);
+			uint64_t busy = 0;
+			cycles = mshr_access(mshr, timing_cycles(timing), phy_addr, fill, access_cycles(path, 0), cycles, &busy);
+			timing_record_overlapped(timing, access, cycles, busy);
+			}
+		else timing_record(timing, access, cycles);
+		}
+	for (size_t level = 0; level < path->levels; level++){
+		if (path->cache[level]->pf != NULL){
+			prefetch_after_access(mem_space, path, phy_addr, outcome, write_back);
+			break;
+			}
+		}
+	return ERR_NONE;
+	}
+//=========================================================================
+/**
+ * @brief generic core of cache_read and cache_hrchy_read, for the caches of path (see cache_read) :
+ *        the levels are looked up in turn, a line found in one of them is moved to L1
+ *        bytes, length : (modified) the bytes read from phy_addr on, all in its line (a word for cache_read)
+ *        fetch : whether path goes through the instruction caches, which never hold dirty lines
+ *        outcome : (modified) where the line was found
+ */
+CACHE_INLINE int cache_read_core(void * mem_space, uint32_t phy_addr, const cache_path_t* path, uint8_t * bytes, size_t length, bool write_back, bool fetch,
+                                 access_outcome_t* outcome){
+	const uint32_t * p_line = NULL;
+	uint8_t hit_way = HIT_WAY_MISS;
+	uint16_t hit_index = HIT_INDEX_MISS;
+
+	int l1_empty = cache_hit_core(path->cache[0], path->desc[0], phy_addr, &p_line, &hit_way, &hit_index); //check if word is in l1
+	classify_lookup(path->cache[0], phy_addr, hit_way != HIT_WAY_MISS);
+	if  (hit_way != HIT_WAY_MISS){//if found found in level 1 nothing to be done, just affect word
+		fetch_sectors(mem_space, path->cache[0], path->desc[0], hit_index, hit_way, phy_addr, length);
+		copy_from_line(bytes, p_line, phy_addr, path->desc[0], length); //set bytes since we found them in either l1_i or l1_d
+		use_line(path->cache[0], path->desc[0], hit_index, hit_way, 0, outcome);
+		return ERR_NONE;
+		}
+	//not found in l1 => search in the next levels
+	for (size_t level = 1; level < path->levels; level++){
+		cache_store_t* cache = path->cache[level];
+		const cache_desc_t* desc = path->desc[level];
+		cache_hit_core(cache, desc, phy_addr, &p_line, &hit_way, &hit_index); //check if it is in this level
+		classify_lookup(cache, phy_addr, hit_way != HIT_WAY_MISS);
+		if (hit_way != HIT_WAY_MISS) { // found => move entry to level 1 and affect word
+			fetch_sectors(mem_space, cache, desc, hit_index, hit_way, phy_addr, length);
+			copy_from_line(bytes, p_line, phy_addr, desc, length);
+			use_line(cache, desc, hit_index, hit_way, level, outcome);
+			/* a dirty line moved to L1I would be hidden from the data accesses : write it back first */
+			if (fetch && cache_dirty(cache, desc, hit_index, hit_way)) write_back_line(mem_space, cache, desc, hit_index, hit_way);
+			if (path->inclusion != CACHE_EXCLUSIVE){ // the line stays in its level
+				cache->inclusion.copies++;
+				return copy_up(mem_space, path, level, 0, phy_addr, hit_index, &hit_way);
+				}
+			return move_entry_to_level1(path, level, hit_index, hit_way, phy_addr, l1_empty, mem_space, write_back);
+			}
+		}
+	// not found in the hierarchy => search in memory
+	outcome->level = path->levels;
+	outcome->prefetched = false;
+	if (path->inclusion != CACHE_EXCLUSIVE){ // into every level
+		int err = fill_from_memory(mem_space, path, 0, phy_addr, true, &hit_way);
+		if (err != ERR_NONE) return err;
+		copy_from_line(bytes, cache_line(path->cache[0], path->desc[0], extract_line_index(phy_addr, path->desc[0]), hit_way),
+		               phy_addr, path->desc[0], length);
+		return ERR_NONE;
+		}
+	return search_in_memory_and_affect(bytes, length, phy_addr, mem_space, path, l1_empty, write_back);
+	}
+
+/**
+ * @brief check that two caches can be in the same hierarchy
  */
-int cache_read_byte(const void * mem_space, phy_addr_t * p_paddr, mem_access_t access,
-					void * l1_cache,void * l2_cache,uint8_t * p_byte, cache_replace_t replace){
+#define check_levels(upper, lower)                                                                                    \
+	M_REQUIRE_NON_NULL(upper);                                                                                        \
+	M_REQUIRE_NON_NULL(lower);                                                                                        \
+	M_REQUIRE_NON_NULL((upper)->meta);                                                                                \
+	M_REQUIRE_NON_NULL((lower)->meta);                                                                                \
+	M_REQUIRE((upper)->desc.line_bytes == (lower)->desc.line_bytes, ERR_BAD_PARAMETER,                               \
+	          "the caches of a hierarchy must have the same line size %c", ' ');                                     \
+	M_REQUIRE((upper)->desc.write == (lower)->desc.write, ERR_BAD_PARAMETER,                                         \
+	          "the caches of a hierarchy must have the same write policy %c", ' ');                                  \
+	M_REQUIRE((upper)->desc.sectors == (lower)->desc.sectors, ERR_BAD_PARAMETER,                                     \
+	          "the caches of a hierarchy must have the same sectors %c", ' ');                                       \
+	M_REQUIRE((upper)->wbuf == (lower)->wbuf, ERR_BAD_PARAMETER,                                                     \
+	          "the caches of a hierarchy must share the same write buffer %c", ' ')
+
+/**
+ * @brief check the caches given to cache_read/cache_write
+ */
+#define check_caches(l1_cache, l2_cache)                                                                              \
+	check_levels(l1_cache, l2_cache);                                                                                 \
+	M_REQUIRE((l2_cache)->victim == NULL, ERR_BAD_PARAMETER, "only an L1 cache may have a victim cache %c", ' ')
+
+/**
+ * @brief whether the specialised code can be used : both caches are presets (and the L1 has no victim cache)
+ */
+#define use_presets(l1_cache, l2_cache) \
+	((l1_cache)->preset == L1_ICACHE && (l2_cache)->preset == L2_CACHE && (l1_cache)->victim == NULL)
+//=========================================================================
+/**
+ * @brief Ask cache for a word of data.
+ *  Exclusive policy (https://en.wikipedia.org/wiki/Cache_inclusion_policy)
+ *      Consider the case when L2 is exclusive of L1. Suppose there is a
+ *      processor read request for block X. If the block is found in L1 cache,
+ *      then the data is read from L1 cache and returned to the processor. If
+ *      the block is not found in the L1 cache, but present in the L2 cache,
+ *      then the cache block is moved from the L2 cache to the L1 cache. If
+ *      this causes a block to be evicted from L1, the evicted block is then
+ *      placed into L2. This is the only way L2 gets populated. Here, L2
+ *      behaves like a victim cache. If the block is not found in both L1 and
+ *      L2, then it is fetched from main memory and placed just in L1 and not
+ *      in L2.
+ *
+ * @param mem_space pointer to the memory space
+ * @param paddr pointer to a physical address
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param l1_cache pointer to the L1 CACHE
+ * @param l2_cache pointer to the L2 CACHE
+ * @param word pointer to the word of data that is returned by cache
+ * @param replace replacement policy
+ * @return  error code
+ */
+int cache_read(void * mem_space,phy_addr_t * paddr, mem_access_t access,
+               cache_store_t * l1_cache, cache_store_t * l2_cache, uint32_t * word, cache_replace_t replace){
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(paddr);
+	check_caches(l1_cache, l2_cache);
+	M_REQUIRE_NON_NULL(word);
+	M_REQUIRE(replace == l1_cache->desc.replace && replace == l2_cache->desc.replace, ERR_BAD_PARAMETER,
+	          "the caches do not use the replacement policy %d", replace);
+	M_REQUIRE(access == INSTRUCTION || access == DATA, ERR_BAD_PARAMETER, "access is not a valid instance of mem_access_t %c", ' ');
+	M_REQUIRE((paddr->page_offset % sizeof(word_t)) == 0, ERR_BAD_PARAMETER, "paddr should be word aligned for cache_read  %c",' ');
+
+	uint32_t phy_addr = phy_to_int(paddr);
+	bool write_back = l1_cache->desc.write == WRITE_BACK;
+	bool fetch = access == INSTRUCTION;
+	timing_access_t timed = fetch ? TIMING_FETCH : TIMING_READ;
+	access_outcome_t outcome;
+	if (use_presets(l1_cache, l2_cache)){ //specialised code : the geometries are known at compile time
+		const cache_path_t path = two_levels(l1_cache, &CACHE_PRESETS[L1_ICACHE], l2_cache, &CACHE_PRESETS[L2_CACHE]);
+		int err = cache_read_core(mem_space, phy_addr, &path, (uint8_t*) word, sizeof(word_t), write_back, fetch, &outcome);
+		return after_access(mem_space, &path, phy_addr, &outcome, write_back, timed, err);
+		}
+	cache_path_t path = two_levels(l1_cache, &l1_cache->desc, l2_cache, &l2_cache->desc);
+	with_victim(&path);
+	int err = cache_read_core(mem_space, phy_addr, &path, (uint8_t*) word, sizeof(word_t), write_back, fetch, &outcome);
+	return after_access(mem_space, &path, phy_addr, &outcome, write_back, timed, err);
+	}
+//=========================================================================
+/**
+ * /!\ used for read_bytes and write_bytes
+ *
+ * @brief : function that compute word aligned p_addr and cast the resulting word into a byte_t pointer
+ * @param ACCESS : memory access, DATA or INSTRUCTION
+ * @param P_ADDR : P_ADDR : physical address that needs to be word_aligned
+ */
+#define cache_read_deal_with_bytes(ACCESS, P_ADDR) \
+	read_word_of_byte(P_ADDR, cache_read(mem_space, &phy_addr, ACCESS, l1_cache, l2_cache, &word, replace))
+/**
+ * @brief : same as cache_read_deal_with_bytes, the word being read by READ_WORD (from &phy_addr into &word)
+ */
+#define read_word_of_byte(P_ADDR, READ_WORD) {                                                                     \
+	byte_index = P_ADDR->page_offset % sizeof(word_t);  /*index of the byte inside of the word*/                   \
+	phy_addr = *P_ADDR;                                 /*value of paddr from pointer*/                            \
+	phy_addr.page_offset -= byte_index;                 /*remove the byte index to use cache read*/                \
+	if ((err = READ_WORD) != ERR_NONE) return err;      /*error propagation, read word from memory*/               \
+	word_as_byte = (byte_t*)&word;                      /*cast to byte to get the byte we want only*/              \
+    }
+//=========================================================================
+/**
+ * @brief Ask cache for a byte of data. Endianess: LITTLE.
+ *
+ * @param mem_space pointer to the memory space
+ * @param p_addr pointer to a physical address
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param l1_cache pointer to the L1 CACHE
+ * @param l2_cache pointer to the L2 CACHE
+ * @param byte pointer to the byte to be returned
+ * @param replace replacement policy
+ * @return  error code
+ */
+int cache_read_byte(void * mem_space, phy_addr_t * p_paddr, mem_access_t access,
+					cache_store_t * l1_cache, cache_store_t * l2_cache,uint8_t * p_byte, cache_replace_t replace){
 	M_REQUIRE_NON_NULL(mem_space); //basic checks
 	M_REQUIRE_NON_NULL(p_paddr);
-	M_REQUIRE_NON_NULL(l1_cache);	
-	M_REQUIRE_NON_NULL(l2_cache);	
-	M_REQUIRE_NON_NULL(p_byte);	
-	M_REQUIRE(replace == LRU, ERR_BAD_PARAMETER, "replace is not a valid instance of cache_replace_t %c", ' ');
+	M_REQUIRE_NON_NULL(l1_cache);
+	M_REQUIRE_NON_NULL(l2_cache);
+	M_REQUIRE_NON_NULL(p_byte);
+	M_REQUIRE(LRU <= replace && replace < CACHE_REPLACE_NB, ERR_BAD_PARAMETER, "%d is not a valid instance of cache_replace_t", replace);
 	M_REQUIRE(access == INSTRUCTION || access == DATA, ERR_BAD_PARAMETER, "access is not a valid instance of mem_access_t %c", ' ');
 	int err = ERR_NONE; //used for error propagation
 	byte_t* word_as_byte = NULL;
@@ -613,57 +1396,120 @@ int cache_read_byte(const void * mem_space, phy_addr_t * p_paddr, mem_access_t a
 	phy_addr_t phy_addr;
 	cache_read_deal_with_bytes (access, p_paddr);
 	*p_byte = word_as_byte[byte_index];                      //get the byte we want
-	
+
 	return ERR_NONE;
 }
-//=========================================================================
+//================================================================================================
+//================================== helper functions for write ===================================
 /**
- * @brief Writes a whole line to memory at the address given by the phy_addr
- *
- * @param mem_space pointer to the memory space
- * @param paddr uint corresponding to a physical address
- * @param line pointer to the line to write to the memory
- * @return nothing (void)
+ * @brief : update bytes in line and write their words to memory (write-through), counted for CACHE
  */
-void write_memory(void * mem_space, uint32_t phy_addr, word_t* line) {
-	uint32_t addr = compute_addr_line_aligned(phy_addr,L1_DCACHE);//gets the word addressed phy addr and sets memory to line, assume number of words per line is the same in all caches as said on moodle
-	access_memory(line, (word_t*)(mem_space) + addr, L1_DCACHE_WORDS_PER_LINE);  //let's assume that WORDS_PER_LINE*sizeof(word_t) is not going to overflow
+#define set_word_and_write_back(input_line, desc, CACHE) {                                        \
+	copy_to_line(input_line, phy_addr, desc, bytes, length);/*update bytes*/                      \
+	store_memory(mem_space, CACHE, phy_addr, input_line, range_words(phy_addr, desc, length), desc); /*update memory */ \
 	}
-	
 /**
- * @brief Reads a whole line in memory at the address given by the phy_addr
- *
- * @param mem_space pointer to the memory space
- * @param paddr uint corresponding to a physical address
- * @param line pointer to the line to set after reading the memory
- * @return nothing (void)
+ * @brief : write-through : update the line of the cache in place and write its words to memory (ages have been updated by the hit)
+ * @param CACHE          : the cache
+ * @param DESC           : its geometry
+ */
+#define read_modifyLine_insert_updateAges_writeBackInMemory(CACHE, DESC) \
+	set_word_and_write_back(cache_line(CACHE, DESC, hit_index, hit_way), DESC, CACHE)
+//================================================================================================
+/**
+ * @brief : write-back : update bytes in the line of the cache and mark it dirty, the sectors written
+ *          for a sectored line (ages have been updated by the hit)
  */
-void read_memory(void * mem_space, uint32_t phy_addr, word_t* line) {
-	uint32_t addr = compute_addr_line_aligned(phy_addr,L2_CACHE); //gets the word addressed phy addr and sets line using memory, assume number of words per line is the same in all caches as said on moodle  
-	access_memory((word_t*)(mem_space) + addr, line, L2_CACHE_WORDS_PER_LINE);   //let us assume that WORDS_PER_LINE*sizeof(word_t) is not going to overflow
+#define set_word_and_mark_dirty(CACHE, DESC) {                                                    \
+	copy_to_line(cache_line(CACHE, DESC, hit_index, hit_way), phy_addr, DESC, bytes, length);     \
+	cache_dirty_set(CACHE, DESC, hit_index, hit_way,                                              \
+	                cache_dirty(CACHE, DESC, hit_index, hit_way) | range_sectors(phy_addr, DESC, length)); \
 	}
-
 //================================================================================================
-//================================== helper functions for write ===================================
 /**
- * @brief : update word in line and write back line to memory
+ * @brief (inclusive, NINE) bring the line of phy_addr into L1, from (hit_index, hit_way) of a level
+ *        (path->levels : from memory), then write the bytes into it : marked dirty (write-back),
+ *        or written through to memory and to the copies below L1
  */
-#define set_word_and_write_back(input_line, CACHE_TYPE) {                                         \
-	input_line[extract_word_index(phy_addr,CACHE_TYPE)] = *word;/*update word*/                   \
-	write_memory(mem_space, phy_addr,input_line);                       /*update memory */            \
+CACHE_INLINE int write_copied_line(void * mem_space, const cache_path_t* path, size_t level, uint32_t phy_addr, uint16_t hit_index, uint8_t hit_way,
+                                   const uint8_t * bytes, size_t length, bool write_back){
+	int err = (level == path->levels) ? fill_from_memory(mem_space, path, 0, phy_addr, true, &hit_way)
+	                                  : copy_up(mem_space, path, level, 0, phy_addr, hit_index, &hit_way);
+	if (err != ERR_NONE) return err;
+	cache_store_t* l1_cache = path->cache[0];
+	const cache_desc_t* d1 = path->desc[0];
+	hit_index = (uint16_t) extract_line_index(phy_addr, d1);
+	if (write_back) set_word_and_mark_dirty(l1_cache, d1)
+	else {
+		read_modifyLine_insert_updateAges_writeBackInMemory(l1_cache, d1);
+		write_lower_copies(path, phy_addr, bytes, length);
+		}
+	return ERR_NONE;
 	}
+//================================================================================================
 /**
- * @brief : read line from cache, update it, write back to memory, insert it back to cache and update ages
- * @param TYPE           : type of cache
- * @param CACHE_TYPE     : instance of cache_t 
- * @param CACHE          : instance of the cache
+ * @brief generic core of cache_write and cache_hrchy_write, for the caches of path (see cache_write)
+ *        bytes, length : the bytes written from phy_addr on, all in its line (a word for cache_write)
+ *        outcome : (modified) where the line was found
  */
-#define read_modifyLine_insert_updateAges_writeBackInMemory(TYPE, CACHE_TYPE, CACHE) {                           \
-	 TYPE entry;                                                         /*new entry*/                                                    \
-	 entry = *cache_entry_any(TYPE, (CACHE_TYPE ## _WAYS), hit_index, hit_way, CACHE); /*get the entry corresponding (with deep copy)*/                 \
-	 set_word_and_write_back(entry.line,CACHE_TYPE);                                                                                 \
-	 if ((err = cache_insert(hit_index, hit_way, &entry, CACHE, CACHE_TYPE))!= ERR_NONE) return err; /*insert back in CACHE and error propagation if needed*/      \
-	 modify_ages(CACHE_TYPE, CACHE, hit_way, hit_index, false);          /*modify ages accordingly (since its a hit its not cold start)*/ \
+CACHE_INLINE int cache_write_core(void * mem_space, uint32_t phy_addr, const cache_path_t* path, const uint8_t * bytes, size_t length, bool write_back,
+                                  bool no_allocate, access_outcome_t* outcome){
+	const uint32_t * p_line = NULL;//values that we use for using cache hit
+	uint8_t hit_way = HIT_WAY_MISS;
+	uint16_t hit_index = HIT_INDEX_MISS;
+	cache_store_t* l1_cache = path->cache[0];
+	const cache_desc_t* d1 = path->desc[0];
+
+	int l1_empty = cache_hit_core(l1_cache, d1, phy_addr, &p_line, &hit_way, &hit_index);//check if we have a valid entry corresponding
+	classify_lookup(l1_cache, phy_addr, hit_way != HIT_WAY_MISS);
+	if  (hit_way != HIT_WAY_MISS){//if found found in level 1
+		use_line(l1_cache, d1, hit_index, hit_way, 0, outcome);
+		fetch_sectors(mem_space, l1_cache, d1, hit_index, hit_way, phy_addr, length);
+		if (write_back) set_word_and_mark_dirty(l1_cache, d1)
+		else {
+			read_modifyLine_insert_updateAges_writeBackInMemory(l1_cache, d1);
+			if (path->inclusion != CACHE_EXCLUSIVE) write_lower_copies(path, phy_addr, bytes, length);
+			}
+		return ERR_NONE;
+		}
+	//not found in l1 => search in the next levels
+	for (size_t level = 1; level < path->levels; level++){
+		cache_store_t* cache = path->cache[level];
+		const cache_desc_t* desc = path->desc[level];
+		cache_hit_core(cache, desc, phy_addr, &p_line, &hit_way, &hit_index); //check if we have an entry in this level
+		classify_lookup(cache, phy_addr, hit_way != HIT_WAY_MISS);
+		if (hit_way != HIT_WAY_MISS) { // found => find line, update ages,  move entry to level 1 , update memory
+			use_line(cache, desc, hit_index, hit_way, level, outcome);
+			if (path->inclusion != CACHE_EXCLUSIVE){ // the line stays in its level
+				cache->inclusion.copies++;
+				return write_copied_line(mem_space, path, level, phy_addr, hit_index, hit_way, bytes, length, write_back);
+				}
+			fetch_sectors(mem_space, cache, desc, hit_index, hit_way, phy_addr, length);
+			if (write_back) set_word_and_mark_dirty(cache, desc)
+			else read_modifyLine_insert_updateAges_writeBackInMemory(cache, desc);
+			return move_entry_to_level1(path, level, hit_index, hit_way, phy_addr, l1_empty, mem_space, write_back); //insert in l1
+			}
+		}
+	// not found in the hierarchy
+	outcome->level = path->levels;
+	outcome->prefetched = false;
+	if (no_allocate){ // write around the caches
+		word_t line[CACHE_MAX_WORDS_PER_LINE];
+		if ((phy_addr | length) % sizeof(word_t) != 0) load_memory(mem_space, l1_cache, phy_addr, line, d1); // partial words
+		set_word_and_write_back(line, d1, l1_cache);
+		return ERR_NONE;
+		}
+	if (path->inclusion != CACHE_EXCLUSIVE) return write_copied_line(mem_space, path, path->levels, phy_addr, 0, 0, bytes, length, write_back);
+	// => make room in l1 and read the line from memory, in place
+	hit_index = (uint16_t) extract_line_index(phy_addr, d1);
+	int err = insert_level(mem_space, path, 0, phy_addr, l1_empty, write_back, &hit_way);
+	if (err != ERR_NONE) return err;
+	load_memory(mem_space, l1_cache, phy_addr, cache_line(l1_cache, d1, hit_index, hit_way), d1);
+	l1_cache->counters.mem_reads++;
+	fill_sectors(l1_cache, d1, hit_index, hit_way, range_sectors(phy_addr, d1, length));
+	if (write_back) set_word_and_mark_dirty(l1_cache, d1) // memory is updated when the line leaves the hierarchy
+	else read_modifyLine_insert_updateAges_writeBackInMemory(l1_cache, d1);
+	return ERR_NONE;
 	}
 //================================================================================================
 /**
@@ -672,44 +1518,162 @@ void read_memory(void * mem_space, uint32_t phy_addr, word_t* line) {
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 DCACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache pointer to the L1 DCACHE
+ * @param l2_cache pointer to the L2 CACHE
  * @param word const pointer to the word of data that is to be written to the cache
  * @param replace replacement policy
  * @return error code
  */
-int cache_write(void * mem_space,phy_addr_t * paddr, void * l1_cache,
-                void * l2_cache,const uint32_t * word, cache_replace_t replace){
+int cache_write(void * mem_space,phy_addr_t * paddr, cache_store_t * l1_cache,
+                cache_store_t * l2_cache,const uint32_t * word, cache_replace_t replace){
 	M_REQUIRE_NON_NULL(mem_space);//basic checks
 	M_REQUIRE_NON_NULL(paddr);
-	M_REQUIRE_NON_NULL(l1_cache);	
-	M_REQUIRE_NON_NULL(l2_cache);	
-	M_REQUIRE_NON_NULL(word);	
+	check_caches(l1_cache, l2_cache);
+	M_REQUIRE_NON_NULL(word);
 	M_REQUIRE((paddr->page_offset % sizeof(word_t)) == 0, ERR_BAD_PARAMETER, "paddr should be word aligned for cache_read  %c",' ');
-	M_REQUIRE(replace == LRU, ERR_BAD_PARAMETER, "replace is not a valid instance of cache_replace_t %c", ' ');
-	int err = ERR_NONE; // used to propagate errors
+	M_REQUIRE(replace == l1_cache->desc.replace && replace == l2_cache->desc.replace, ERR_BAD_PARAMETER,
+	          "the caches do not use the replacement policy %d", replace);
+
 	uint32_t phy_addr = phy_to_int(paddr); //get the uint32 corresponding to the paddr given
-	const uint32_t * p_line = 0;//values that we use for using cache hit
-	uint8_t hit_way = 0;
-	uint16_t hit_index = 0;
-	
-	if ((err = cache_hit(mem_space, l1_cache, paddr,&p_line,&hit_way,&hit_index, L1_DCACHE)) != ERR_NONE) return err;//error handling, check if we have a valid entry corresponding
-	if  (hit_way != HIT_WAY_MISS){//if found found in level 1
-		  read_modifyLine_insert_updateAges_writeBackInMemory(l1_dcache_entry_t, L1_DCACHE, l1_cache);
+	bool write_back = l1_cache->desc.write == WRITE_BACK;
+	bool no_allocate = l1_cache->desc.alloc == NO_WRITE_ALLOCATE;
+	access_outcome_t outcome;
+	if (use_presets(l1_cache, l2_cache)){ //specialised code : the geometries are known at compile time
+		const cache_path_t path = two_levels(l1_cache, &CACHE_PRESETS[L1_DCACHE], l2_cache, &CACHE_PRESETS[L2_CACHE]);
+		int err = cache_write_core(mem_space, phy_addr, &path, (const uint8_t*) word, sizeof(word_t), write_back, no_allocate, &outcome);
+		return after_access(mem_space, &path, phy_addr, &outcome, write_back, TIMING_WRITE, err);
 		}
-	else{//not found in l1 => search in l2
-		if((err = cache_hit(mem_space, l2_cache, paddr,&p_line,&hit_way,&hit_index, L2_CACHE)) != ERR_NONE) return err; //error handling, check if we have an entry in l2
-		if (hit_way != HIT_WAY_MISS) { // found in level 2 => find line, update ages,  move entry to level 1 , update memory
-			read_modifyLine_insert_updateAges_writeBackInMemory(l2_cache_entry_t, L2_CACHE, l2_cache);	
-			if ((err = move_entry_to_level1(DATA,l1_cache, l2_cache, cache_entry_any(l2_cache_entry_t, L2_CACHE_WAYS, hit_index, hit_way, l2_cache), phy_addr))!= ERR_NONE){return err;}//error propagation, insert in l1
+	cache_path_t path = two_levels(l1_cache, &l1_cache->desc, l2_cache, &l2_cache->desc);
+	with_victim(&path);
+	int err = cache_write_core(mem_space, phy_addr, &path, (const uint8_t*) word, sizeof(word_t), write_back, no_allocate, &outcome);
+	return after_access(mem_space, &path, phy_addr, &outcome, write_back, TIMING_WRITE, err);
+	}
+
+//=========================================================================
+int cache_set_write_buffer(cache_store_t * cache, struct write_buffer * wbuf){
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE(wbuf == NULL || wbuf->line_bytes == cache->desc.line_bytes, ERR_BAD_PARAMETER,
+	          "the write buffer must have the line size of the cache %c", ' ');
+	cache->wbuf = wbuf;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_set_miss_class(cache_store_t * cache, struct miss_class * mclass){
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE(mclass == NULL || mclass->line_bits == cache->desc.line_bits, ERR_BAD_PARAMETER,
+	          "the classifier must have the line size of the cache %c", ' ');
+	cache->mclass = mclass;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_set_prefetcher(cache_store_t * cache, struct prefetcher * pf){
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE(pf == NULL || pf->line_bits == cache->desc.line_bits, ERR_BAD_PARAMETER,
+	          "the prefetcher must have the line size of the cache %c", ' ');
+	cache->pf = pf;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_set_timing(cache_store_t * cache, struct timing * timing){
+	M_REQUIRE_NON_NULL(cache);
+	cache->timing = timing;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_set_mshr(cache_store_t * cache, struct mshr * mshr){
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE(mshr == NULL || mshr->line_bits == cache->desc.line_bits, ERR_BAD_PARAMETER,
+	          "the MSHRs must have the line size of the cache %c", ' ');
+	cache->mshr = mshr;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_set_partition(cache_store_t * cache, struct way_partition * part){
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE(part == NULL || part->ways == cache->desc.ways, ERR_BAD_PARAMETER,
+	          "the partition must have the ways of the cache %c", ' ');
+	cache->partition = part;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_victim_init(victim_cache_t * victim, uint32_t entries, const cache_desc_t * l1_desc){
+	M_REQUIRE_NON_NULL(victim);
+	M_REQUIRE_NON_NULL(l1_desc);
+	M_REQUIRE(1 <= entries && entries <= CACHE_MAX_VICTIMS, ERR_BAD_PARAMETER,
+	          "a victim cache has 1 to %u entries (%"PRIu32")", CACHE_MAX_VICTIMS, entries);
+	memset(victim, 0, sizeof(victim_cache_t));
+	cache_desc_t desc;
+	int err = ERR_NONE;
+	if ((err = cache_desc_init(&desc, 1, entries, l1_desc->line_bytes, LRU)) != ERR_NONE) return err; // fully associative
+	if ((err = cache_desc_set_write(&desc, l1_desc->write)) != ERR_NONE) return err;
+	return cache_init(&victim->store, &desc);
+	}
+
+//=========================================================================
+void cache_victim_free(victim_cache_t * victim){
+	if (victim == NULL) return;
+	cache_free(&victim->store);
+	}
+
+//=========================================================================
+int cache_set_victim(cache_store_t * cache, victim_cache_t * victim){
+	M_REQUIRE_NON_NULL(cache);
+	if (victim != NULL){
+		check_levels(cache, &victim->store);
+		}
+	cache->victim = victim;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_snoop(void * mem_space, cache_store_t * cache, const phy_addr_t * paddr, cache_snoop_t action, bool * hit, bool * dirty){
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE_NON_NULL(cache->meta);
+	M_REQUIRE_NON_NULL(paddr);
+	M_REQUIRE_NON_NULL(hit);
+	M_REQUIRE_NON_NULL(dirty);
+	M_REQUIRE(SNOOP_PROBE <= action && action <= SNOOP_DISCARD, ERR_BAD_PARAMETER, "%d is not a valid instance of cache_snoop_t", action);
+	const cache_desc_t* desc = &cache->desc;
+	uint32_t phy_addr = phy_to_int(paddr);
+	uint16_t line_index = (uint16_t) extract_line_index(phy_addr, desc);
+	uint32_t tag = extract_tag(phy_addr, desc);
+	*hit = *dirty = false;
+	for (uint8_t way = 0; way < desc->ways; way++){ // a shared level may hold several copies (one per core which evicted it)
+		if (!cache_valid(cache, desc, line_index, way) || cache_tag(cache, desc, line_index, way) != tag) continue;
+		*hit = true;
+		if (cache_dirty(cache, desc, line_index, way)){
+			*dirty = true;
+			if (action == SNOOP_CLEAN || action == SNOOP_FLUSH) write_back_line(mem_space, cache, desc, line_index, way);
 			}
-		else { // not found in L2 => search in memory
-			word_t line[L1_ICACHE_WORDS_PER_LINE];               //init line to read from memory
-			read_memory(mem_space, phy_addr, line);              // read line from memory
-			set_word_and_write_back(line, L1_DCACHE);
-			l1_dcache_entry_t entry;
-			if ((err = cache_entry_init(mem_space, paddr,&entry,L1_DCACHE))!= ERR_NONE) return err; //init entry from memory (gets everything from mem)
-			if((err = insert_level1(DATA, l1_cache, l2_cache, &entry, phy_to_int(paddr))) != ERR_NONE) return err; //insert entry to l1
+		if (action == SNOOP_FLUSH || action == SNOOP_DISCARD){
+			cache_valid_set(cache, desc, line_index, way, 0);
+			cache_dirty_set(cache, desc, line_index, way, 0);
+			}
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int cache_writeback_all(void * mem_space, cache_store_t * cache){
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(cache);
+	M_REQUIRE_NON_NULL(cache->meta);
+	if (cache->victim != NULL){ // first : the copies in the L1 are the most recent
+		int err = cache_writeback_all(mem_space, &cache->victim->store);
+		if (err != ERR_NONE) return err;
+		}
+	const cache_desc_t* desc = &cache->desc;
+	for (uint16_t line_index = 0; line_index < desc->lines; line_index++){
+		for (uint8_t way = 0; way < desc->ways; way++){
+			if (cache_valid(cache, desc, line_index, way) && cache_dirty(cache, desc, line_index, way))
+				write_back_line(mem_space, cache, desc, line_index, way);
 			}
 		}
 	return ERR_NONE;
@@ -721,87 +1685,340 @@ int cache_write(void * mem_space,phy_addr_t * paddr, void * l1_cache,
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 ICACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache pointer to the L1 DCACHE
+ * @param l2_cache pointer to the L2 CACHE
  * @param p_byte pointer to the byte to be written
  * @param replace replacement policy
  * @return error code
  */
-int cache_write_byte(void * mem_space, phy_addr_t * paddr, void * l1_cache,
-                     void * l2_cache, uint8_t p_byte,cache_replace_t replace){
+int cache_write_byte(void * mem_space, phy_addr_t * paddr, cache_store_t * l1_cache,
+                     cache_store_t * l2_cache, uint8_t p_byte,cache_replace_t replace){
 	M_REQUIRE_NON_NULL(mem_space); //basic checks
 	M_REQUIRE_NON_NULL(paddr);
-	M_REQUIRE_NON_NULL(l1_cache);	
-	M_REQUIRE_NON_NULL(l2_cache);	
-	M_REQUIRE(replace == LRU, ERR_BAD_PARAMETER, "replace is not a valid instance of cache_replace_t %c", ' ');
+	M_REQUIRE_NON_NULL(l1_cache);
+	M_REQUIRE_NON_NULL(l2_cache);
+	M_REQUIRE(LRU <= replace && replace < CACHE_REPLACE_NB, ERR_BAD_PARAMETER, "%d is not a valid instance of cache_replace_t", replace);
 	int err = ERR_NONE; //for error propagation
 	word_t word = 0; //word that will be read from cache
 	int byte_index = 0;
 	byte_t* word_as_byte = NULL;
 	phy_addr_t phy_addr;
 	cache_read_deal_with_bytes(DATA, paddr);
-	
+
 	word_as_byte[byte_index] = p_byte;  //set the byte wanted inside the word
 	if ((err = cache_write(mem_space,&phy_addr,l1_cache, l2_cache, &word, replace)) != ERR_NONE) return err;//error propagation, write word back in memory
-	return ERR_NONE;					 
+	return ERR_NONE;
+	}
+
+/**
+ * @brief check the range of a block access (it must not wrap around the physical address space)
+ */
+#define check_block(paddr, bytes, length)                                                                             \
+	M_REQUIRE_NON_NULL(paddr);                                                                                        \
+	M_REQUIRE(length == 0 || bytes != NULL, ERR_BAD_PARAMETER, "bytes must not be NULL %c", ' ');                  \
+	M_REQUIRE(length <= (size_t) UINT32_MAX + 1 - phy_to_int(paddr), ERR_ADDR,                                     \
+	          "block of %zu bytes out of the physical address space", length)
+
+/**
+ * @brief generic core of the block reads, for the caches of path : one access of cache_read_core
+ *        per line of the block, each followed by after_access
+ */
+CACHE_INLINE int read_block_core(void * mem_space, uint32_t phy_addr, const cache_path_t* path, uint8_t * bytes, size_t length,
+                                 bool write_back, bool fetch){
+	cache_store_t* l1_cache = path->cache[0];
+	const cache_desc_t* d1 = path->desc[0];
+	l1_cache->blocks.reads++;
+	l1_cache->blocks.bytes += length;
+	while (length > 0){ // split at the line boundaries
+		size_t chunk = d1->line_bytes - (phy_addr & (d1->line_bytes - 1));
+		if (chunk > length) chunk = length;
+		access_outcome_t outcome;
+		int err = cache_read_core(mem_space, phy_addr, path, bytes, chunk, write_back, fetch, &outcome);
+		if ((err = after_access(mem_space, path, phy_addr, &outcome, write_back, fetch ? TIMING_FETCH : TIMING_READ, err)) != ERR_NONE) return err;
+		l1_cache->blocks.lines++;
+		phy_addr += (uint32_t) chunk;
+		bytes += chunk;
+		length -= chunk;
+		}
+	return ERR_NONE;
+	}
+
+/**
+ * @brief generic core of the block writes, for the caches of path (see read_block_core)
+ */
+CACHE_INLINE int write_block_core(void * mem_space, uint32_t phy_addr, const cache_path_t* path, const uint8_t * bytes, size_t length,
+                                  bool write_back, bool no_allocate){
+	cache_store_t* l1_cache = path->cache[0];
+	const cache_desc_t* d1 = path->desc[0];
+	l1_cache->blocks.writes++;
+	l1_cache->blocks.bytes += length;
+	while (length > 0){
+		size_t chunk = d1->line_bytes - (phy_addr & (d1->line_bytes - 1));
+		if (chunk > length) chunk = length;
+		access_outcome_t outcome;
+		int err = cache_write_core(mem_space, phy_addr, path, bytes, chunk, write_back, no_allocate, &outcome);
+		if ((err = after_access(mem_space, path, phy_addr, &outcome, write_back, TIMING_WRITE, err)) != ERR_NONE) return err;
+		l1_cache->blocks.lines++;
+		phy_addr += (uint32_t) chunk;
+		bytes += chunk;
+		length -= chunk;
+		}
+	return ERR_NONE;
 	}
 
 //=========================================================================
-#define PRINT_CACHE_LINE(OUTFILE, TYPE, WAYS, LINE_INDEX, WAY, WORDS_PER_LINE) \
-    do { \
-            fprintf(OUTFILE, "V: %1" PRIx8 ", AGE: %1" PRIx8 ", TAG: 0x%03" PRIx16 ", values: ( ", \
-                        cache_valid(TYPE, WAYS, LINE_INDEX, WAY), \
-                        cache_age(TYPE, WAYS, LINE_INDEX, WAY), \
-                        cache_tag(TYPE, WAYS, LINE_INDEX, WAY)); \
-            for(int i_ = 0; i_ < WORDS_PER_LINE; i_++) \
-                fprintf(OUTFILE, "0x%08" PRIx32 " ", \
-                        cache_line(TYPE, WAYS, LINE_INDEX, WAY)[i_]); \
-            fputs(")\n", OUTFILE); \
-    } while(0)
+// see cache_mng.h
+int cache_read_block(void * mem_space, phy_addr_t * paddr, mem_access_t access, cache_store_t * l1_cache, cache_store_t * l2_cache,
+                     uint8_t * bytes, size_t length, cache_replace_t replace){
+	M_REQUIRE_NON_NULL(mem_space);
+	check_block(paddr, bytes, length);
+	check_caches(l1_cache, l2_cache);
+	M_REQUIRE(replace == l1_cache->desc.replace && replace == l2_cache->desc.replace, ERR_BAD_PARAMETER,
+	          "the caches do not use the replacement policy %d", replace);
+	M_REQUIRE(access == INSTRUCTION || access == DATA, ERR_BAD_PARAMETER, "access is not a valid instance of mem_access_t %c", ' ');
 
-#define PRINT_INVALID_CACHE_LINE(OUTFILE, TYPE, WAYS, LINE_INDEX, WAY, WORDS_PER_LINE) \
-    do { \
-            fprintf(OUTFILE, "V: %1" PRIx8 ", AGE: -, TAG: -----, values: ( ---------- ---------- ---------- ---------- )\n", \
-                        cache_valid(TYPE, WAYS, LINE_INDEX, WAY)); \
-    } while(0)
+	bool write_back = l1_cache->desc.write == WRITE_BACK;
+	if (use_presets(l1_cache, l2_cache)){
+		const cache_path_t path = two_levels(l1_cache, &CACHE_PRESETS[L1_ICACHE], l2_cache, &CACHE_PRESETS[L2_CACHE]);
+		return read_block_core(mem_space, phy_to_int(paddr), &path, bytes, length, write_back, access == INSTRUCTION);
+		}
+	cache_path_t path = two_levels(l1_cache, &l1_cache->desc, l2_cache, &l2_cache->desc);
+	with_victim(&path);
+	return read_block_core(mem_space, phy_to_int(paddr), &path, bytes, length, write_back, access == INSTRUCTION);
+	}
 
-#define DUMP_CACHE_TYPE(OUTFILE, TYPE, WAYS, LINES, WORDS_PER_LINE)  \
+//=========================================================================
+// see cache_mng.h
+int cache_write_block(void * mem_space, phy_addr_t * paddr, cache_store_t * l1_cache, cache_store_t * l2_cache,
+                      const uint8_t * bytes, size_t length, cache_replace_t replace){
+	M_REQUIRE_NON_NULL(mem_space);
+	check_block(paddr, bytes, length);
+	check_caches(l1_cache, l2_cache);
+	M_REQUIRE(replace == l1_cache->desc.replace && replace == l2_cache->desc.replace, ERR_BAD_PARAMETER,
+	          "the caches do not use the replacement policy %d", replace);
+
+	bool write_back = l1_cache->desc.write == WRITE_BACK;
+	bool no_allocate = l1_cache->desc.alloc == NO_WRITE_ALLOCATE;
+	if (use_presets(l1_cache, l2_cache)){
+		const cache_path_t path = two_levels(l1_cache, &CACHE_PRESETS[L1_DCACHE], l2_cache, &CACHE_PRESETS[L2_CACHE]);
+		return write_block_core(mem_space, phy_to_int(paddr), &path, bytes, length, write_back, no_allocate);
+		}
+	cache_path_t path = two_levels(l1_cache, &l1_cache->desc, l2_cache, &l2_cache->desc);
+	with_victim(&path);
+	return write_block_core(mem_space, phy_to_int(paddr), &path, bytes, length, write_back, no_allocate);
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_init(cache_hrchy_t * hrchy){
+	M_REQUIRE_NON_NULL(hrchy);
+	memset(hrchy, 0, sizeof(*hrchy));
+	return ERR_NONE;
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_add_level(cache_hrchy_t * hrchy, cache_store_t * icache, cache_store_t * dcache){
+	M_REQUIRE_NON_NULL(hrchy);
+	M_REQUIRE(hrchy->levels < CACHE_MAX_LEVELS, ERR_BAD_PARAMETER, "a hierarchy has at most %u levels", CACHE_MAX_LEVELS);
+	check_levels(icache, dcache);
+	if (hrchy->levels > 0) {
+		check_levels(hrchy->dcache[0], dcache);
+		M_REQUIRE(icache->victim == NULL && dcache->victim == NULL, ERR_BAD_PARAMETER,
+		          "only an L1 cache may have a victim cache %c", ' ');
+		}
+	hrchy->icache[hrchy->levels] = icache;
+	hrchy->dcache[hrchy->levels] = dcache;
+	hrchy->levels++;
+	return ERR_NONE;
+	}
+
+/**
+ * @brief check a hierarchy given to cache_hrchy_read/cache_hrchy_write (its caches are checked by cache_hrchy_add_level)
+ */
+#define check_hrchy(hrchy)                                                                                            \
+	M_REQUIRE_NON_NULL(hrchy);                                                                                        \
+	M_REQUIRE((hrchy)->levels > 0 && (hrchy)->levels <= CACHE_MAX_LEVELS, ERR_BAD_PARAMETER,                          \
+	          "invalid number of levels %zu", (hrchy)->levels);                                                      \
+	M_REQUIRE((hrchy)->inclusion == CACHE_EXCLUSIVE || ((hrchy)->icache[0]->victim == NULL && (hrchy)->dcache[0]->victim == NULL), \
+	          ERR_BAD_PARAMETER, "victim caches need an exclusive hierarchy %c", ' ');                               \
+	M_REQUIRE((hrchy)->inclusion == CACHE_EXCLUSIVE || !sectored(&(hrchy)->dcache[0]->desc), ERR_BAD_PARAMETER,        \
+	          "sectored caches need an exclusive hierarchy %c", ' ')
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_set_inclusion(cache_hrchy_t * hrchy, cache_inclusion_t inclusion){
+	M_REQUIRE_NON_NULL(hrchy);
+	M_REQUIRE(CACHE_EXCLUSIVE <= inclusion && inclusion <= CACHE_NINE, ERR_BAD_PARAMETER, "%d is not a valid instance of cache_inclusion_t", inclusion);
+	hrchy->inclusion = inclusion;
+	return ERR_NONE;
+	}
+
+/**
+ * @brief path of the accesses of a given type through a hierarchy
+ */
+CACHE_INLINE void hrchy_path(cache_path_t* path, const cache_hrchy_t* hrchy, mem_access_t access){
+	path->levels = hrchy->levels;
+	path->inclusion = hrchy->inclusion;
+	for (size_t level = 0; level < hrchy->levels; level++){
+		path->cache[level] = (access == INSTRUCTION) ? hrchy->icache[level] : hrchy->dcache[level];
+		path->desc[level] = &path->cache[level]->desc;
+		path->sibling[level] = (hrchy->icache[level] == hrchy->dcache[level]) ? NULL
+		                       : (access == INSTRUCTION) ? hrchy->dcache[level] : hrchy->icache[level];
+		}
+	with_victim(path);
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_read(void * mem_space, const cache_hrchy_t * hrchy, phy_addr_t * paddr, mem_access_t access, uint32_t * word){
+	M_REQUIRE_NON_NULL(mem_space);
+	check_hrchy(hrchy);
+	M_REQUIRE_NON_NULL(paddr);
+	M_REQUIRE_NON_NULL(word);
+	M_REQUIRE(access == INSTRUCTION || access == DATA, ERR_BAD_PARAMETER, "access is not a valid instance of mem_access_t %c", ' ');
+	M_REQUIRE((paddr->page_offset % sizeof(word_t)) == 0, ERR_BAD_PARAMETER, "paddr should be word aligned for cache_read  %c",' ');
+
+	cache_path_t path;
+	hrchy_path(&path, hrchy, access);
+	uint32_t phy_addr = phy_to_int(paddr);
+	bool write_back = path.cache[0]->desc.write == WRITE_BACK;
+	access_outcome_t outcome;
+	int err = cache_read_core(mem_space, phy_addr, &path, (uint8_t*) word, sizeof(word_t), write_back, access == INSTRUCTION, &outcome);
+	return after_access(mem_space, &path, phy_addr, &outcome, write_back, access == INSTRUCTION ? TIMING_FETCH : TIMING_READ, err);
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_read_byte(void * mem_space, const cache_hrchy_t * hrchy, phy_addr_t * p_paddr, mem_access_t access, uint8_t * p_byte){
+	M_REQUIRE_NON_NULL(p_paddr);
+	M_REQUIRE_NON_NULL(p_byte);
+	int err = ERR_NONE; //used for error propagation
+	byte_t* word_as_byte = NULL;
+	int byte_index = 0;
+	word_t word = 0;                                         //word that we will read from cache
+	phy_addr_t phy_addr;
+	read_word_of_byte(p_paddr, cache_hrchy_read(mem_space, hrchy, &phy_addr, access, &word));
+	*p_byte = word_as_byte[byte_index];                      //get the byte we want
+	return ERR_NONE;
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_write(void * mem_space, const cache_hrchy_t * hrchy, phy_addr_t * paddr, const uint32_t * word){
+	M_REQUIRE_NON_NULL(mem_space);
+	check_hrchy(hrchy);
+	M_REQUIRE_NON_NULL(paddr);
+	M_REQUIRE_NON_NULL(word);
+	M_REQUIRE((paddr->page_offset % sizeof(word_t)) == 0, ERR_BAD_PARAMETER, "paddr should be word aligned for cache_read  %c",' ');
+
+	cache_path_t path;
+	hrchy_path(&path, hrchy, DATA);
+	uint32_t phy_addr = phy_to_int(paddr);
+	bool write_back = path.cache[0]->desc.write == WRITE_BACK;
+	access_outcome_t outcome;
+	int err = cache_write_core(mem_space, phy_addr, &path, (const uint8_t*) word, sizeof(word_t), write_back, path.cache[0]->desc.alloc == NO_WRITE_ALLOCATE, &outcome);
+	return after_access(mem_space, &path, phy_addr, &outcome, write_back, TIMING_WRITE, err);
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_write_byte(void * mem_space, const cache_hrchy_t * hrchy, phy_addr_t * paddr, uint8_t p_byte){
+	M_REQUIRE_NON_NULL(paddr);
+	int err = ERR_NONE; //for error propagation
+	word_t word = 0; //word that will be read from cache
+	int byte_index = 0;
+	byte_t* word_as_byte = NULL;
+	phy_addr_t phy_addr;
+	read_word_of_byte(paddr, cache_hrchy_read(mem_space, hrchy, &phy_addr, DATA, &word));
+	word_as_byte[byte_index] = p_byte;  //set the byte wanted inside the word
+	return cache_hrchy_write(mem_space, hrchy, &phy_addr, &word);
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_read_block(void * mem_space, const cache_hrchy_t * hrchy, phy_addr_t * paddr, mem_access_t access,
+                           uint8_t * bytes, size_t length){
+	M_REQUIRE_NON_NULL(mem_space);
+	check_hrchy(hrchy);
+	check_block(paddr, bytes, length);
+	M_REQUIRE(access == INSTRUCTION || access == DATA, ERR_BAD_PARAMETER, "access is not a valid instance of mem_access_t %c", ' ');
+
+	cache_path_t path;
+	hrchy_path(&path, hrchy, access);
+	return read_block_core(mem_space, phy_to_int(paddr), &path, bytes, length, path.cache[0]->desc.write == WRITE_BACK, access == INSTRUCTION);
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_write_block(void * mem_space, const cache_hrchy_t * hrchy, phy_addr_t * paddr, const uint8_t * bytes, size_t length){
+	M_REQUIRE_NON_NULL(mem_space);
+	check_hrchy(hrchy);
+	check_block(paddr, bytes, length);
+
+	cache_path_t path;
+	hrchy_path(&path, hrchy, DATA);
+	return write_block_core(mem_space, phy_to_int(paddr), &path, bytes, length, path.cache[0]->desc.write == WRITE_BACK,
+	                        path.cache[0]->desc.alloc == NO_WRITE_ALLOCATE);
+	}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hrchy_writeback_all(void * mem_space, const cache_hrchy_t * hrchy){
+	check_hrchy(hrchy);
+	int err = ERR_NONE;
+	for (size_t level = hrchy->levels; level-- > 0; ){ // from the last level : the copies closer to L1 are the most recent
+		if ((err = cache_writeback_all(mem_space, hrchy->dcache[level])) != ERR_NONE) return err;
+		if (hrchy->icache[level] != hrchy->dcache[level]
+		    && (err = cache_writeback_all(mem_space, hrchy->icache[level])) != ERR_NONE) return err;
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+#define PRINT_CACHE_LINE(OUTFILE, CACHE, DESC, LINE_INDEX, WAY) \
     do { \
-        for(uint16_t index = 0; index < LINES; index++) { \
-            foreach_way(way, WAYS) { \
-                fprintf(output, "%02" PRIx8 "/%04" PRIx16 ": ", way, index); \
-                if(cache_valid(TYPE, WAYS, index, way)) \
-                    PRINT_CACHE_LINE(OUTFILE, const TYPE, WAYS, index, way, WORDS_PER_LINE); \
+            fprintf(OUTFILE, "V: %1" PRIx8 ", AGE: %1" PRIx8 ", TAG: 0x%03" PRIx32 ", values: ( ", \
+                        cache_valid(CACHE, DESC, LINE_INDEX, WAY), \
+                        cache_age(CACHE, DESC, LINE_INDEX, WAY), \
+                        cache_tag(CACHE, DESC, LINE_INDEX, WAY)); \
+            for(uint32_t i_ = 0; i_ < (DESC)->words_per_line; i_++) { /* the words of the sectors not read are not shown */ \
+                if (line_sectors(CACHE, DESC, LINE_INDEX, WAY) & (1u << (i_ / ((DESC)->words_per_line / (DESC)->sectors)))) \
+                    fprintf(OUTFILE, "0x%08" PRIx32 " ", \
+                            cache_line(CACHE, DESC, LINE_INDEX, WAY)[i_]); \
                 else \
-                    PRINT_INVALID_CACHE_LINE(OUTFILE, const TYPE, WAYS, index, way, WORDS_PER_LINE);\
+                    fputs("---------- ", OUTFILE); \
             } \
-        } \
+            fputs(")\n", OUTFILE); \
+    } while(0)
+
+#define PRINT_INVALID_CACHE_LINE(OUTFILE, CACHE, DESC, LINE_INDEX, WAY) \
+    do { \
+            fprintf(OUTFILE, "V: %1" PRIx8 ", AGE: -, TAG: -----, values: ( ", \
+                        cache_valid(CACHE, DESC, LINE_INDEX, WAY)); \
+            for(uint32_t i_ = 0; i_ < (DESC)->words_per_line; i_++) \
+                fputs("---------- ", OUTFILE); \
+            fputs(")\n", OUTFILE); \
     } while(0)
 
 //=========================================================================
 // see cache_mng.h
-int cache_dump(FILE* output, const void* cache, cache_t cache_type)
+int cache_dump(FILE* output, const cache_store_t* cache)
 {
     M_REQUIRE_NON_NULL(output);
     M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_NON_NULL(cache->meta);
 
+    const cache_desc_t* desc = &cache->desc;
     fputs("WAY/LINE: V: AGE: TAG: WORDS\n", output);
-    switch (cache_type) { //use the generic macro depending on the type of the cache
-    case L1_ICACHE:
-        DUMP_CACHE_TYPE(output, l1_icache_entry_t, L1_ICACHE_WAYS,
-                        L1_ICACHE_LINES, L1_ICACHE_WORDS_PER_LINE);
-        break;
-    case L1_DCACHE:
-        DUMP_CACHE_TYPE(output, l1_dcache_entry_t, L1_DCACHE_WAYS,
-                        L1_DCACHE_LINES, L1_DCACHE_WORDS_PER_LINE);
-        break;
-    case L2_CACHE:
-        DUMP_CACHE_TYPE(output, l2_cache_entry_t, L2_CACHE_WAYS,
-                        L2_CACHE_LINES, L2_CACHE_WORDS_PER_LINE);
-        break;
-    default:
-        debug_print("%d: unknown cache type", cache_type);
-        return ERR_BAD_PARAMETER;
+    for(uint32_t index = 0; index < desc->lines; index++) {
+        foreach_way(way, desc->ways) {
+            fprintf(output, "%02" PRIx8 "/%04" PRIx32 ": ", way, index);
+            if(cache_valid(cache, desc, index, way))
+                PRINT_CACHE_LINE(output, cache, desc, index, way);
+            else
+                PRINT_INVALID_CACHE_LINE(output, cache, desc, index, way);
+        }
     }
     putc('\n', output);
 
@@ -12,9 +12,7 @@
 #include "addr.h"
 #include "cache.h"
 #include <stdio.h> // for FILE
-
-enum cache_replacement_policy { LRU };
-typedef enum cache_replacement_policy cache_replace_t;
+#include <stdbool.h>
 
 #define HIT_WAY_MISS   ((uint8_t)  -1)
 #define HIT_INDEX_MISS ((uint16_t) -1)
@@ -27,16 +25,101 @@ typedef enum cache_replacement_policy cache_replace_t;
 #define foreach_way(var, ways) \
   for (uint8_t var = 0; var < (ways); var++)
 
+//=========================================================================
+/**
+ * @brief Initialize a cache descriptor, and derive its index and tag widths.
+ * @param desc the descriptor to initialize
+ * @param lines number of sets, power of 2 up to CACHE_MAX_LINES
+ * @param ways associativity, between 1 and CACHE_MAX_WAYS
+ * @param line_bytes size of a line, power of 2 between sizeof(word_t) and CACHE_MAX_LINE_BYTES
+ * @param replace replacement policy (see replacement.h), TREE_PLRU needs a power of 2 number of ways
+ * @return error code
+ */
+int cache_desc_init(cache_desc_t * desc,
+                    uint32_t lines,
+                    uint32_t ways,
+                    uint32_t line_bytes,
+                    cache_replace_t replace);
+
+//=========================================================================
+/**
+ * @brief Initialize a cache descriptor to the fixed configuration of a cache type (cache.h).
+ * @param desc the descriptor to initialize
+ * @param cache_type the preset to use
+ * @return error code
+ */
+int cache_desc_preset(cache_desc_t * desc, cache_t cache_type);
+
+//=========================================================================
+/**
+ * @brief Set the write policy of a cache descriptor (WRITE_THROUGH by default).
+ *        The L1 and L2 caches given to cache_read/cache_write (the caches of a hierarchy)
+ *        must have the same write policy.
+ * @param desc the descriptor
+ * @param write the write policy
+ * @return error code
+ */
+int cache_desc_set_write(cache_desc_t * desc, cache_write_t write);
+
+//=========================================================================
+/**
+ * @brief Set the write-miss policy of a cache descriptor (WRITE_ALLOCATE by default).
+ *        Only the policy of the L1 DCACHE given to cache_write is used.
+ * @param desc the descriptor
+ * @param alloc the write-miss policy
+ * @return error code
+ */
+int cache_desc_set_alloc(cache_desc_t * desc, cache_alloc_t alloc);
+
+//=========================================================================
+/**
+ * @brief Split the lines of a cache descriptor into sectors (1 by default). A sectored line
+ *        keeps a valid and a dirty bit per sector : a miss only reads the sectors the access
+ *        needs from memory, the other ones being read when first accessed (sector misses),
+ *        and only the dirty sectors are written back. The caches of a hierarchy have the
+ *        same sectors ; sectored caches cannot have a victim cache, and need an exclusive
+ *        hierarchy.
+ * @param desc the descriptor (initialized)
+ * @param sectors sectors per line, a power of 2 up to CACHE_MAX_SECTORS, each one of a word at least
+ * @return error code
+ */
+int cache_desc_set_sectors(cache_desc_t * desc, uint32_t sectors);
+
+//=========================================================================
+/**
+ * @brief Seed the pseudo-random generator of a cache (RANDOM and BRRIP policies).
+ *        Caches are seeded with CACHE_DEFAULT_SEED by cache_init().
+ * @param cache the cache
+ * @param seed the seed, non zero
+ * @return error code
+ */
+int cache_set_seed(cache_store_t * cache, uint32_t seed);
+
+//=========================================================================
+/**
+ * @brief Allocate and flush a cache.
+ * @param cache the cache to initialize
+ * @param desc its geometry
+ * @return error code
+ */
+int cache_init(cache_store_t * cache, const cache_desc_t * desc);
+
+//=========================================================================
+/**
+ * @brief Free the entries of a cache.
+ * @param cache the cache to free
+ */
+void cache_free(cache_store_t * cache);
+
 //=========================================================================
 /**
  * @brief Clean a cache (invalidate, reset...).
  *
- * This function erases all cache data.
+ * This function erases all cache data (and the one of its victim cache, if any).
  * @param cache pointer to the cache
- * @param cache_type an enum to distinguish between different caches
  * @return error code
  */
-int cache_flush(void *cache, cache_t cache_type);
+int cache_flush(cache_store_t * cache);
 
 //=========================================================================
 /**
@@ -47,22 +130,20 @@ int cache_flush(void *cache, cache_t cache_type);
  * On miss, update hit infos to HIT_WAY_MISS or HIT_INDEX_MISS.
  *
  * @param mem_space starting address of the memory space
- * @param cache pointer to the beginning of the cache
+ * @param cache pointer to the cache
  * @param paddr pointer to physical address
  * @param p_line pointer to a cache-line-size chunk of data to return
  * @param hit_way (modified) cache way where hit was detected, HIT_WAY_MISS on miss
  * @param hit_index (modified) cache line index where hit was detected, HIT_INDEX_MISS on miss
- * @param cache_type to distinguish between different caches
  * @return error code
  */
 
 int cache_hit (const void * mem_space,
-               void * cache,
+               cache_store_t * cache,
                phy_addr_t * paddr,
                const uint32_t ** p_line,
                uint8_t *hit_way,
-               uint16_t *hit_index,
-               cache_t cache_type);
+               uint16_t *hit_index);
 
 //=========================================================================
 /**
@@ -70,16 +151,14 @@ int cache_hit (const void * mem_space,
  *
  * @param cache_line_index the number of the line to overwrite
  * @param cache_way the number of the way where to insert
- * @param cache_line_in pointer to the cache line to insert
+ * @param cache_line_in pointer to the cache entry to insert
  * @param cache pointer to the cache
- * @param cache_type to distinguish between different caches
  * @return error code
  */
 int cache_insert(uint16_t cache_line_index,
                  uint8_t cache_way,
-                 const void * cache_line_in,
-                 void * cache,
-                 cache_t cache_type);
+                 const cache_entry_t * cache_line_in,
+                 cache_store_t * cache);
 
 //=========================================================================
 /**
@@ -88,13 +167,13 @@ int cache_insert(uint16_t cache_line_index,
  * @param mem_space starting address of the memory space
  * @param paddr pointer to physical address, to extract the tag
  * @param cache_entry pointer to the entry to be initialized
- * @param cache_type to distinguish between different caches
+ * @param cache the cache the entry is meant for (for its geometry)
  * @return error code
  */
 int cache_entry_init(const void * mem_space,
                      const phy_addr_t * paddr,
-                     void * cache_entry,
-                     cache_t cache_type);
+                     cache_entry_t * cache_entry,
+                     const cache_store_t * cache);
 
 //=========================================================================
 /**
@@ -111,20 +190,20 @@ int cache_entry_init(const void * mem_space,
  *      in L2, then it is fetched from main memory and placed just in L1 and not
  *      in L2.
  *
- * @param mem_space pointer to the memory space
+ * @param mem_space pointer to the memory space (written by write-back caches on evictions)
  * @param paddr pointer to a physical address
  * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache pointer to the L1 CACHE
+ * @param l2_cache pointer to the L2 CACHE (with the same line size as L1)
  * @param word pointer to the word of data that is returned by cache
- * @param replace replacement policy
+ * @param replace replacement policy, the one both caches have been initialized with
  * @return error code
  */
-int cache_read(const void * mem_space,
+int cache_read(void * mem_space,
                phy_addr_t * paddr,
                mem_access_t access,
-               void * l1_cache,
-               void * l2_cache,
+               cache_store_t * l1_cache,
+               cache_store_t * l2_cache,
                uint32_t * word,
                cache_replace_t replace);
 
@@ -135,17 +214,17 @@ int cache_read(const void * mem_space,
  * @param mem_space pointer to the memory space
  * @param p_addr pointer to a physical address
  * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache pointer to the L1 CACHE
+ * @param l2_cache pointer to the L2 CACHE (with the same line size as L1)
  * @param byte pointer to the byte to be returned
- * @param replace replacement policy
+ * @param replace replacement policy, the one both caches have been initialized with
  * @return error code
  */
-int cache_read_byte(const void * mem_space,
+int cache_read_byte(void * mem_space,
                     phy_addr_t * p_paddr,
                     mem_access_t access,
-                    void * l1_cache,
-                    void * l2_cache,
+                    cache_store_t * l1_cache,
+                    cache_store_t * l2_cache,
                     uint8_t * p_byte,
                     cache_replace_t replace);
 
@@ -156,16 +235,16 @@ int cache_read_byte(const void * mem_space,
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache pointer to the L1 CACHE
+ * @param l2_cache pointer to the L2 CACHE (with the same line size as L1)
  * @param word const pointer to the word of data that is to be written to the cache
- * @param replace replacement policy
+ * @param replace replacement policy, the one both caches have been initialized with
  * @return error code
  */
 int cache_write(void * mem_space,
                 phy_addr_t * paddr,
-                void * l1_cache,
-                void * l2_cache,
+                cache_store_t * l1_cache,
+                cache_store_t * l2_cache,
                 const uint32_t * word,
                 cache_replace_t replace);
 
@@ -175,25 +254,354 @@ int cache_write(void * mem_space,
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 ICACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache pointer to the L1 DCACHE
+ * @param l2_cache pointer to the L2 CACHE (with the same line size as L1)
  * @param p_byte pointer to the byte to be returned
- * @param replace replacement policy
+ * @param replace replacement policy, the one both caches have been initialized with
  * @return error code
  */
 int cache_write_byte(void * mem_space,
                      phy_addr_t * paddr,
-                     void * l1_cache,
-                     void * l2_cache,
+                     cache_store_t * l1_cache,
+                     cache_store_t * l2_cache,
                      uint8_t p_byte,
                      cache_replace_t replace);
 
+//=========================================================================
+/**
+ * @brief Ask cache for a block of bytes (e.g. the source of a memcpy), at any address :
+ *        the block is split at the line boundaries and each of its lines is looked up
+ *        once (see cache_read), instead of once per word. Endianess: LITTLE.
+ *
+ * @param mem_space pointer to the memory space
+ * @param paddr pointer to the physical address of the first byte (the block is physically contiguous)
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param l1_cache pointer to the L1 CACHE (its block counters are updated)
+ * @param l2_cache pointer to the L2 CACHE (with the same line size as L1)
+ * @param bytes the bytes returned by cache
+ * @param length number of bytes
+ * @param replace replacement policy, the one both caches have been initialized with
+ * @return error code
+ */
+int cache_read_block(void * mem_space,
+                     phy_addr_t * paddr,
+                     mem_access_t access,
+                     cache_store_t * l1_cache,
+                     cache_store_t * l2_cache,
+                     uint8_t * bytes,
+                     size_t length,
+                     cache_replace_t replace);
+
+//=========================================================================
+/**
+ * @brief Write a block of bytes to cache (see cache_read_block and cache_write).
+ *
+ * @param mem_space pointer to the memory space
+ * @param paddr pointer to the physical address of the first byte (the block is physically contiguous)
+ * @param l1_cache pointer to the L1 DCACHE (its block counters are updated)
+ * @param l2_cache pointer to the L2 CACHE (with the same line size as L1)
+ * @param bytes the bytes to be written
+ * @param length number of bytes
+ * @param replace replacement policy, the one both caches have been initialized with
+ * @return error code
+ */
+int cache_write_block(void * mem_space,
+                      phy_addr_t * paddr,
+                      cache_store_t * l1_cache,
+                      cache_store_t * l2_cache,
+                      const uint8_t * bytes,
+                      size_t length,
+                      cache_replace_t replace);
+
 //=========================================================================
 /**
  * @brief Print the contents of a cache to a stream.
  * @param output the stream to print to.
  * @param cache pointer to the cache
- * @param cache_type to distinguish between different caches
  * @return error code
  */
-int cache_dump(FILE* output, const void* cache, cache_t cache_type);
+int cache_dump(FILE* output, const cache_store_t* cache);
+
+//=========================================================================
+/**
+ * @brief Write all the dirty lines of a cache (and of its victim cache, if any) back to memory
+ *        (they stay valid, but clean). Call it for the L1 DCACHE and the L2 CACHE at the end
+ *        of a simulation with write-back caches.
+ * @param mem_space pointer to the memory space
+ * @param cache pointer to the cache
+ * @return error code
+ */
+int cache_writeback_all(void * mem_space, cache_store_t * cache);
+
+//=========================================================================
+/**
+ * @brief Snoop a cache for a line (coherence between caches, see multicore.h) :
+ *        look the line up without touching the replacement state, then apply action
+ *        to every copy of the line in its set.
+ * @param mem_space pointer to the memory space (for write-backs)
+ * @param cache pointer to the cache
+ * @param paddr pointer to a physical address of the line
+ * @param action what to do with the copies (see cache_snoop_t)
+ * @param hit (modified) whether the cache held the line
+ * @param dirty (modified) whether one of its copies was dirty
+ * @return error code
+ */
+int cache_snoop(void * mem_space, cache_store_t * cache, const phy_addr_t * paddr, cache_snoop_t action, bool * hit, bool * dirty);
+
+//=========================================================================
+/**
+ * @brief Put a write buffer between a cache and memory : the stores of the cache
+ *        to memory are then merged in the buffer, and the lines read from memory
+ *        take the words still in the buffer. The L1 and L2 caches given to
+ *        cache_read/cache_write must share the same write buffer (or none).
+ *        The buffer has to be drained (write_buffer_drain()) at the end.
+ * @param cache pointer to the cache
+ * @param wbuf the write buffer, with the line size of the cache (NULL : no buffer)
+ * @return error code
+ */
+int cache_set_write_buffer(cache_store_t * cache, struct write_buffer * wbuf);
+
+//=========================================================================
+/**
+ * @brief Attach a miss classifier to a cache (optional analysis, see miss_class.h) :
+ *        every lookup of the cache by cache_read/cache_write (or a hierarchy) is then
+ *        recorded, and its misses classified as compulsory, capacity or conflict.
+ * @param cache pointer to the cache
+ * @param mclass the classifier, initialized with the geometry of the cache (NULL : no analysis)
+ * @return error code
+ */
+int cache_set_miss_class(cache_store_t * cache, struct miss_class * mclass);
+
+//=========================================================================
+/**
+ * @brief Attach a prefetcher to a cache (see prefetch.h) : it then observes the lookups of
+ *        the cache by cache_read/cache_write (or a hierarchy) and fills the lines it predicts
+ *        into its level of the hierarchy. The demand counters of the caches do not count
+ *        these fills, the activity of the prefetcher is in its own counters.
+ * @param cache pointer to the cache
+ * @param pf the prefetcher, initialized with the line size of the cache (NULL : no prefetching)
+ * @return error code
+ */
+int cache_set_prefetcher(cache_store_t * cache, struct prefetcher * pf);
+
+//=========================================================================
+/**
+ * @brief Attach a timing model to an L1 cache (see timing.h) : every access starting at the
+ *        cache through cache_read/cache_write (or a hierarchy) is then charged the latencies of
+ *        the levels it looked up, plus DRAM if it went to memory. Prefetches are not charged.
+ * @param cache pointer to the L1 cache
+ * @param timing the timing model (NULL : no timing)
+ * @return error code
+ */
+int cache_set_timing(cache_store_t * cache, struct timing * timing);
+
+//=========================================================================
+/**
+ * @brief Make an L1 cache non-blocking with MSHRs (see mshr.h) : with a timing model, the
+ *        accesses starting at the cache then only hold the processor for its lookup, a miss
+ *        keeping an MSHR busy for its full latency, plus the stall of the misses finding them
+ *        all busy.
+ * @param cache pointer to the L1 cache
+ * @param mshr the MSHRs, initialized with the line size of the cache (NULL : blocking cache)
+ * @return error code
+ */
+int cache_set_mshr(cache_store_t * cache, struct mshr * mshr);
+
+//=========================================================================
+/**
+ * @brief Partition the ways of a cache between its tenants (see partition.h) :
+ *        the fills of each tenant only take the ways of its mask.
+ * @param cache the cache (shared by the tenants, e.g. the L2 of a multi-core system)
+ * @param part its partition (same ways), NULL to remove it
+ * @return error code
+ */
+int cache_set_partition(cache_store_t * cache, struct way_partition * part);
+
+//=========================================================================
+/**
+ * @brief Initialize an empty victim cache (see victim_cache_t) for an L1 cache.
+ * @param victim the victim cache
+ * @param entries its number of entries (1 to CACHE_MAX_VICTIMS)
+ * @param l1_desc geometry of the L1 : the victim cache takes its line size and write policy
+ * @return error code
+ */
+int cache_victim_init(victim_cache_t * victim, uint32_t entries, const cache_desc_t * l1_desc);
+
+//=========================================================================
+/**
+ * @brief Free the entries of a victim cache.
+ */
+void cache_victim_free(victim_cache_t * victim);
+
+//=========================================================================
+/**
+ * @brief Attach a victim cache to an L1 cache : the lines the L1 evicts then go into the
+ *        victim cache, whose evictions go to the next level, and the accesses missing the
+ *        L1 through cache_read/cache_write (or a hierarchy) look it up before the next level.
+ *        It is flushed and written back with its L1 (cache_flush(), cache_writeback_all()),
+ *        and its lookups are charged the victim latency of the timing model of the L1.
+ *        The L1s of a multi-core system cannot have one (it is not snooped).
+ * @param cache pointer to the L1 cache
+ * @param victim the victim cache, initialized for the L1 and sharing its write buffer (NULL : none)
+ * @return error code
+ */
+int cache_set_victim(cache_store_t * cache, victim_cache_t * victim);
+
+//=========================================================================
+/**
+ * @brief Initialize an empty hierarchy of caches (see cache_hrchy_add_level()).
+ * @param hrchy the hierarchy
+ * @return error code
+ */
+int cache_hrchy_init(cache_hrchy_t * hrchy);
+
+//=========================================================================
+/**
+ * @brief Add a level below the last one of a hierarchy (the first one added is L1).
+ *        Its caches must have the line size, write policy and write buffer of the other ones.
+ * @param hrchy the hierarchy, with less than CACHE_MAX_LEVELS levels
+ * @param icache the cache of the level for the instruction fetches
+ * @param dcache the cache of the level for the data accesses, icache for a unified level
+ * @return error code
+ */
+int cache_hrchy_add_level(cache_hrchy_t * hrchy, cache_store_t * icache, cache_store_t * dcache);
+
+//=========================================================================
+/**
+ * @brief Set the inclusion policy of a hierarchy (see cache_inclusion_t), CACHE_EXCLUSIVE being
+ *        the one of a new hierarchy and of cache_read/cache_write. The L1s of an inclusive or
+ *        NINE hierarchy cannot have victim caches.
+ * @param hrchy the hierarchy
+ * @param inclusion its policy
+ * @return error code
+ */
+int cache_hrchy_set_inclusion(cache_hrchy_t * hrchy, cache_inclusion_t inclusion);
+
+//=========================================================================
+/**
+ * @brief Ask a hierarchy for a word of data.
+ *  The levels are looked up in turn from L1, following the inclusion policy of the hierarchy
+ *  (see cache_inclusion_t). Exclusive policy (see cache_read), generalised to any number of
+ *  levels : a line found in one of them is moved to L1, and a line evicted from a level is
+ *  placed in the next one (written back if it was dirty and evicted from the last level).
+ *  A line not found is fetched from main memory into L1. Inclusive and NINE policies : a line
+ *  found is copied into every level above it, a line not found is fetched into every level.
+ *  Each cache uses its own replacement policy.
+ *
+ * @param mem_space pointer to the memory space
+ * @param hrchy the hierarchy
+ * @param paddr pointer to a physical address
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param word pointer to the word of data that is returned by the hierarchy
+ * @return error code
+ */
+int cache_hrchy_read(void * mem_space,
+                     const cache_hrchy_t * hrchy,
+                     phy_addr_t * paddr,
+                     mem_access_t access,
+                     uint32_t * word);
+
+//=========================================================================
+/**
+ * @brief Ask a hierarchy for a byte of data. Endianess: LITTLE.
+ *
+ * @param mem_space pointer to the memory space
+ * @param hrchy the hierarchy
+ * @param p_paddr pointer to a physical address
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param p_byte pointer to the byte to be returned
+ * @return error code
+ */
+int cache_hrchy_read_byte(void * mem_space,
+                          const cache_hrchy_t * hrchy,
+                          phy_addr_t * p_paddr,
+                          mem_access_t access,
+                          uint8_t * p_byte);
+
+//=========================================================================
+/**
+ * @brief Change a word of data in a hierarchy (see cache_hrchy_read and cache_write).
+ *        The write-miss policy is the one of the L1 DCACHE.
+ *
+ * @param mem_space pointer to the memory space
+ * @param hrchy the hierarchy
+ * @param paddr pointer to a physical address
+ * @param word const pointer to the word of data that is to be written
+ * @return error code
+ */
+int cache_hrchy_write(void * mem_space,
+                      const cache_hrchy_t * hrchy,
+                      phy_addr_t * paddr,
+                      const uint32_t * word);
+
+//=========================================================================
+/**
+ * @brief Write a byte of data to a hierarchy. Endianess: LITTLE.
+ *
+ * @param mem_space pointer to the memory space
+ * @param hrchy the hierarchy
+ * @param paddr pointer to a physical address
+ * @param p_byte the byte to be written
+ * @return error code
+ */
+int cache_hrchy_write_byte(void * mem_space,
+                           const cache_hrchy_t * hrchy,
+                           phy_addr_t * paddr,
+                           uint8_t p_byte);
+
+//=========================================================================
+/**
+ * @brief Ask a hierarchy for a block of bytes, one lookup per line (see cache_read_block).
+ *
+ * @param mem_space pointer to the memory space
+ * @param hrchy the hierarchy
+ * @param paddr pointer to the physical address of the first byte
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param bytes the bytes returned by the hierarchy
+ * @param length number of bytes
+ * @return error code
+ */
+int cache_hrchy_read_block(void * mem_space,
+                           const cache_hrchy_t * hrchy,
+                           phy_addr_t * paddr,
+                           mem_access_t access,
+                           uint8_t * bytes,
+                           size_t length);
+
+//=========================================================================
+/**
+ * @brief Write a block of bytes to a hierarchy, one lookup per line (see cache_read_block).
+ *
+ * @param mem_space pointer to the memory space
+ * @param hrchy the hierarchy
+ * @param paddr pointer to the physical address of the first byte
+ * @param bytes the bytes to be written
+ * @param length number of bytes
+ * @return error code
+ */
+int cache_hrchy_write_block(void * mem_space,
+                            const cache_hrchy_t * hrchy,
+                            phy_addr_t * paddr,
+                            const uint8_t * bytes,
+                            size_t length);
+
+//=========================================================================
+/**
+ * @brief Write all the dirty lines of a hierarchy back to memory (see cache_writeback_all()),
+ *        from the last level up to L1.
+ * @param mem_space pointer to the memory space
+ * @param hrchy the hierarchy
+ * @return error code
+ */
+int cache_hrchy_writeback_all(void * mem_space, const cache_hrchy_t * hrchy);
+
+#ifdef CACHE_COUNT_COPIES
+//=========================================================================
+/**
+ * @brief Bytes of lines copied by the engine since the program started (from memory, between
+ *        levels, to and from the buffers of the accesses). Only built with -DCACHE_COUNT_COPIES
+ *        (see bench-copies.c).
+ * @return number of bytes copied
+ */
+uint64_t cache_copied_bytes(void);
+#endif
@@ -0,0 +1,300 @@
+/**
+ * @file checkpoint.c
+ * @brief checkpoints of a simulation : its caches, TLBs, memory and position in the
+ *        trace, saved to a versioned binary file and restored by mapping the file
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for mmap() under -std=c11
+
+#include "checkpoint.h"
+#include "write_buffer.h"
+#include "error.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Header of a checkpoint file
+ */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t nb_caches;
+	uint32_t has_tlb;
+	uint32_t has_tlb_stats;
+	uint32_t has_timing;
+	uint64_t mem_size;
+	uint64_t position;
+	} checkpoint_header_t;
+
+/*
+ * A cache in a checkpoint file, followed by its metadata and its lines
+ */
+typedef struct {
+	cache_desc_t desc;
+	cache_counters_t counters;
+	cache_block_counters_t blocks;
+	cache_inclusion_counters_t inclusion;
+	cache_sector_counters_t sectors;
+	uint32_t seed;
+	uint32_t has_victim;
+	} checkpoint_cache_t;
+
+/*
+ * The statistics attached to a TLB hierarchy in a checkpoint file : its counters
+ * (not its names nor its periodic exports, which belong to the run)
+ */
+typedef struct {
+	tlb_counters_t counters[TLB_STATS_MAX];
+	uint64_t accesses;
+	} checkpoint_tlb_stats_t;
+
+#define meta_bytes(desc) ((size_t) (desc)->lines * cache_set_words(desc) * sizeof(uint32_t))
+#define lines_bytes(desc) ((size_t) (desc)->lines * (desc)->ways * (desc)->line_bytes)
+#define entries_bytes(geo) ((size_t) (geo)->lines * (geo)->ways * sizeof(tlb_hrchy_entry_t))
+
+/**
+ * @brief write size bytes to file, ok becoming false if they could not be
+ */
+#define put(file, PTR, SIZE, ok) \
+	(ok) = (ok) && ((SIZE) == 0 || fwrite(PTR, SIZE, 1, file) == 1)
+
+/**
+ * @brief save a cache : its record, metadata and lines
+ */
+static bool save_cache(FILE* file, const cache_store_t* cache){
+	checkpoint_cache_t record;
+	memset(&record, 0, sizeof(record));
+	record.desc = cache->desc;
+	record.counters = cache->counters;
+	record.blocks = cache->blocks;
+	record.inclusion = cache->inclusion;
+	record.sectors = cache->sectors;
+	record.seed = cache->seed;
+	record.has_victim = cache->victim != NULL;
+	bool ok = true;
+	put(file, &record, sizeof(record), ok);
+	put(file, cache->meta, meta_bytes(&cache->desc), ok);
+	put(file, cache->lines, lines_bytes(&cache->desc), ok);
+	return ok;
+	}
+
+//=========================================================================
+int sim_checkpoint_save(const char * filename, const sim_state_t * state){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(state);
+	M_REQUIRE_NON_NULL(state->mem_space);
+	M_REQUIRE(state->nb_caches <= SIM_CHECKPOINT_MAX_CACHES, ERR_BAD_PARAMETER, "a checkpoint holds at most %u caches", SIM_CHECKPOINT_MAX_CACHES);
+	for (size_t c = 0; c < state->nb_caches; c++){
+		const cache_store_t* cache = state->caches[c];
+		M_REQUIRE_NON_NULL(cache);
+		M_REQUIRE(cache->wbuf == NULL || cache->wbuf->count == 0, ERR_BAD_PARAMETER, "the write buffer of cache %zu must be drained", c);
+		}
+
+	FILE* file = fopen(filename, "wb");
+	M_REQUIRE(file != NULL, ERR_IO, "cannot create %s", filename);
+	checkpoint_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SIM_CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = SIM_CHECKPOINT_VERSION;
+	header.nb_caches = (uint32_t) state->nb_caches;
+	header.has_tlb = state->tlb != NULL;
+	header.has_tlb_stats = state->tlb != NULL && state->tlb->stats != NULL;
+	header.has_timing = state->timing != NULL;
+	header.mem_size = state->mem_size;
+	header.position = state->position;
+	bool ok = true;
+	put(file, &header, sizeof(header), ok);
+	for (size_t c = 0; ok && c < state->nb_caches; c++){
+		const cache_store_t* cache = state->caches[c];
+		ok = save_cache(file, cache);
+		if (ok && cache->victim != NULL){
+			ok = save_cache(file, &cache->victim->store);
+			put(file, &cache->victim->counters, sizeof(cache_victim_counters_t), ok);
+			}
+		}
+	if (state->tlb != NULL){
+		const tlb_hrchy_t* tlb = state->tlb;
+		put(file, &tlb->desc, sizeof(tlb_hrchy_desc_t), ok);
+		put(file, &tlb->policy_stats, sizeof(tlb_policy_stats_t), ok);
+		if (tlb->stats != NULL){
+			checkpoint_tlb_stats_t stats;
+			memset(&stats, 0, sizeof(stats));
+			memcpy(stats.counters, tlb->stats->counters, sizeof(stats.counters));
+			stats.accesses = tlb->stats->accesses;
+			put(file, &stats, sizeof(stats), ok);
+			}
+		for (size_t t = 0; t < tlb->desc.nb_tlbs; t++) put(file, tlb->tlb[t], entries_bytes(&tlb->desc.tlb[t]), ok);
+		}
+	if (state->timing != NULL) put(file, state->timing, sizeof(timing_t), ok);
+	put(file, state->mem_space, state->mem_size, ok);
+	ok = (fclose(file) == 0) && ok;
+	M_REQUIRE(ok, ERR_IO, "cannot write %s", filename);
+	return ERR_NONE;
+	}
+
+/*
+ * Checkpoint file mapped in memory, read from its start
+ */
+typedef struct {
+	const uint8_t* data;
+	size_t size;
+	size_t offset;
+	} reader_t;
+
+/**
+ * @brief the next size bytes of a checkpoint, NULL if it is too short
+ *        (at any offset : not to be read in place as a structure, see take_copy)
+ */
+static const void* take(reader_t* reader, size_t size){
+	if (size > reader->size - reader->offset) return NULL;
+	const void* bytes = reader->data + reader->offset;
+	reader->offset += size;
+	return bytes;
+	}
+
+/**
+ * @brief copy the next size bytes of a checkpoint into record (aligned, unlike the mapping),
+ *        false if it is too short
+ */
+static bool take_into(reader_t* reader, void* record, size_t size){
+	const void* bytes = take(reader, size);
+	if (bytes == NULL) return false;
+	memcpy(record, bytes, size);
+	return true;
+	}
+
+/**
+ * @brief copy the next record of a checkpoint into *PTR
+ */
+#define take_copy(reader, PTR) take_into(reader, PTR, sizeof(*(PTR)))
+
+/**
+ * @brief whether a cache was saved with the geometry and policies of another one
+ */
+static bool same_cache(const cache_desc_t* a, const cache_desc_t* b){
+	return a->lines == b->lines && a->ways == b->ways && a->line_bytes == b->line_bytes
+	       && a->replace == b->replace && a->write == b->write && a->alloc == b->alloc && a->sectors == b->sectors;
+	}
+
+/**
+ * @brief check the next cache of a checkpoint against a cache and, if apply, restore it
+ */
+static bool load_cache(reader_t* reader, cache_store_t* cache, bool apply){
+	checkpoint_cache_t record;
+	if (!take_copy(reader, &record) || !same_cache(&record.desc, &cache->desc) || record.has_victim != (cache->victim != NULL)) return false;
+	const void* meta = take(reader, meta_bytes(&cache->desc));
+	const void* lines = take(reader, lines_bytes(&cache->desc));
+	if (meta == NULL || lines == NULL) return false;
+	if (apply){
+		cache->counters = record.counters;
+		cache->blocks = record.blocks;
+		cache->inclusion = record.inclusion;
+		cache->sectors = record.sectors;
+		cache->seed = record.seed;
+		memcpy(cache->meta, meta, meta_bytes(&cache->desc));
+		memcpy(cache->lines, lines, lines_bytes(&cache->desc));
+		}
+	return true;
+	}
+
+/**
+ * @brief whether a TLB hierarchy was saved with the geometry and policy of another one
+ */
+static bool same_tlb(const tlb_hrchy_desc_t* a, const tlb_hrchy_desc_t* b){
+	if (a->nb_tlbs != b->nb_tlbs || a->policy != b->policy) return false;
+	for (size_t t = 0; t < a->nb_tlbs; t++){
+		const tlb_geometry_t* x = &a->tlb[t];
+		const tlb_geometry_t* y = &b->tlb[t];
+		if (x->lines != y->lines || x->ways != y->ways || x->level != y->level || x->serves != y->serves) return false;
+		}
+	return true;
+	}
+
+/**
+ * @brief check a checkpoint against a state and, if apply, restore it
+ *        (first called to check, then to restore : a state is restored whole, or not at all)
+ */
+static bool load_state(reader_t* reader, sim_state_t* state, bool apply){
+	reader->offset = 0;
+	checkpoint_header_t header;
+	if (!take_copy(reader, &header) || memcmp(header.magic, SIM_CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+	    || header.version != SIM_CHECKPOINT_VERSION || header.nb_caches != state->nb_caches
+	    || header.has_tlb != (state->tlb != NULL) || header.has_timing != (state->timing != NULL)
+	    || header.has_tlb_stats != (state->tlb != NULL && state->tlb->stats != NULL)
+	    || header.mem_size != state->mem_size) return false;
+	for (size_t c = 0; c < state->nb_caches; c++){
+		cache_store_t* cache = state->caches[c];
+		if (!load_cache(reader, cache, apply)) return false;
+		if (cache->victim != NULL){
+			cache_victim_counters_t counters;
+			if (!load_cache(reader, &cache->victim->store, apply) || !take_copy(reader, &counters)) return false;
+			if (apply) cache->victim->counters = counters;
+			}
+		}
+	if (state->tlb != NULL){
+		tlb_hrchy_t* tlb = state->tlb;
+		tlb_hrchy_desc_t desc;
+		tlb_policy_stats_t policy_stats;
+		if (!take_copy(reader, &desc) || !take_copy(reader, &policy_stats) || !same_tlb(&desc, &tlb->desc)) return false;
+		if (apply) tlb->policy_stats = policy_stats;
+		if (tlb->stats != NULL){
+			checkpoint_tlb_stats_t stats;
+			if (!take_copy(reader, &stats)) return false;
+			if (apply){
+				memcpy(tlb->stats->counters, stats.counters, sizeof(stats.counters));
+				tlb->stats->accesses = stats.accesses;
+				}
+			}
+		for (size_t t = 0; t < tlb->desc.nb_tlbs; t++){
+			const void* entries = take(reader, entries_bytes(&tlb->desc.tlb[t]));
+			if (entries == NULL) return false;
+			if (apply) memcpy(tlb->tlb[t], entries, entries_bytes(&tlb->desc.tlb[t]));
+			}
+		}
+	if (state->timing != NULL){
+		timing_t timing;
+		if (!take_copy(reader, &timing)) return false;
+		if (apply) *state->timing = timing;
+		}
+	const void* memory = take(reader, state->mem_size);
+	if (memory == NULL || reader->offset != reader->size) return false;
+	if (apply){
+		memcpy(state->mem_space, memory, state->mem_size);
+		state->position = header.position;
+		}
+	return true;
+	}
+
+//=========================================================================
+int sim_checkpoint_load(const char * filename, sim_state_t * state){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(state);
+	M_REQUIRE_NON_NULL(state->mem_space);
+	M_REQUIRE(state->nb_caches <= SIM_CHECKPOINT_MAX_CACHES, ERR_BAD_PARAMETER, "a checkpoint holds at most %u caches", SIM_CHECKPOINT_MAX_CACHES);
+	for (size_t c = 0; c < state->nb_caches; c++) M_REQUIRE_NON_NULL(state->caches[c]);
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "cannot open %s", filename);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(checkpoint_header_t)){
+		close(fd);
+		M_EXIT_ERR(ERR_IO, ", %s is not a checkpoint", filename);
+		}
+	reader_t reader = { NULL, (size_t) st.st_size, 0 };
+	void* data = mmap(NULL, reader.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping stays valid
+	M_REQUIRE(data != MAP_FAILED, ERR_IO, "cannot map %s", filename);
+	reader.data = data;
+	bool ok = load_state(&reader, state, false) && load_state(&reader, state, true);
+	munmap(data, reader.size);
+	M_REQUIRE(ok, ERR_IO, "%s does not match the state to restore", filename);
+	return ERR_NONE;
+	}
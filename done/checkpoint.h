@@ -0,0 +1,78 @@
+#pragma once
+
+/**
+ * @file checkpoint.h
+ * @brief checkpoints of a simulation : the state of its caches, TLBs and memory, and
+ *        its position in the trace, saved to a versioned binary file and restored from it,
+ *        so that many measurement runs can start from the same warm state
+ *
+ * A checkpoint file is made of a header (magic, version, what it holds), then of :
+ *  - each cache : its geometry, counters, replacement state, metadata and lines, then
+ *    the same for its victim cache, if any, followed by the counters of the victim cache
+ *  - the TLB hierarchy, if any : its geometry, inclusion counters, per-TLB statistics
+ *    (if it has some attached) and entries
+ *  - the timing model, if any
+ *  - the memory
+ * in the byte order and structure layout of the host : a checkpoint is restored by the
+ * build which saved it (see SIM_CHECKPOINT_VERSION).
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h"
+#include "tlb_hrchy.h"
+#include "timing.h"
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+#define SIM_CHECKPOINT_MAGIC "TLBCKPT" // 8 bytes, with its '\0'
+#define SIM_CHECKPOINT_VERSION 8u      // to change with the layout of a checkpoint, or of the structures it holds
+#define SIM_CHECKPOINT_MAX_CACHES (2u * CACHE_MAX_LEVELS) // split levels counting twice
+
+/*
+ * State of a simulation, as saved and restored by a checkpoint (nothing owned) :
+ *  - caches    : its caches, in any order, each one with its victim cache if it has one
+ *  - nb_caches : number of caches
+ *  - tlb       : its TLB hierarchy, NULL if none, with its statistics if it has some attached
+ *                (their counters are restored, their names and periodic exports are left as they are)
+ *  - timing    : its timing model, NULL if none
+ *  - mem_space : the memory
+ *  - mem_size  : size of the memory, in bytes
+ *  - position  : commands of the trace already executed
+ * The components attached to the caches other than their victim caches (write buffer,
+ * miss classifier, prefetcher, MSHRs, way partition) are not part of a checkpoint : the
+ * write buffer must be drained before a save, the other ones start cold after a restore.
+ */
+typedef struct {
+	cache_store_t* caches[SIM_CHECKPOINT_MAX_CACHES];
+	size_t nb_caches;
+	tlb_hrchy_t* tlb;
+	timing_t* timing;
+	void* mem_space;
+	size_t mem_size;
+	uint64_t position;
+	} sim_state_t;
+
+//=========================================================================
+/**
+ * @brief Save the state of a simulation to a checkpoint file.
+ * @param filename the file, created or overwritten
+ * @param state the state (its write buffers empty)
+ * @return error code
+ */
+int sim_checkpoint_save(const char * filename, const sim_state_t * state);
+
+//=========================================================================
+/**
+ * @brief Restore the state of a simulation from a checkpoint file, which is mapped in memory
+ *        and copied into the state : caches (and victim caches) of the same geometries and
+ *        policies, in the same order, TLB hierarchy of the same geometry (with statistics
+ *        attached if it was saved with some) and timing model if the checkpoint holds them,
+ *        and memory of the same size. position is restored.
+ * @param filename the file
+ * @param state (modified) the state, initialized
+ * @return error code (ERR_IO if the file is not a checkpoint of this version, or does not
+ *         match the state)
+ */
+int sim_checkpoint_load(const char * filename, sim_state_t * state);
@@ -0,0 +1,149 @@
+/**
+ * @file miss_class.c
+ * @brief analysis of the misses of a cache (three C's) : each miss is classified as
+ *        compulsory (first access to the line), capacity (also a miss in a fully
+ *        associative LRU cache of the same capacity) or conflict (a hit in that cache)
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "miss_class.h"
+#include "error.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_NODE ((uint32_t) -1)
+#define home_slot(mclass, key) ((uint32_t) ((key) * 2654435761u) >> (mclass)->shift) // Fibonacci hashing : the high bits of the product
+
+//=========================================================================
+int miss_class_init(miss_class_t * mclass, const cache_desc_t * desc){
+	M_REQUIRE_NON_NULL(mclass);
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(desc->lines > 0 && desc->ways > 0, ERR_BAD_PARAMETER, "invalid geometry %c", ' ');
+	memset(mclass, 0, sizeof(miss_class_t));
+	mclass->capacity = desc->lines * desc->ways;
+	mclass->line_bits = desc->line_bits;
+	mclass->head = mclass->tail = NO_NODE;
+	uint32_t table_size = 2;
+	mclass->shift = 31;
+	while (table_size < 2 * mclass->capacity){ // at most half full
+		table_size <<= 1;
+		mclass->shift--;
+		}
+	mclass->mask = table_size - 1;
+	size_t lines = (size_t) 1 << (32 - desc->line_bits); // lines of the physical address space
+	mclass->touched = calloc((lines + 63) / 64, sizeof(uint64_t));
+	mclass->keys = calloc(mclass->capacity, sizeof(uint32_t));
+	mclass->prev = calloc(mclass->capacity, sizeof(uint32_t));
+	mclass->next = calloc(mclass->capacity, sizeof(uint32_t));
+	mclass->table = calloc(table_size, sizeof(uint32_t));
+	if (mclass->touched == NULL || mclass->keys == NULL || mclass->prev == NULL || mclass->next == NULL || mclass->table == NULL){
+		miss_class_free(mclass);
+		return ERR_MEM;
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+void miss_class_free(miss_class_t * mclass){
+	if (mclass == NULL) return;
+	free(mclass->touched);
+	free(mclass->keys);
+	free(mclass->prev);
+	free(mclass->next);
+	free(mclass->table);
+	mclass->touched = NULL;
+	mclass->keys = mclass->prev = mclass->next = mclass->table = NULL;
+	mclass->capacity = mclass->count = 0;
+	}
+
+/**
+ * @brief slot of the table holding the node of a line, or the empty slot ending its probe sequence
+ */
+static uint32_t find_slot(const miss_class_t * mclass, uint32_t key){
+	uint32_t slot = home_slot(mclass, key);
+	while (mclass->table[slot] != 0 && mclass->keys[mclass->table[slot] - 1] != key) slot = (slot + 1) & mclass->mask;
+	return slot;
+	}
+
+/**
+ * @brief empty a slot of the table, moving back the nodes of the probe sequences going through it
+ */
+static void remove_slot(miss_class_t * mclass, uint32_t slot){
+	uint32_t next = slot;
+	for (;;){
+		mclass->table[slot] = 0;
+		for (;;){
+			next = (next + 1) & mclass->mask;
+			if (mclass->table[next] == 0) return;
+			uint32_t home = home_slot(mclass, mclass->keys[mclass->table[next] - 1]);
+			// the node stays if its home is cyclically in ]slot, next]
+			bool stays = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+			if (!stays) break;
+			}
+		mclass->table[slot] = mclass->table[next];
+		slot = next;
+		}
+	}
+
+/**
+ * @brief unlink a node from the recency list
+ */
+static void unlink_node(miss_class_t * mclass, uint32_t node){
+	if (mclass->prev[node] != NO_NODE) mclass->next[mclass->prev[node]] = mclass->next[node];
+	else mclass->head = mclass->next[node];
+	if (mclass->next[node] != NO_NODE) mclass->prev[mclass->next[node]] = mclass->prev[node];
+	else mclass->tail = mclass->prev[node];
+	}
+
+/**
+ * @brief link a node at the head (most recently used) of the recency list
+ */
+static void push_front(miss_class_t * mclass, uint32_t node){
+	mclass->prev[node] = NO_NODE;
+	mclass->next[node] = mclass->head;
+	if (mclass->head != NO_NODE) mclass->prev[mclass->head] = node;
+	mclass->head = node;
+	if (mclass->tail == NO_NODE) mclass->tail = node;
+	}
+
+/**
+ * @brief access a line of the shadow cache : it becomes the most recently used one,
+ *        the least recently used one being evicted if it was not there and the cache is full
+ * @return whether the line was in the shadow cache
+ */
+static bool shadow_access(miss_class_t * mclass, uint32_t key){
+	uint32_t slot = find_slot(mclass, key);
+	if (mclass->table[slot] != 0){
+		uint32_t node = mclass->table[slot] - 1;
+		unlink_node(mclass, node);
+		push_front(mclass, node);
+		return true;
+		}
+	uint32_t node = mclass->count;
+	if (mclass->count == mclass->capacity){ // full : evict the least recently used line
+		node = mclass->tail;
+		unlink_node(mclass, node);
+		remove_slot(mclass, find_slot(mclass, mclass->keys[node]));
+		slot = find_slot(mclass, key); // the probe sequence of key may have moved
+		}
+	else mclass->count++;
+	mclass->keys[node] = key;
+	mclass->table[slot] = node + 1;
+	push_front(mclass, node);
+	return false;
+	}
+
+//=========================================================================
+void miss_class_access(miss_class_t * mclass, uint32_t phy_addr, bool hit){
+	uint32_t key = phy_addr >> mclass->line_bits;
+	bool first = (mclass->touched[key / 64] & ((uint64_t) 1 << (key % 64))) == 0;
+	mclass->touched[key / 64] |= (uint64_t) 1 << (key % 64);
+	bool shadow_hit = shadow_access(mclass, key);
+	mclass->counters.accesses++;
+	if (hit) mclass->counters.hits++;
+	else if (first) mclass->counters.misses[MISS_COMPULSORY]++;
+	else if (!shadow_hit) mclass->counters.misses[MISS_CAPACITY]++;
+	else mclass->counters.misses[MISS_CONFLICT]++;
+	}
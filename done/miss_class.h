@@ -0,0 +1,90 @@
+#pragma once
+
+/**
+ * @file miss_class.h
+ * @brief analysis of the misses of a cache (three C's) : each miss is classified as
+ *        compulsory (first access to the line), capacity (also a miss in a fully
+ *        associative LRU cache of the same capacity) or conflict (a hit in that cache)
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h" // for cache_desc_t
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * kinds of misses
+ */
+typedef enum {
+	MISS_COMPULSORY, MISS_CAPACITY, MISS_CONFLICT
+	} miss_kind_t;
+
+#define MISS_KIND_NB (MISS_CONFLICT + 1)
+
+/*
+ * Accesses of the analysed cache :
+ *  - accesses : lookups of the cache
+ *  - hits     : lookups that hit
+ *  - misses   : lookups that missed, by kind
+ */
+typedef struct {
+	uint64_t accesses;
+	uint64_t hits;
+	uint64_t misses[MISS_KIND_NB];
+	} miss_class_counters_t;
+
+/*
+ * Miss classifier of a cache :
+ *  - touched   : first-touch bitmap, one bit per line of the physical address space
+ *  - capacity  : lines of the shadow cache, lines * ways of the analysed cache
+ *  - count     : lines in the shadow cache
+ *  - line_bits : log_2 of the line size
+ *  - keys      : line number (physical address >> line_bits) of each node of the shadow cache
+ *  - prev/next : the nodes as a list from the most (head) to the least (tail) recently used
+ *  - table     : hash table (linear probing) of node + 1 by line number, 0 for an empty slot
+ *  - mask      : size of the table - 1
+ *  - shift     : 32 - log_2 of the size of the table
+ *  - counters  : the classification
+ */
+typedef struct miss_class {
+	uint64_t* touched;
+	uint32_t capacity;
+	uint32_t count;
+	uint8_t line_bits;
+	uint32_t* keys;
+	uint32_t* prev;
+	uint32_t* next;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t* table;
+	uint32_t mask;
+	uint8_t shift;
+	miss_class_counters_t counters;
+	} miss_class_t;
+
+//=========================================================================
+/**
+ * @brief Initialize the classifier of a cache (allocates the shadow cache and the bitmap,
+ *        whose pages are only backed once touched).
+ * @param mclass the classifier to initialize
+ * @param desc geometry of the analysed cache
+ * @return error code
+ */
+int miss_class_init(miss_class_t * mclass, const cache_desc_t * desc);
+
+//=========================================================================
+/**
+ * @brief Free a classifier.
+ */
+void miss_class_free(miss_class_t * mclass);
+
+//=========================================================================
+/**
+ * @brief Record a lookup of the analysed cache, classifying it if it missed.
+ * @param mclass the classifier
+ * @param phy_addr the physical address looked up
+ * @param hit whether the analysed cache hit
+ */
+void miss_class_access(miss_class_t * mclass, uint32_t phy_addr, bool hit);
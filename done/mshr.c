@@ -0,0 +1,92 @@
+/**
+ * @file mshr.c
+ * @brief miss status holding registers : the misses of an L1 cache in flight
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "mshr.h"
+#include "error.h"
+#include <string.h>
+
+//=========================================================================
+int mshr_init(mshr_t * mshr, uint32_t size, uint32_t line_bytes){
+	M_REQUIRE_NON_NULL(mshr);
+	M_REQUIRE(1 <= size && size <= MSHR_MAX_ENTRIES, ERR_SIZE, "size (%u) must be between 1 and %u", size, MSHR_MAX_ENTRIES);
+	M_REQUIRE(line_bytes >= sizeof(word_t) && line_bytes <= CACHE_MAX_LINE_BYTES && (line_bytes & (line_bytes - 1)) == 0,
+	          ERR_SIZE, "line size (%u) must be a power of 2 between 4 and %u", line_bytes, CACHE_MAX_LINE_BYTES);
+	memset(mshr, 0, sizeof(mshr_t));
+	mshr->size = size;
+	while ((1u << mshr->line_bits) < line_bytes) mshr->line_bits++;
+	return ERR_NONE;
+	}
+
+/**
+ * @brief free the i-th MSHR (the last one takes its place)
+ */
+#define release(mshr, i) ((mshr)->entries[i] = (mshr)->entries[--(mshr)->count])
+
+/**
+ * @brief a miss takes an MSHR from cycle start on, for latency cycles
+ */
+static void take(mshr_t * mshr, uint32_t line, uint64_t start, uint64_t latency){
+	mshr_entry_t* entry = &mshr->entries[mshr->count++];
+	entry->line = line;
+	entry->ready = start + latency;
+	mshr_counters_t* counters = &mshr->counters;
+	counters->primary++;
+	if (mshr->count > counters->peak) counters->peak = mshr->count;
+	counters->occupancy += latency;
+	uint64_t from = start > mshr->busy_until ? start : mshr->busy_until; // the misses start in order
+	if (entry->ready > from){
+		counters->busy += entry->ready - from;
+		mshr->busy_until = entry->ready;
+		}
+	}
+
+//=========================================================================
+uint64_t mshr_access(mshr_t * mshr, uint64_t now, uint32_t phy_addr, bool miss, uint64_t hit_cycles, uint64_t miss_cycles, uint64_t * busy){
+	for (uint32_t i = mshr->count; i-- > 0; ){ // the misses arrived
+		if (mshr->entries[i].ready <= now) release(mshr, i);
+		}
+	*busy = hit_cycles;
+	uint32_t line = phy_addr >> mshr->line_bits;
+	for (uint32_t i = 0; i < mshr->count; i++){
+		if (mshr->entries[i].line == line){ // waits for the data of the miss in flight
+			mshr->counters.secondary++;
+			uint64_t wait = mshr->entries[i].ready - now;
+			return wait > hit_cycles ? wait : hit_cycles;
+			}
+		}
+	if (!miss) return hit_cycles;
+	uint64_t stall = 0;
+	if (mshr->count == mshr->size){ // wait for the first miss to arrive
+		uint32_t first = 0;
+		for (uint32_t i = 1; i < mshr->count; i++){
+			if (mshr->entries[i].ready < mshr->entries[first].ready) first = i;
+			}
+		stall = mshr->entries[first].ready - now;
+		release(mshr, first);
+		mshr->counters.stalls++;
+		mshr->counters.stall_cycles += stall;
+		}
+	take(mshr, line, now + stall, miss_cycles);
+	*busy = hit_cycles + stall;
+	return stall + miss_cycles;
+	}
+
+//=========================================================================
+uint64_t mshr_drain(mshr_t * mshr, uint64_t now){
+	uint64_t last = now;
+	for (uint32_t i = 0; i < mshr->count; i++){
+		if (mshr->entries[i].ready > last) last = mshr->entries[i].ready;
+		}
+	mshr->count = 0;
+	return last - now;
+	}
+
+//=========================================================================
+double mshr_mlp(const mshr_t * mshr){
+	return mshr->counters.busy == 0 ? 0.0 : (double) mshr->counters.occupancy / (double) mshr->counters.busy;
+	}
@@ -0,0 +1,120 @@
+#pragma once
+
+/**
+ * @file mshr.h
+ * @brief miss status holding registers : the misses of an L1 cache in flight, which make
+ *        it non-blocking (see cache_set_mshr()). The caches still move the lines at once,
+ *        the MSHRs only change the time of the timing model. An access issues at its clock
+ *        (see timing_cycles()) and holds the processor for the lookup of the L1 only, the
+ *        next access issuing right after it, unless it stalls :
+ *  - a hit takes the lookup of the L1
+ *  - a miss takes a free MSHR until its line arrives, its full latency later, and takes
+ *    that latency ; the processor goes on with the next accesses meanwhile
+ *  - an access to a line in flight (secondary miss) is merged into its MSHR and takes
+ *    the rest of its latency (at least the lookup of the L1)
+ *  - a miss finding all the MSHRs busy stalls the processor until the first one is
+ *    freed, then takes its full latency
+ * The latencies of the accesses (their average memory access time) are thus the ones they
+ * see, while the clock advances by the lookups and the stalls : the execution time of a
+ * processor which never waits for the data it loads (no dependency between the accesses).
+ * A store going around the caches (no-write-allocate) is posted : it takes the lookup.
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MSHR_MAX_ENTRIES 32u
+
+/*
+ * a miss in flight : its line and the cycle at which it arrives
+ */
+typedef struct {
+	uint32_t line;
+	uint64_t ready;
+	} mshr_entry_t;
+
+/*
+ * Activity of the MSHRs of a cache :
+ *  - primary      : misses which took an MSHR
+ *  - secondary    : accesses to a line in flight, merged into its MSHR
+ *  - stalls       : misses which found all the MSHRs busy
+ *  - stall_cycles : cycles they waited for an MSHR
+ *  - peak         : most misses in flight at the same time
+ *  - occupancy    : cycles spent in flight by the misses, summed (the integral of the misses in flight)
+ *  - busy         : cycles with at least one miss in flight
+ * occupancy / busy is the memory-level parallelism : the misses in flight on average, when there are some.
+ */
+typedef struct {
+	uint64_t primary;
+	uint64_t secondary;
+	uint64_t stalls;
+	uint64_t stall_cycles;
+	uint32_t peak;
+	uint64_t occupancy;
+	uint64_t busy;
+	} mshr_counters_t;
+
+/*
+ * MSHRs of a cache :
+ *  - size       : number of MSHRs
+ *  - count      : misses in flight, the first count entries
+ *  - line_bits  : log_2 of the line size of the cache
+ *  - busy_until : cycle at which the last miss in flight arrives
+ *  - entries    : the misses in flight
+ *  - counters   : their activity
+ */
+typedef struct mshr {
+	uint32_t size;
+	uint32_t count;
+	uint8_t line_bits;
+	uint64_t busy_until;
+	mshr_entry_t entries[MSHR_MAX_ENTRIES];
+	mshr_counters_t counters;
+	} mshr_t;
+
+//=========================================================================
+/**
+ * @brief Initialize empty MSHRs.
+ * @param mshr the MSHRs to initialize
+ * @param size number of MSHRs, between 1 and MSHR_MAX_ENTRIES
+ * @param line_bytes line size of the cache (power of 2, at most CACHE_MAX_LINE_BYTES)
+ * @return error code
+ */
+int mshr_init(mshr_t * mshr, uint32_t size, uint32_t line_bytes);
+
+//=========================================================================
+/**
+ * @brief Time an access of the cache : the misses arrived by now leave their MSHR, then the
+ *        access is merged with the miss in flight of its line if any, takes an MSHR if it missed
+ *        (stalling first if they are all busy), or is a hit.
+ * @param mshr the MSHRs
+ * @param now the cycle at which the access issues
+ * @param phy_addr the physical address accessed
+ * @param miss whether the access missed the cache (its line has to be fetched)
+ * @param hit_cycles latency of a lookup of the cache
+ * @param miss_cycles latency of the miss, lookup of the cache included
+ * @param busy (modified) the cycles the access holds the processor : hit_cycles, plus its stall
+ * @return the latency of the access (its stall included)
+ */
+uint64_t mshr_access(mshr_t * mshr, uint64_t now, uint32_t phy_addr, bool miss, uint64_t hit_cycles, uint64_t miss_cycles, uint64_t * busy);
+
+//=========================================================================
+/**
+ * @brief Wait for the misses in flight at the end of a run : they all leave their MSHR.
+ * @param mshr the MSHRs
+ * @param now the current cycle
+ * @return the cycles until the last one arrives (0 if none is in flight), beyond the
+ *         clock of the timing model
+ */
+uint64_t mshr_drain(mshr_t * mshr, uint64_t now);
+
+//=========================================================================
+/**
+ * @brief Memory-level parallelism of the misses of a cache : the misses in flight on
+ *        average, over the cycles with some in flight (0 if there were none).
+ */
+double mshr_mlp(const mshr_t * mshr);
@@ -0,0 +1,232 @@
+/**
+ * @file multicore.c
+ * @brief multi-core simulation : private L1s kept coherent by a MESI snooping
+ *        protocol, and shared lower levels
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "multicore.h"
+#include "cache_mng.h"
+#include "tlb_hrchy_mng.h"
+#include "page_walk.h"
+#include "partition.h"
+#include "error.h"
+#include <inttypes.h> // for PRIu64
+#include <stdlib.h>
+#include <string.h>
+
+#define lost_bit(core, line) ((core)->lost[(line) / 64] & ((uint64_t) 1 << ((line) % 64)))
+#define set_lost(core, line) ((core)->lost[(line) / 64] |= (uint64_t) 1 << ((line) % 64))
+#define clear_lost(core, line) ((core)->lost[(line) / 64] &= ~((uint64_t) 1 << ((line) % 64)))
+
+//=========================================================================
+int multicore_init(multicore_t * mc){
+	M_REQUIRE_NON_NULL(mc);
+	memset(mc, 0, sizeof(multicore_t));
+	return ERR_NONE;
+	}
+
+//=========================================================================
+void multicore_free(multicore_t * mc){
+	if (mc == NULL) return;
+	for (size_t c = 0; c < mc->nb_cores; c++){
+		free(mc->core[c].lost);
+		mc->core[c].lost = NULL;
+		}
+	mc->nb_cores = 0;
+	}
+
+//=========================================================================
+int multicore_add_core(multicore_t * mc, cache_store_t * icache, cache_store_t * dcache, tlb_hrchy_t * tlb){
+	M_REQUIRE_NON_NULL(mc);
+	M_REQUIRE(mc->nb_cores < MULTICORE_MAX_CORES, ERR_BAD_PARAMETER, "a system has at most %u cores", MULTICORE_MAX_CORES);
+	M_REQUIRE_NON_NULL(icache);
+	M_REQUIRE_NON_NULL(dcache);
+	M_REQUIRE(icache != dcache, ERR_BAD_PARAMETER, "the L1s of a core must be split %c", ' ');
+	M_REQUIRE(icache->victim == NULL && dcache->victim == NULL, ERR_BAD_PARAMETER,
+	          "the L1s of a core cannot have a victim cache (it is not snooped) %c", ' ');
+	core_t* core = &mc->core[mc->nb_cores];
+	memset(core, 0, sizeof(core_t));
+	int err = ERR_NONE;
+	if ((err = cache_hrchy_init(&core->hrchy)) != ERR_NONE) return err;
+	if ((err = cache_hrchy_add_level(&core->hrchy, icache, dcache)) != ERR_NONE) return err;
+	if (mc->nb_cores > 0){ // the shared levels, and the caches of the other cores, must fit together
+		const cache_hrchy_t* first = &mc->core[0].hrchy;
+		for (size_t level = 1; level < first->levels; level++){
+			if ((err = cache_hrchy_add_level(&core->hrchy, first->dcache[level], first->dcache[level])) != ERR_NONE) return err;
+			}
+		M_REQUIRE(first->dcache[0]->desc.line_bytes == dcache->desc.line_bytes && first->dcache[0]->desc.write == dcache->desc.write,
+		          ERR_BAD_PARAMETER, "the caches of the cores must have the same line size and write policy %c", ' ');
+		}
+	size_t lines = (size_t) 1 << (32 - dcache->desc.line_bits); // lines of the physical address space
+	core->lost = calloc((lines + 63) / 64, sizeof(uint64_t));    // pages only backed once touched
+	if (core->lost == NULL) return ERR_MEM;
+	core->icache = icache;
+	core->dcache = dcache;
+	core->tlb = tlb;
+	mc->nb_cores++;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int multicore_add_shared_level(multicore_t * mc, cache_store_t * cache){
+	M_REQUIRE_NON_NULL(mc);
+	M_REQUIRE(mc->nb_cores > 0, ERR_BAD_PARAMETER, "add the cores first %c", ' ');
+	for (size_t c = 0; c < mc->nb_cores; c++){
+		int err = cache_hrchy_add_level(&mc->core[c].hrchy, cache, cache);
+		if (err != ERR_NONE) return err;
+		}
+	return ERR_NONE;
+	}
+
+/**
+ * @brief coherence actions before an access of a core to a line : snoop the L1s of the
+ *        other cores (a read cleans their dirty copy, a write invalidates their copies)
+ *        and count the bus transaction of the access
+ */
+static int snoop_others(multicore_t* mc, void* mem_space, size_t c, const phy_addr_t* paddr, bool write, mem_access_t access){
+	core_t* core = &mc->core[c];
+	cache_store_t* own = (access == INSTRUCTION) ? core->icache : core->dcache;
+	size_t line = (((size_t) paddr->phy_page_num << PAGE_OFFSET) | paddr->page_offset) >> own->desc.line_bits;
+	bool own_hit = false, dirty = false;
+	int err = ERR_NONE;
+	if ((err = cache_snoop(mem_space, own, paddr, SNOOP_PROBE, &own_hit, &dirty)) != ERR_NONE) return err;
+	if (!own_hit){
+		if (lost_bit(core, line)) core->counters.coherence_misses++;
+		clear_lost(core, line);
+		}
+	bool shared = false; // whether another L1 held the line
+	for (size_t d = 0; d < mc->nb_cores; d++){
+		if (d == c) continue;
+		core_t* other = &mc->core[d];
+		bool hit = false, other_dirty = false;
+		if (write){
+			bool ihit = false, idirty = false;
+			if ((err = cache_snoop(mem_space, other->dcache, paddr, SNOOP_FLUSH, &hit, &other_dirty)) != ERR_NONE
+			    || (err = cache_snoop(mem_space, other->icache, paddr, SNOOP_DISCARD, &ihit, &idirty)) != ERR_NONE) return err;
+			if (hit || ihit){
+				core->counters.invalidations_sent++;
+				other->counters.invalidations_received++;
+				set_lost(other, line);
+				shared = true;
+				}
+			}
+		else {
+			if ((err = cache_snoop(mem_space, other->dcache, paddr, SNOOP_CLEAN, &hit, &other_dirty)) != ERR_NONE) return err;
+			shared = shared || hit;
+			}
+		if (other_dirty) other->counters.interventions++;
+		}
+	if (write){
+		if (!own_hit) core->counters.bus_read_excls++;
+		else if (shared) core->counters.bus_upgrades++; // S -> M (E -> M is silent)
+		bool ihit = false, idirty = false; // the instructions of the core itself are stale too
+		return cache_snoop(mem_space, core->icache, paddr, SNOOP_DISCARD, &ihit, &idirty);
+		}
+	if (!own_hit) core->counters.bus_reads++;
+	if (access == INSTRUCTION){ // a dirty copy in the L1 DCACHE of the core would be hidden from the fetch
+		bool dhit = false, ddirty = false;
+		return cache_snoop(mem_space, core->dcache, paddr, SNOOP_CLEAN, &dhit, &ddirty);
+		}
+	return ERR_NONE;
+	}
+
+/**
+ * @brief after a write, the copies the shared levels may still hold (evicted there by
+ *        other cores) are stale : the up-to-date line is in the L1 of the writer
+ */
+static int discard_shared(const core_t* core, void* mem_space, const phy_addr_t* paddr){
+	for (size_t level = 1; level < core->hrchy.levels; level++){
+		bool hit = false, dirty = false;
+		int err = cache_snoop(mem_space, core->hrchy.dcache[level], paddr, SNOOP_DISCARD, &hit, &dirty);
+		if (err != ERR_NONE) return err;
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int multicore_execute(multicore_t * mc, void * mem_space, size_t core, const command_t * command, uint32_t * value){
+	M_REQUIRE_NON_NULL(mc);
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(command);
+	M_REQUIRE(core < mc->nb_cores, ERR_BAD_PARAMETER, "%zu is not a valid core", core);
+	core_t* cpu = &mc->core[core];
+	mem_access_t access = command->type == INSTRUCTION ? INSTRUCTION : DATA;
+	bool write = command->order == WRITE;
+	M_REQUIRE(!write || access == DATA, ERR_BAD_PARAMETER, "instructions cannot be written %c", ' ');
+	phy_addr_t paddr;
+	int err = ERR_NONE;
+	int hit = 0;
+	if (cpu->tlb != NULL) err = tlb_hrchy_search(mem_space, &command->vaddr, &paddr, access, cpu->tlb, &hit);
+	else err = page_walk(mem_space, &command->vaddr, &paddr);
+	if (err != ERR_NONE) return err;
+
+	for (size_t level = 1; level < cpu->hrchy.levels; level++){ // the fills of the shared levels take the ways of the core
+		way_partition_t* part = cpu->hrchy.dcache[level]->partition;
+		if (part != NULL && (err = partition_set_tenant(part, (uint32_t) core)) != ERR_NONE) return err;
+		}
+	cpu->counters.accesses++;
+	if ((err = snoop_others(mc, mem_space, core, &paddr, write, access)) != ERR_NONE) return err;
+	uint32_t word = 0;
+	uint8_t byte = 0;
+	if (!write){
+		if (command->data_size == sizeof(word_t)) err = cache_hrchy_read(mem_space, &cpu->hrchy, &paddr, access, &word);
+		else {
+			err = cache_hrchy_read_byte(mem_space, &cpu->hrchy, &paddr, access, &byte);
+			word = byte;
+			}
+		if (value != NULL) *value = word;
+		return err;
+		}
+	if (command->data_size == sizeof(word_t)) err = cache_hrchy_write(mem_space, &cpu->hrchy, &paddr, &command->write_data);
+	else err = cache_hrchy_write_byte(mem_space, &cpu->hrchy, &paddr, (uint8_t) command->write_data);
+	if (err != ERR_NONE) return err;
+	return discard_shared(cpu, mem_space, &paddr);
+	}
+
+//=========================================================================
+int multicore_run(multicore_t * mc, void * mem_space, const program_t * programs, size_t quantum){
+	M_REQUIRE_NON_NULL(mc);
+	M_REQUIRE_NON_NULL(programs);
+	M_REQUIRE(quantum > 0, ERR_BAD_PARAMETER, "quantum must be at least 1 %c", ' ');
+	size_t next[MULTICORE_MAX_CORES] = { 0 }; // next command of each core
+	bool running = true;
+	while (running){
+		running = false;
+		for (size_t c = 0; c < mc->nb_cores; c++){
+			for (size_t n = 0; n < quantum && next[c] < programs[c].nb_lines; n++, next[c]++){
+				int err = multicore_execute(mc, mem_space, c, &programs[c].listing[next[c]], NULL);
+				if (err != ERR_NONE) return err;
+				}
+			running = running || next[c] < programs[c].nb_lines;
+			}
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int multicore_writeback_all(void * mem_space, const multicore_t * mc){
+	M_REQUIRE_NON_NULL(mc);
+	for (size_t c = 0; c < mc->nb_cores; c++){ // a line is dirty in one cache at most
+		int err = cache_hrchy_writeback_all(mem_space, &mc->core[c].hrchy);
+		if (err != ERR_NONE) return err;
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int multicore_print(FILE * output, const multicore_t * mc){
+	M_REQUIRE_NON_NULL(output);
+	M_REQUIRE_NON_NULL(mc);
+	for (size_t c = 0; c < mc->nb_cores; c++){
+		const core_counters_t* counters = &mc->core[c].counters;
+		fprintf(output, "CORE %zu: accesses %" PRIu64 ", BusRd %" PRIu64 ", BusRdX %" PRIu64 ", BusUpgr %" PRIu64
+		        ", invalidations sent %" PRIu64 ", invalidations received %" PRIu64 ", interventions %" PRIu64
+		        ", coherence misses %" PRIu64 "\n", c, counters->accesses, counters->bus_reads, counters->bus_read_excls,
+		        counters->bus_upgrades, counters->invalidations_sent, counters->invalidations_received,
+		        counters->interventions, counters->coherence_misses);
+		}
+	return ERR_NONE;
+	}
@@ -0,0 +1,160 @@
+#pragma once
+
+/**
+ * @file multicore.h
+ * @brief multi-core simulation : each core has private L1 ICACHE and L1 DCACHE (and
+ *        optionally its own TLBs), the levels below being shared by all the cores.
+ *        The L1s are kept coherent by a MESI snooping protocol : before each access,
+ *        the L1s of the other cores are snooped for the line.
+ *
+ * The MESI state of a line in an L1 is not stored, it follows from its copies :
+ *  - M : the only copy in the L1s, dirty (write-back caches)
+ *  - E : the only copy in the L1s, clean
+ *  - S : a clean copy, other L1s may hold the line
+ *  - I : no copy
+ * A read (or fetch) cleans the dirty copy of another core, if any (M -> S);
+ * a write invalidates the copies of the other cores, written back first if
+ * dirty (-> I), and the stale copies the shared levels may hold.
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h"
+#include "commands.h"
+#include "tlb_hrchy.h"
+#include <stdio.h> // for FILE
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+#define MULTICORE_MAX_CORES 8u
+
+/*
+ * Coherence events of a core :
+ *  - accesses               : commands executed
+ *  - bus_reads              : BusRd, reads and fetches missing the L1 of the core
+ *  - bus_read_excls         : BusRdX, writes missing the L1 of the core
+ *  - bus_upgrades           : BusUpgr, writes to a line the L1 of the core shares with other cores (S -> M)
+ *  - invalidations_sent     : copies invalidated in the L1s of the other cores by the writes of the core
+ *  - invalidations_received : copies of the core invalidated by the writes of other cores
+ *  - interventions          : dirty copies of the core written back for the access of another core
+ *  - coherence_misses       : L1 misses of the core on lines it lost to an invalidation
+ */
+typedef struct {
+	uint64_t accesses;
+	uint64_t bus_reads;
+	uint64_t bus_read_excls;
+	uint64_t bus_upgrades;
+	uint64_t invalidations_sent;
+	uint64_t invalidations_received;
+	uint64_t interventions;
+	uint64_t coherence_misses;
+	} core_counters_t;
+
+/*
+ * A core :
+ *  - icache, dcache : its private L1s (not owned)
+ *  - tlb            : its TLBs, NULL to translate by page walks (not owned)
+ *  - hrchy          : its caches, the private L1s then the shared levels
+ *  - lost           : bitmap of the lines it lost to an invalidation, one bit per line of the physical address space
+ *  - counters       : its coherence events
+ */
+typedef struct {
+	cache_store_t* icache;
+	cache_store_t* dcache;
+	tlb_hrchy_t* tlb;
+	cache_hrchy_t hrchy;
+	uint64_t* lost;
+	core_counters_t counters;
+	} core_t;
+
+/*
+ * Multi-core system :
+ *  - nb_cores : cores in use
+ *  - core     : the cores
+ */
+typedef struct {
+	size_t nb_cores;
+	core_t core[MULTICORE_MAX_CORES];
+	} multicore_t;
+
+//=========================================================================
+/**
+ * @brief Initialize an empty multi-core system.
+ * @param mc the system to initialize
+ * @return error code
+ */
+int multicore_init(multicore_t * mc);
+
+//=========================================================================
+/**
+ * @brief Free the bitmaps of a multi-core system (the caches and TLBs are not owned).
+ */
+void multicore_free(multicore_t * mc);
+
+//=========================================================================
+/**
+ * @brief Add a core, with its private L1s (initialized, same line size and write
+ *        policy as the other caches, no victim cache) and TLBs (NULL : page walks).
+ *        It shares the levels already added with multicore_add_shared_level().
+ * @param mc the system
+ * @param icache its L1 ICACHE
+ * @param dcache its L1 DCACHE
+ * @param tlb its TLBs, or NULL
+ * @return error code
+ */
+int multicore_add_core(multicore_t * mc, cache_store_t * icache, cache_store_t * dcache, tlb_hrchy_t * tlb);
+
+//=========================================================================
+/**
+ * @brief Add a level shared by all the cores, below the levels already added.
+ * @param mc the system, with at least one core
+ * @param cache the cache of the level
+ * @return error code
+ */
+int multicore_add_shared_level(multicore_t * mc, cache_store_t * cache);
+
+//=========================================================================
+/**
+ * @brief Execute a command on a core : translation (TLBs or page walk),
+ *        coherence actions, then the access to its caches. The core is the tenant
+ *        of the partitioned shared levels (see cache_set_partition()).
+ * @param mc the system
+ * @param mem_space pointer to the memory space
+ * @param core index of the core
+ * @param command the command
+ * @param value the word (or byte) read, may be NULL
+ * @return error code
+ */
+int multicore_execute(multicore_t * mc, void * mem_space, size_t core, const command_t * command, uint32_t * value);
+
+//=========================================================================
+/**
+ * @brief Run one program per core, interleaved deterministically : the cores
+ *        execute quantum commands each in turn (round robin), until all the
+ *        programs are done.
+ * @param mc the system
+ * @param mem_space pointer to the memory space
+ * @param programs the program of each core (mc->nb_cores of them)
+ * @param quantum commands executed by a core before the next one runs (at least 1)
+ * @return error code
+ */
+int multicore_run(multicore_t * mc, void * mem_space, const program_t * programs, size_t quantum);
+
+//=========================================================================
+/**
+ * @brief Write all the dirty lines of a system back to memory (see cache_hrchy_writeback_all()).
+ * @param mem_space pointer to the memory space
+ * @param mc the system
+ * @return error code
+ */
+int multicore_writeback_all(void * mem_space, const multicore_t * mc);
+
+//=========================================================================
+/**
+ * @brief Print the coherence events of each core.
+ * @param output the stream to print to
+ * @param mc the system
+ * @return error code
+ */
+int multicore_print(FILE * output, const multicore_t * mc);
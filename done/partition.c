@@ -0,0 +1,88 @@
+/**
+ * @file partition.c
+ * @brief way partitioning of a shared cache : the ways each tenant may fill
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "partition.h"
+#include "error.h"
+#include <inttypes.h> // for PRIu64
+#include <string.h>
+
+#define add_way(mask, way) ((mask)->bits[(way) / 64] |= (uint64_t) 1 << ((way) % 64))
+
+//=========================================================================
+int partition_init(way_partition_t * part, uint32_t tenants, uint32_t ways){
+	M_REQUIRE_NON_NULL(part);
+	M_REQUIRE(1 <= tenants && tenants <= PARTITION_MAX_TENANTS, ERR_BAD_PARAMETER, "tenants (%u) must be between 1 and %u", tenants, PARTITION_MAX_TENANTS);
+	M_REQUIRE(1 <= ways && ways <= CACHE_MAX_WAYS, ERR_SIZE, "ways (%u) must be between 1 and %u", ways, CACHE_MAX_WAYS);
+	memset(part, 0, sizeof(way_partition_t));
+	part->ways = ways;
+	part->tenants = tenants;
+	for (uint32_t t = 0; t < tenants; t++){
+		for (uint32_t way = 0; way < ways; way++) add_way(&part->mask[t], way);
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int partition_set_mask(way_partition_t * part, uint32_t tenant, const cache_way_mask_t * mask){
+	M_REQUIRE_NON_NULL(part);
+	M_REQUIRE_NON_NULL(mask);
+	M_REQUIRE(tenant < part->tenants, ERR_BAD_PARAMETER, "%u is not a valid tenant", tenant);
+	cache_way_mask_t ways;
+	memset(&ways, 0, sizeof(ways));
+	bool any = false;
+	for (uint32_t way = 0; way < part->ways; way++){
+		if (cache_way_in(mask, way)){
+			add_way(&ways, way);
+			any = true;
+			}
+		}
+	M_REQUIRE(any, ERR_BAD_PARAMETER, "tenant %u must be given at least one way", tenant);
+	part->mask[tenant] = ways;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int partition_set_ways(way_partition_t * part, uint32_t tenant, uint32_t first, uint32_t count){
+	M_REQUIRE_NON_NULL(part);
+	M_REQUIRE(count >= 1 && first < part->ways && count <= part->ways - first, ERR_BAD_PARAMETER,
+	          "ways %u to %u are not ways of the cache", first, first + count - 1);
+	cache_way_mask_t mask;
+	memset(&mask, 0, sizeof(mask));
+	for (uint32_t way = first; way < first + count; way++) add_way(&mask, way);
+	return partition_set_mask(part, tenant, &mask);
+	}
+
+//=========================================================================
+int partition_set_tenant(way_partition_t * part, uint32_t tenant){
+	M_REQUIRE_NON_NULL(part);
+	M_REQUIRE(tenant < part->tenants, ERR_BAD_PARAMETER, "%u is not a valid tenant", tenant);
+	part->tenant = tenant;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int partition_print(FILE * output, const char * name, const way_partition_t * part){
+	M_REQUIRE_NON_NULL(output);
+	M_REQUIRE_NON_NULL(name);
+	M_REQUIRE_NON_NULL(part);
+	for (uint32_t t = 0; t < part->tenants; t++){
+		fprintf(output, "%s partition: tenant %u, ways", name, t);
+		const char* separator = " ";
+		for (uint32_t way = 0; way < part->ways; way++){ // the runs of ways of its mask
+			if (!cache_way_in(&part->mask[t], way)) continue;
+			uint32_t last = way;
+			while (last + 1 < part->ways && cache_way_in(&part->mask[t], last + 1)) last++;
+			if (last == way) fprintf(output, "%s%u", separator, way);
+			else fprintf(output, "%s%u-%u", separator, way, last);
+			separator = ",";
+			way = last;
+			}
+		fprintf(output, ", fills %" PRIu64 ", evictions %" PRIu64 "\n", part->counters[t].fills, part->counters[t].evictions);
+		}
+	return ERR_NONE;
+	}
@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ * @file partition.h
+ * @brief way partitioning of a cache shared by several tenants (the cores of a multi-core
+ *        system, see cache_set_partition()) : each tenant may only fill the ways of its mask,
+ *        the empty way taken by a fill and the way evicted to make room being chosen among them
+ *        (by the replacement policy of the cache). The lookups are not partitioned : a tenant
+ *        hits on any way of the set.
+ * The masks may change at any time : the lines outside the new mask of a tenant stay in the
+ * cache, until a tenant allowed to fill their ways evicts them.
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h> // for FILE
+
+#define PARTITION_MAX_TENANTS 8u // as many as the cores of a multi-core system
+
+/*
+ * Activity of a tenant in the cache :
+ *  - fills     : lines it placed in the cache
+ *  - evictions : valid lines it replaced to make room
+ */
+typedef struct {
+	uint64_t fills;
+	uint64_t evictions;
+	} partition_counters_t;
+
+/*
+ * Partition of the ways of a cache :
+ *  - ways     : associativity of the cache
+ *  - tenants  : number of tenants
+ *  - tenant   : the tenant accessing the cache (see partition_set_tenant())
+ *  - mask     : the ways each tenant may fill (all of them by default)
+ *  - counters : the activity of each tenant
+ */
+typedef struct way_partition {
+	uint32_t ways;
+	uint32_t tenants;
+	uint32_t tenant;
+	cache_way_mask_t mask[PARTITION_MAX_TENANTS];
+	partition_counters_t counters[PARTITION_MAX_TENANTS];
+	} way_partition_t;
+
+//=========================================================================
+/**
+ * @brief Initialize the partition of a cache, each tenant may fill all its ways.
+ * @param part the partition to initialize
+ * @param tenants number of tenants, between 1 and PARTITION_MAX_TENANTS
+ * @param ways associativity of the cache
+ * @return error code
+ */
+int partition_init(way_partition_t * part, uint32_t tenants, uint32_t ways);
+
+//=========================================================================
+/**
+ * @brief Give a tenant the ways of a mask (way masking).
+ * @param part the partition
+ * @param tenant the tenant
+ * @param mask the ways it may fill, at least one of the ways of the cache (the other bits ignored)
+ * @return error code
+ */
+int partition_set_mask(way_partition_t * part, uint32_t tenant, const cache_way_mask_t * mask);
+
+//=========================================================================
+/**
+ * @brief Give a tenant count contiguous ways, from way first on (way partitioning).
+ * @param part the partition
+ * @param tenant the tenant
+ * @param first its first way
+ * @param count its number of ways, at least 1
+ * @return error code
+ */
+int partition_set_ways(way_partition_t * part, uint32_t tenant, uint32_t first, uint32_t count);
+
+//=========================================================================
+/**
+ * @brief Set the tenant whose accesses follow.
+ * @param part the partition
+ * @param tenant the tenant
+ * @return error code
+ */
+int partition_set_tenant(way_partition_t * part, uint32_t tenant);
+
+//=========================================================================
+/**
+ * @brief Print the ways and activity of each tenant.
+ * @param output the stream to print to
+ * @param name name of the cache
+ * @param part the partition
+ * @return error code
+ */
+int partition_print(FILE * output, const char * name, const way_partition_t * part);
+
+//=========================================================================
+/**
+ * @brief the ways the current tenant may fill
+ */
+#define partition_mask(part) (&(part)->mask[(part)->tenant])
+
+/**
+ * @brief count a fill of the current tenant, which evicted a valid line or not
+ */
+#define partition_fill(part, evicted)                            \
+	do {                                                         \
+		partition_counters_t* counters_ = &(part)->counters[(part)->tenant]; \
+		counters_->fills++;                                      \
+		if (evicted) counters_->evictions++;                     \
+	} while (0)
@@ -0,0 +1,181 @@
+/**
+ * @file prefetch.c
+ * @brief hardware prefetchers : a prefetcher observes the demand accesses of a cache
+ *        and brings the lines it predicts into a level of the hierarchy
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "prefetch.h"
+#include "error.h"
+#include <string.h>
+
+#define PREFETCH_STREAM_WINDOW 4 // lines between two misses of a stream, at most
+#define NO_LINE ((uint32_t) -1)
+
+//=========================================================================
+int prefetcher_init(prefetcher_t * pf, prefetch_kind_t kind, uint32_t degree, size_t level, uint32_t latency, uint32_t line_bytes){
+	M_REQUIRE_NON_NULL(pf);
+	M_REQUIRE(PREFETCH_NEXT_LINE <= kind && kind < PREFETCH_KIND_NB, ERR_BAD_PARAMETER, "%d is not a valid instance of prefetch_kind_t", kind);
+	M_REQUIRE(1 <= degree && degree <= PREFETCH_MAX_DEGREE, ERR_BAD_PARAMETER, "degree (%u) must be between 1 and %u", degree, PREFETCH_MAX_DEGREE);
+	M_REQUIRE(level < CACHE_MAX_LEVELS, ERR_BAD_PARAMETER, "level (%zu) must be below %u", level, CACHE_MAX_LEVELS);
+	M_REQUIRE(line_bytes >= sizeof(word_t) && line_bytes <= CACHE_MAX_LINE_BYTES && (line_bytes & (line_bytes - 1)) == 0,
+	          ERR_SIZE, "line size (%u) must be a power of 2 between 4 and %u", line_bytes, CACHE_MAX_LINE_BYTES);
+	memset(pf, 0, sizeof(prefetcher_t));
+	pf->kind = kind;
+	pf->degree = degree;
+	pf->level = level;
+	pf->latency = latency;
+	pf->line_bits = (uint8_t) __builtin_ctz(line_bytes);
+	pf->last_line = NO_LINE;
+	return ERR_NONE;
+	}
+
+/**
+ * @brief the addresses of the lines line + step * i, i = 1, 2... up to the degree of the prefetcher,
+ *        stopping at the end of the page of line
+ */
+static uint32_t lines_from(const prefetcher_t * pf, uint32_t line, int32_t step, uint32_t * lines){
+	uint32_t page = (line << pf->line_bits) >> PAGE_OFFSET;
+	uint32_t n = 0;
+	for (int64_t next = (int64_t) line + step; n < pf->degree && next >= 0; next += step){
+		uint32_t addr = (uint32_t) next << pf->line_bits;
+		if (addr >> PAGE_OFFSET != page) break;
+		lines[n++] = addr;
+		}
+	return n;
+	}
+
+/**
+ * @brief stride table : train the entry of the page with addr, and predict its next addresses
+ *        once the same stride has been seen PREFETCH_CONFIDENT times
+ */
+static uint32_t stride_observe(prefetcher_t * pf, uint32_t addr, uint32_t * lines){
+	uint32_t page = addr >> PAGE_OFFSET;
+	prefetch_stride_t* entry = &pf->strides[page % PREFETCH_STRIDE_ENTRIES];
+	if (!entry->valid || entry->page != page){ // new page : no stride yet
+		memset(entry, 0, sizeof(prefetch_stride_t));
+		entry->page = page;
+		entry->last_addr = addr;
+		entry->valid = 1;
+		return 0;
+		}
+	int32_t stride = (int32_t) (addr - entry->last_addr);
+	if (stride == 0) return 0; // same address (several bytes of a word)
+	entry->last_addr = addr;
+	if (stride == entry->stride){
+		if (entry->confidence < PREFETCH_MAX_CONFIDENCE) entry->confidence++;
+		}
+	else if (entry->confidence > 1) entry->confidence--;
+	else { // replace the stride
+		entry->stride = stride;
+		entry->confidence = 1;
+		}
+	if (entry->confidence < PREFETCH_CONFIDENT) return 0;
+	uint32_t n = 0;
+	uint32_t line = addr >> pf->line_bits;
+	for (int64_t next = (int64_t) addr + stride; n < pf->degree && next >= 0; next += stride){
+		if ((uint32_t) next >> PAGE_OFFSET != page) break;
+		uint32_t next_line = (uint32_t) next >> pf->line_bits;
+		if (next_line == line) continue; // strides shorter than a line
+		lines[n++] = next_line << pf->line_bits;
+		line = next_line;
+		}
+	return n;
+	}
+
+/**
+ * @brief streams : extend the stream which line continues (or start a new one),
+ *        and predict the lines ahead of it once it has been extended PREFETCH_CONFIDENT times
+ */
+static uint32_t stream_observe(prefetcher_t * pf, uint32_t line, uint32_t * lines){
+	prefetch_stream_t* lru = &pf->streams[0];
+	for (uint32_t s = 0; s < PREFETCH_STREAMS; s++){
+		prefetch_stream_t* stream = &pf->streams[s];
+		if (!stream->valid){
+			if (lru->valid) lru = stream;
+			continue;
+			}
+		int64_t distance = (int64_t) line - stream->last_line;
+		bool extends = (stream->direction == 0) ? (distance != 0 && distance >= -PREFETCH_STREAM_WINDOW && distance <= PREFETCH_STREAM_WINDOW)
+		                                        : (distance * stream->direction > 0 && distance * stream->direction <= PREFETCH_STREAM_WINDOW);
+		if (distance == 0){ // same line again
+			stream->used = pf->clock;
+			return 0;
+			}
+		if (extends){
+			if (stream->direction == 0) stream->direction = distance > 0 ? 1 : -1;
+			if (stream->confidence < PREFETCH_MAX_CONFIDENCE) stream->confidence++;
+			stream->last_line = line;
+			stream->used = pf->clock;
+			return stream->confidence >= PREFETCH_CONFIDENT ? lines_from(pf, line, stream->direction, lines) : 0;
+			}
+		if (lru->valid && stream->used < lru->used) lru = stream;
+		}
+	memset(lru, 0, sizeof(prefetch_stream_t)); // new stream, replacing the least recently used one
+	lru->last_line = line;
+	lru->valid = 1;
+	lru->used = pf->clock;
+	return 0;
+	}
+
+/**
+ * @brief remove the i-th prefetch in flight
+ */
+static void remove_inflight(prefetcher_t * pf, uint32_t i){
+	memmove(&pf->inflight[i], &pf->inflight[i + 1], (pf->inflight_count - i - 1) * sizeof(prefetch_inflight_t));
+	pf->inflight_count--;
+	}
+
+//=========================================================================
+uint32_t prefetcher_observe(prefetcher_t * pf, uint32_t phy_addr, bool missed, bool tagged, uint32_t * lines){
+	pf->clock++;
+	uint32_t line = phy_addr >> pf->line_bits;
+	for (uint32_t i = 0; i < pf->inflight_count; i++){
+		if (pf->inflight[i].line_addr >> pf->line_bits == line){ // the demand access came before the prefetch
+			remove_inflight(pf, i);
+			pf->counters.late++;
+			break;
+			}
+		}
+	switch (pf->kind){
+		case PREFETCH_NEXT_LINE : return (missed || tagged) ? lines_from(pf, line, 1, lines) : 0;
+		case PREFETCH_STRIDE    : return stride_observe(pf, phy_addr, lines);
+		case PREFETCH_STREAM    : return (missed || tagged) ? stream_observe(pf, line, lines) : 0;
+		case PREFETCH_NEXT_N    :
+			if (line == pf->last_line) return 0;
+			pf->last_line = line;
+			return lines_from(pf, line, 1, lines);
+		default                 : return 0;
+		}
+	}
+
+//=========================================================================
+bool prefetcher_issue(prefetcher_t * pf, uint32_t line_addr, uint32_t * ready){
+	for (uint32_t i = 0; i < pf->inflight_count; i++){
+		if (pf->inflight[i].line_addr == line_addr) return false;
+		}
+	bool full = pf->inflight_count == PREFETCH_MAX_INFLIGHT;
+	if (full){ // no room : the oldest prefetch is filled at once
+		*ready = pf->inflight[0].line_addr;
+		remove_inflight(pf, 0);
+		}
+	pf->inflight[pf->inflight_count].line_addr = line_addr;
+	pf->inflight[pf->inflight_count].ready = pf->clock + pf->latency;
+	pf->inflight_count++;
+	pf->counters.issued++;
+	return full;
+	}
+
+//=========================================================================
+uint32_t prefetcher_ready(prefetcher_t * pf, uint32_t * lines){
+	uint32_t n = 0;
+	while (n < pf->inflight_count && pf->inflight[n].ready <= pf->clock){ // issued in order, with the same latency
+		lines[n] = pf->inflight[n].line_addr;
+		n++;
+		}
+	memmove(&pf->inflight[0], &pf->inflight[n], (pf->inflight_count - n) * sizeof(prefetch_inflight_t));
+	pf->inflight_count -= n;
+	return n;
+	}
@@ -0,0 +1,162 @@
+#pragma once
+
+/**
+ * @file prefetch.h
+ * @brief hardware prefetchers : a prefetcher observes the demand accesses of a cache
+ *        and brings the lines it predicts into a level of the hierarchy (see
+ *        cache_set_prefetcher()). The lines prefetched stay in the page of the access
+ *        which triggered them, as physical pages need not be contiguous.
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+#define PREFETCH_MAX_DEGREE     16u // lines prefetched per access, at most
+#define PREFETCH_MAX_INFLIGHT   32u // prefetches issued and not filled yet, at most
+#define PREFETCH_STRIDE_ENTRIES 16u // pages tracked by the stride table
+#define PREFETCH_STREAMS         8u // streams tracked by the stream prefetcher
+#define PREFETCH_CONFIDENT       2u // confidence from which a stride or a stream is prefetched
+#define PREFETCH_MAX_CONFIDENCE  3u
+
+/*
+ * kinds of prefetchers :
+ *  - PREFETCH_NEXT_LINE : the degree lines after a line that missed, or after a prefetched line
+ *                         used for the first time (tagged prefetching)
+ *  - PREFETCH_STRIDE    : the degree next addresses of a constant stride between the accesses to a page
+ *                         (no program counter reaches the caches : strides are tracked per page)
+ *  - PREFETCH_STREAM    : the degree lines ahead of an ascending or descending sequence of
+ *                         lines that missed (or prefetched lines used for the first time)
+ *  - PREFETCH_NEXT_N    : the degree lines after every new line accessed (instruction fetches)
+ */
+typedef enum {
+	PREFETCH_NEXT_LINE, PREFETCH_STRIDE, PREFETCH_STREAM, PREFETCH_NEXT_N
+	} prefetch_kind_t;
+
+#define PREFETCH_KIND_NB (PREFETCH_NEXT_N + 1)
+
+/*
+ * Activity of a prefetcher :
+ *  - issued : lines requested to memory (not in the hierarchy when predicted)
+ *  - fills  : lines read from memory and inserted in the hierarchy
+ *  - useful : prefetched lines used by a demand access (accuracy = useful / fills)
+ *  - late   : demand accesses to a line whose prefetch was still in flight (lateness = late / issued)
+ *  - misses : demand accesses observed which went to memory (coverage = useful / (useful + misses))
+ */
+typedef struct {
+	uint64_t issued;
+	uint64_t fills;
+	uint64_t useful;
+	uint64_t late;
+	uint64_t misses;
+	} prefetch_counters_t;
+
+/*
+ * entry of the stride table : last address accessed in a page and the stride which led to it
+ */
+typedef struct {
+	uint32_t page;
+	uint32_t last_addr;
+	int32_t stride;
+	uint8_t confidence;
+	uint8_t valid;
+	} prefetch_stride_t;
+
+/*
+ * a stream : the last line of a sequence of lines and its direction (+1, -1, 0 while unknown)
+ */
+typedef struct {
+	uint32_t last_line;
+	int32_t direction;
+	uint8_t confidence;
+	uint8_t valid;
+	uint64_t used; // clock of its last use (the least recently used stream is replaced)
+	} prefetch_stream_t;
+
+/*
+ * a prefetch in flight : the line requested and the clock at which it is filled
+ */
+typedef struct {
+	uint32_t line_addr;
+	uint64_t ready;
+	} prefetch_inflight_t;
+
+/*
+ * Prefetcher :
+ *  - kind      : its algorithm
+ *  - degree    : lines prefetched per access, at most
+ *  - level     : level of the hierarchy filled (0 : L1, 1 : L2, ...)
+ *  - latency   : demand accesses observed between the issue of a prefetch and its fill
+ *  - line_bits : log_2 of the line size of the caches
+ *  - clock     : demand accesses observed
+ *  - last_line : line of the last access (PREFETCH_NEXT_N)
+ *  - strides   : the stride table (PREFETCH_STRIDE), indexed by page
+ *  - streams   : the streams (PREFETCH_STREAM)
+ *  - inflight  : the prefetches in flight, in the order they were issued
+ *  - counters  : its activity
+ */
+typedef struct prefetcher {
+	prefetch_kind_t kind;
+	uint32_t degree;
+	size_t level;
+	uint32_t latency;
+	uint8_t line_bits;
+	uint64_t clock;
+	uint32_t last_line;
+	prefetch_stride_t strides[PREFETCH_STRIDE_ENTRIES];
+	prefetch_stream_t streams[PREFETCH_STREAMS];
+	prefetch_inflight_t inflight[PREFETCH_MAX_INFLIGHT];
+	uint32_t inflight_count;
+	prefetch_counters_t counters;
+	} prefetcher_t;
+
+//=========================================================================
+/**
+ * @brief Initialize a prefetcher.
+ * @param pf the prefetcher to initialize
+ * @param kind its algorithm
+ * @param degree lines prefetched per access, between 1 and PREFETCH_MAX_DEGREE
+ * @param level level of the hierarchy filled, below CACHE_MAX_LEVELS (the last level
+ *        of a shorter hierarchy is filled instead)
+ * @param latency demand accesses between the issue of a prefetch and its fill (0 : filled at once)
+ * @param line_bytes line size of the caches (power of 2, at most CACHE_MAX_LINE_BYTES)
+ * @return error code
+ */
+int prefetcher_init(prefetcher_t * pf, prefetch_kind_t kind, uint32_t degree, size_t level, uint32_t latency, uint32_t line_bytes);
+
+//=========================================================================
+/**
+ * @brief Observe a demand access of the cache of the prefetcher, and predict the next lines.
+ *        An access to a line in flight cancels its prefetch (counted as late).
+ * @param pf the prefetcher
+ * @param phy_addr the physical address accessed
+ * @param missed whether the cache missed
+ * @param tagged whether the cache hit a prefetched line not used before
+ * @param lines (modified) the addresses of the lines to prefetch, at most pf->degree
+ * @return the number of lines to prefetch
+ */
+uint32_t prefetcher_observe(prefetcher_t * pf, uint32_t phy_addr, bool missed, bool tagged, uint32_t * lines);
+
+//=========================================================================
+/**
+ * @brief Issue the prefetch of a line, unless it is already in flight
+ *        (the oldest prefetch in flight is filled first when there are too many).
+ * @param pf the prefetcher
+ * @param line_addr address of the line
+ * @param ready (modified) set to the address of the oldest line when it has to be filled at once
+ * @return whether ready has been set
+ */
+bool prefetcher_issue(prefetcher_t * pf, uint32_t line_addr, uint32_t * ready);
+
+//=========================================================================
+/**
+ * @brief Take the prefetches whose latency has elapsed out of the flight.
+ * @param pf the prefetcher
+ * @param lines (modified) the addresses of the lines to fill, at most PREFETCH_MAX_INFLIGHT
+ * @return the number of lines to fill
+ */
+uint32_t prefetcher_ready(prefetcher_t * pf, uint32_t * lines);
@@ -0,0 +1,287 @@
+#pragma once
+
+/**
+ * @file replacement.h
+ * @brief replacement policies of the caches (see cache_replace_t) : how the state
+ *        of a set is updated on a hit and on an insertion, and which way is evicted
+ *        from a full set
+ *
+ * The state of a way is its age (see cache_age(), cache_age_bits() bits), the state of
+ * the whole set (TREE_PLRU) is kept in the bits of the set from desc->state_bit on.
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h"
+#include "lru.h"
+#include <stdbool.h>
+
+#define REPLACE_INLINE static inline __attribute__((always_inline))
+
+#define RRIP_DISTANT 3u          // 2 bits re-reference prediction values : 3 = re-referenced in a distant future
+#define RRIP_LONG    2u          // prediction of the lines inserted by SRRIP
+#define BRRIP_LONG_ONE_IN 32u    // BRRIP inserts with a long prediction once every 32 insertions (on average)
+#define LFU_MAX      255u        // saturation of the access counts
+
+#define CACHE_DEFAULT_SEED 1u
+
+//=========================================================================
+/**
+ * @brief next value of the pseudo-random generator of a cache (xorshift32)
+ */
+REPLACE_INLINE uint32_t replace_random(cache_store_t* cache){
+	uint32_t x = cache->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return cache->seed = x;
+	}
+
+//=========================================================================
+/**
+ * Tree-PLRU : node n of the tree (1 is the root, the children of n are 2n and 2n + 1,
+ * the leaves ways + w are the ways w) is bit n of the state of the set, from bit first of bits.
+ * A node points to the half of its ways holding the victim (0 : left, 1 : right).
+ */
+#define tree_plru_bit(bits, first, node) cache_bits_get(bits, (first) + (node), 1u)
+
+/**
+ * @brief make every node on the path to way point away from it
+ */
+REPLACE_INLINE void tree_plru_touch(uint32_t* bits, uint32_t first, uint32_t ways, uint32_t way){
+	uint32_t node = 1;
+	for (uint32_t half = ways >> 1; half > 0; half >>= 1){ // half : number of ways on each side of node
+		uint32_t right = (way & half) != 0;
+		cache_bits_set(bits, first + node, 1u, !right); // the victim is on the other side
+		node = 2 * node + right;
+		}
+	}
+
+/**
+ * @brief follow the nodes from the root to the victim
+ */
+REPLACE_INLINE uint32_t tree_plru_victim(const uint32_t* bits, uint32_t first, uint32_t ways){
+	uint32_t node = 1;
+	while (node < ways) node = 2 * node + tree_plru_bit(bits, first, node);
+	return node - ways;
+	}
+
+//=========================================================================
+/**
+ * @brief Bit-PLRU : set the bit of way (from bit first of bits), clear the others once they are all set
+ */
+REPLACE_INLINE void bit_plru_touch(uint32_t* bits, uint32_t first, uint32_t ways, uint32_t way){
+	cache_bits_set(bits, first + way, 1u, 1u);
+	if (cache_bits_first_zero(bits, first, ways) == ways){
+		for (uint32_t i = 0; i < ways; i += 32u) cache_bits_set(bits, first + i, ways - i < 32u ? ways - i : 32u, 0);
+		cache_bits_set(bits, first + way, 1u, 1u);
+		}
+	}
+
+//=========================================================================
+/**
+ * @brief the valid way with the biggest age (the last one on ties), NOTHING_FOUND if none
+ *        (LRU and FIFO victim)
+ */
+REPLACE_INLINE int oldest_way(const uint32_t* bits, const cache_desc_t* desc){
+	uint32_t width = desc->age_bits, chunk = desc->age_chunk, age_mask = (1u << width) - 1u;
+	uint32_t oldest = 0; // age + 1 and way of the oldest valid way so far (0 : none) : comparisons without branches
+	for (uint32_t first = 0; first < desc->ways; first += chunk){ // the ages of chunk ways at once
+		uint32_t count = desc->ways - first < chunk ? desc->ways - first : chunk;
+		uint32_t ages = cache_bits_get(bits, desc->age_bit + first * width, count * width);
+		uint32_t valids = cache_bits_get(bits, first, count);
+		for (uint32_t way = first; way < first + count; way++, ages >>= width, valids >>= 1){
+			uint32_t key = (((ages & age_mask) + 1u) << 8 | way) & (0u - (valids & 1u));
+			oldest = key >= oldest ? key : oldest;
+			}
+		}
+	return oldest == 0 ? NOTHING_FOUND : (int) (oldest & 0xFFu);
+	}
+
+/**
+ * @brief RRIP victim : the first way predicted to be re-referenced in a distant future,
+ *        after having aged the whole set until there is one
+ */
+REPLACE_INLINE int rrip_victim(uint32_t* bits, const cache_desc_t* desc){
+	uint8_t rrpv[CACHE_MAX_WAYS];
+	cache_ages_load(bits, desc, rrpv);
+	uint32_t victim = 0;
+	for (uint32_t way = 1; way < desc->ways; way++){
+		if (rrpv[way] > rrpv[victim]) victim = way;
+		}
+	uint8_t delta = (uint8_t) (RRIP_DISTANT - rrpv[victim]);
+	if (delta > 0){
+		for (uint32_t way = 0; way < desc->ways; way++) rrpv[way] = (uint8_t) (rrpv[way] + delta);
+		cache_ages_store(bits, desc, rrpv);
+		}
+	return (int) victim;
+	}
+
+/**
+ * @brief LFU victim : the first way with the smallest count
+ */
+REPLACE_INLINE int lfu_victim(const uint32_t* bits, const cache_desc_t* desc){
+	uint8_t counts[CACHE_MAX_WAYS];
+	cache_ages_load(bits, desc, counts);
+	uint32_t victim = 0;
+	for (uint32_t way = 1; way < desc->ways; way++){
+		if (counts[way] < counts[victim]) victim = way;
+		}
+	return (int) victim;
+	}
+
+//=========================================================================
+/**
+ * @brief update the state of a set after a hit on one of its ways
+ * @param cache      : the cache
+ * @param desc       : its geometry (and policy)
+ * @param line_index : index of the set
+ * @param Way        : the way that has been accessed (not "way" : the LRU macros loop on way)
+ */
+REPLACE_INLINE void replacement_touch(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, uint8_t Way){
+	uint32_t* bits = cache_meta_bits(cache, desc, line_index);
+	switch (desc->replace){
+		case LRU       : { LRU_age_update(cache, desc, Way, line_index) } break;
+		case TREE_PLRU : tree_plru_touch(bits, desc->state_bit, desc->ways, Way); break;
+		case BIT_PLRU  : bit_plru_touch(bits, desc->age_bit, desc->ways, Way); break;
+		case SRRIP     :
+		case BRRIP     : cache_age_set(cache, desc, line_index, Way, 0); break;
+		case LFU       : if (cache_age(cache, desc, line_index, Way) < LFU_MAX)
+		                     cache_age_set(cache, desc, line_index, Way, cache_age(cache, desc, line_index, Way) + 1);
+		                 break;
+		default        : break; // FIFO, RANDOM : hits do not matter
+		}
+	}
+
+/**
+ * @brief update the state of a set after a line has been inserted in one of its ways
+ * @param cache      : the cache
+ * @param desc       : its geometry (and policy)
+ * @param line_index : index of the set
+ * @param Way        : the way of the new line
+ * @param cold_start : whether the way was empty (otherwise its line has just been evicted,
+ *                     its age being still in the way)
+ */
+REPLACE_INLINE void replacement_insert(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, uint8_t Way, bool cold_start){
+	uint32_t* bits = cache_meta_bits(cache, desc, line_index);
+	switch (desc->replace){
+		case LRU       : if (cold_start) { LRU_age_increase(cache, desc, Way, line_index) }
+		                 else { LRU_age_update(cache, desc, Way, line_index) }
+		                 break;
+		case FIFO      : { LRU_age_increase(cache, desc, Way, line_index) } break;
+		case TREE_PLRU : tree_plru_touch(bits, desc->state_bit, desc->ways, Way); break;
+		case BIT_PLRU  : bit_plru_touch(bits, desc->age_bit, desc->ways, Way); break;
+		case SRRIP     : cache_age_set(cache, desc, line_index, Way, RRIP_LONG); break;
+		case BRRIP     : cache_age_set(cache, desc, line_index, Way,
+		                               (replace_random(cache) % BRRIP_LONG_ONE_IN == 0) ? RRIP_LONG : RRIP_DISTANT); break;
+		case LFU       : cache_age_set(cache, desc, line_index, Way, 1); break;
+		default        : break; // RANDOM
+		}
+	}
+
+/**
+ * @brief choose the way to evict from a full set
+ * @param cache      : the cache
+ * @param desc       : its geometry (and policy)
+ * @param line_index : index of the set
+ * @return the way to evict, NOTHING_FOUND if none
+ */
+REPLACE_INLINE int replacement_victim(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index){
+	uint32_t* bits = cache_meta_bits(cache, desc, line_index);
+	switch (desc->replace){
+		case TREE_PLRU : return (int) tree_plru_victim(bits, desc->state_bit, desc->ways);
+		case BIT_PLRU  : {
+			uint32_t unused = cache_bits_first_zero(bits, desc->age_bit, desc->ways);
+			return unused == desc->ways ? 0 : (int) unused;
+			}
+		case RANDOM    : return (int) (replace_random(cache) % desc->ways);
+		case SRRIP     :
+		case BRRIP     : return rrip_victim(bits, desc);
+		case LFU       : return lfu_victim(bits, desc);
+		default        : return oldest_way(bits, desc); // LRU, FIFO
+		}
+	}
+
+//=========================================================================
+/**
+ * @brief whether a mask holds one of the count ways from way first on
+ */
+REPLACE_INLINE bool any_way_in(const cache_way_mask_t* mask, uint32_t first, uint32_t count){
+	for (uint32_t way = first; way < first + count; way++){
+		if (cache_way_in(mask, way)) return true;
+		}
+	return false;
+	}
+
+/**
+ * @brief choose the way to evict from a set whose ways of a mask are full, among them (see partition.h) :
+ *        the victim the policy would choose if the set only had these ways (TREE_PLRU following the tree
+ *        away from the halves without any, RRIP only ageing them)
+ * @param cache      : the cache
+ * @param desc       : its geometry (and policy)
+ * @param line_index : index of the set
+ * @param mask       : the ways, at least one
+ * @return the way to evict, NOTHING_FOUND if none
+ */
+REPLACE_INLINE int replacement_victim_masked(cache_store_t* cache, const cache_desc_t* desc, uint16_t line_index, const cache_way_mask_t* mask){
+	uint32_t* bits = cache_meta_bits(cache, desc, line_index);
+	uint8_t ages[CACHE_MAX_WAYS];
+	cache_ages_load(bits, desc, ages);
+	int victim = NOTHING_FOUND;
+	switch (desc->replace){
+		case TREE_PLRU : {
+			uint32_t node = 1, first = 0;
+			for (uint32_t half = desc->ways >> 1; half > 0; half >>= 1){
+				uint32_t right = tree_plru_bit(bits, desc->state_bit, node);
+				if (!any_way_in(mask, first + right * half, half)) right = !right;
+				first += right * half;
+				node = 2 * node + right;
+				}
+			return (int) first;
+			}
+		case BIT_PLRU  :
+			for (uint32_t way = 0; way < desc->ways; way++){ // the first unused way, the first way otherwise
+				if (!cache_way_in(mask, way)) continue;
+				if (victim == NOTHING_FOUND) victim = (int) way;
+				if (ages[way] == 0) return (int) way;
+				}
+			return victim;
+		case RANDOM    : {
+			uint32_t count = 0;
+			for (uint32_t way = 0; way < desc->ways; way++) count += cache_way_in(mask, way);
+			uint32_t n = replace_random(cache) % count; // the n-th way of the mask
+			for (uint32_t way = 0; way < desc->ways; way++){
+				if (cache_way_in(mask, way) && n-- == 0) return (int) way;
+				}
+			return NOTHING_FOUND;
+			}
+		case SRRIP     :
+		case BRRIP     : {
+			for (uint32_t way = 0; way < desc->ways; way++){
+				if (cache_way_in(mask, way) && (victim == NOTHING_FOUND || ages[way] > ages[victim])) victim = (int) way;
+				}
+			uint8_t delta = (uint8_t) (RRIP_DISTANT - ages[victim]);
+			for (uint32_t way = 0; delta > 0 && way < desc->ways; way++){
+				if (cache_way_in(mask, way)) ages[way] = (uint8_t) (ages[way] + delta);
+				}
+			if (delta > 0) cache_ages_store(bits, desc, ages);
+			return victim;
+			}
+		case LFU       :
+			for (uint32_t way = 0; way < desc->ways; way++){
+				if (cache_way_in(mask, way) && (victim == NOTHING_FOUND || ages[way] < ages[victim])) victim = (int) way;
+				}
+			return victim;
+		default        : { // LRU, FIFO : the oldest valid way (the last one on ties)
+			unsigned int max_age = 0;
+			for (uint32_t way = 0; way < desc->ways; way++){
+				if (cache_way_in(mask, way) && cache_bits_get(bits, way, 1u) && ages[way] >= max_age){
+					max_age = ages[way];
+					victim = (int) way;
+					}
+				}
+			return victim;
+			}
+		}
+	}
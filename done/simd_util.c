@@ -0,0 +1,198 @@
+/**
+ * @file simd_util.c
+ * @brief SIMD kernels (SSE2/AVX2 with a scalar fallback) used to compare
+ *        many tags at once, selected at runtime from the host CPU features
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "simd_util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+//=========================================================================
+/**
+ * @brief scalar fallback : simply iterate on every key
+ */
+static size_t find_u64_scalar(const uint64_t* keys, size_t n, uint64_t key){
+	for (size_t i = 0; i < n; i++){
+		if (keys[i] == key) return i;
+		}
+	return n;
+	}
+
+/**
+ * @brief probe the ways from i on one by one (first_invalid is only set if it is still n)
+ */
+static size_t probe_u32_from(const uint32_t* tags, const uint32_t* valid_mask, size_t i, size_t n, uint32_t key, size_t* first_invalid){
+	for (; i < n; i++){
+		if (!((valid_mask[i / 32] >> (i % 32)) & 1u)) { if (*first_invalid == n) *first_invalid = i; }
+		else if (tags[i] == key) return i;
+		}
+	return n;
+	}
+
+/**
+ * @brief scalar fallback of simd_probe_u32 : simply iterate on every way
+ */
+static size_t probe_u32_scalar(const uint32_t* tags, const uint32_t* valid_mask, size_t n, uint32_t key, size_t* first_invalid){
+	*first_invalid = n;
+	return probe_u32_from(tags, valid_mask, 0, n, key, first_invalid);
+	}
+
+/**
+ * @brief use the hit and invalid masks of a chunk starting at way i
+ *        (bit j of a mask is set for way i + j) : returns from the kernel
+ *        on a hit, records the first invalid way otherwise
+ */
+#define probe_resolve(hit_mask, invalid_mask, i, n, first_invalid)                                    \
+	if (hit_mask) return (i) + (size_t) __builtin_ctz((unsigned) (hit_mask));                       \
+	if ((invalid_mask) && *(first_invalid) == (n))                                                    \
+		*(first_invalid) = (i) + (size_t) __builtin_ctz((unsigned) (invalid_mask));
+
+/**
+ * @brief valid bits of the WIDTH ways of a chunk starting at way i (i a multiple of WIDTH, a power of 2 up to 32)
+ */
+#define probe_valid_bits(valid_mask, i, WIDTH) \
+	((valid_mask[(i) / 32] >> ((i) % 32)) & ((1u << (WIDTH)) - 1u))
+
+#ifdef SIMD_X86
+//=========================================================================
+/**
+ * @brief SSE2 kernel, 4 keys per iteration
+ *
+ * SSE2 has no 64 bits comparison : compare the 32 bits halves, swap them
+ * and AND both results so that a 64 bits lane is set only if both halves match.
+ * movemask_pd then gives one bit per 64 bits lane.
+ */
+__attribute__((target("sse2")))
+static size_t find_u64_sse2(const uint64_t* keys, size_t n, uint64_t key){
+	const __m128i needle = _mm_set1_epi64x((long long) key);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4){
+		__m128i lo = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(keys + i)), needle);
+		__m128i hi = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(keys + i + 2)), needle);
+		lo = _mm_and_si128(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+		hi = _mm_and_si128(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+		int mask = _mm_movemask_pd(_mm_castsi128_pd(lo)) | (_mm_movemask_pd(_mm_castsi128_pd(hi)) << 2);
+		if (mask != 0) return i + (size_t) __builtin_ctz((unsigned) mask);
+		}
+	size_t tail = find_u64_scalar(keys + i, n - i, key); //remaining keys (less than 4)
+	return i + tail;
+	}
+
+//=========================================================================
+/**
+ * @brief AVX2 kernel, 8 keys per iteration (two 256 bits comparisons)
+ */
+__attribute__((target("avx2")))
+static size_t find_u64_avx2(const uint64_t* keys, size_t n, uint64_t key){
+	const __m256i needle = _mm256_set1_epi64x((long long) key);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8){
+		__m256i lo = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(keys + i)), needle);
+		__m256i hi = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(keys + i + 4)), needle);
+		int mask = _mm256_movemask_pd(_mm256_castsi256_pd(lo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(hi)) << 4);
+		if (mask != 0) return i + (size_t) __builtin_ctz((unsigned) mask);
+		}
+	size_t tail = find_u64_scalar(keys + i, n - i, key); //remaining keys (less than 8) : scalar, the SSE2 kernel would pay an AVX/SSE transition
+	return i + tail;
+	}
+
+//=========================================================================
+/**
+ * @brief SSE2 set probe, 4 ways per iteration : the lanes matching the key are
+ *        masked by the valid bits of their ways
+ */
+__attribute__((target("sse2")))
+static size_t probe_u32_sse2(const uint32_t* tags, const uint32_t* valid_mask, size_t n, uint32_t key, size_t* first_invalid){
+	const __m128i needle = _mm_set1_epi32((int) key);
+	*first_invalid = n;
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4){
+		unsigned valid = probe_valid_bits(valid_mask, i, 4);
+		__m128i match = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(tags + i)), needle);
+		unsigned hit_mask = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(match)) & valid;
+		unsigned invalid_mask = ~valid & 0xFu;
+		probe_resolve(hit_mask, invalid_mask, i, n, first_invalid);
+		}
+	return probe_u32_from(tags, valid_mask, i, n, key, first_invalid); //remaining ways (less than 4)
+	}
+
+//=========================================================================
+/**
+ * @brief AVX2 set probe, 8 ways per iteration
+ */
+__attribute__((target("avx2")))
+static size_t probe_u32_avx2(const uint32_t* tags, const uint32_t* valid_mask, size_t n, uint32_t key, size_t* first_invalid){
+	const __m256i needle = _mm256_set1_epi32((int) key);
+	*first_invalid = n;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8){
+		unsigned valid = probe_valid_bits(valid_mask, i, 8);
+		__m256i match = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(tags + i)), needle);
+		unsigned hit_mask = (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(match)) & valid;
+		unsigned invalid_mask = ~valid & 0xFFu;
+		probe_resolve(hit_mask, invalid_mask, i, n, first_invalid);
+		}
+	//remaining ways (less than 8) : scalar, the SSE2 kernel would pay an AVX/SSE transition
+	return probe_u32_from(tags, valid_mask, i, n, key, first_invalid);
+	}
+#endif
+
+//=========================================================================
+//=========================== RUNTIME DISPATCH ============================
+/**
+ * level supported by the host, -1 until it has been checked
+ */
+static int host_level = -1;
+/**
+ * kernels currently in use
+ */
+static size_t (*find_u64)(const uint64_t*, size_t, uint64_t) = NULL;
+static size_t (*probe_u32)(const uint32_t*, const uint32_t*, size_t, uint32_t, size_t*) = NULL;
+
+/**
+ * @brief select the kernel matching the given level
+ */
+static void select_kernels(simd_level_t level){
+	switch (level){
+#ifdef SIMD_X86
+		case SIMD_AVX2 : find_u64 = find_u64_avx2  ; probe_u32 = probe_u32_avx2  ; break;
+		case SIMD_SSE2 : find_u64 = find_u64_sse2  ; probe_u32 = probe_u32_sse2  ; break;
+#endif
+		default        : find_u64 = find_u64_scalar; probe_u32 = probe_u32_scalar; break;
+		}
+	}
+
+simd_level_t simd_level(void){
+	if (host_level < 0){
+		host_level = SIMD_SCALAR;
+#ifdef SIMD_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2")) host_level = SIMD_SSE2;
+		if (__builtin_cpu_supports("avx2")) host_level = SIMD_AVX2;
+#endif
+		select_kernels((simd_level_t) host_level);
+		}
+	return (simd_level_t) host_level;
+	}
+
+void simd_force_level(simd_level_t level){
+	simd_level_t host = simd_level();
+	select_kernels(level < host ? level : host);
+	}
+
+size_t simd_find_u64(const uint64_t* keys, size_t n, uint64_t key){
+	if (find_u64 == NULL) (void) simd_level();
+	return find_u64(keys, n, key);
+	}
+
+size_t simd_probe_u32(const uint32_t* tags, const uint32_t* valid_mask, size_t n, uint32_t key, size_t* first_invalid){
+	if (probe_u32 == NULL) (void) simd_level();
+	return probe_u32(tags, valid_mask, n, key, first_invalid);
+	}
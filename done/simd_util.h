@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * @file simd_util.h
+ * @brief SIMD kernels (SSE2/AVX2 with a scalar fallback) used to compare
+ *        many tags at once, selected at runtime from the host CPU features
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+/*
+ * instruction sets a kernel can be built with, ordered by preference
+ */
+typedef enum {
+	SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2
+	} simd_level_t;
+
+/**
+ * @brief the best instruction set supported by the host (checked once, at the first call)
+ */
+simd_level_t simd_level(void);
+
+/**
+ * @brief force the kernels to use at most the given instruction set
+ *        (useful to compare the kernels against the scalar fallback)
+ * @param level the instruction set to use, clamped to what the host supports
+ */
+void simd_force_level(simd_level_t level);
+
+/**
+ * @brief find the first element of keys equal to key
+ *
+ * @param keys array of n keys
+ * @param n number of keys
+ * @param key value to look for
+ * @return the index of the first match, or n if key was not found
+ */
+size_t simd_find_u64(const uint64_t* keys, size_t n, uint64_t key);
+
+/**
+ * @brief probe a set of n ways : find the first valid way whose tag is key
+ *        and, on a miss, the first invalid way
+ *
+ * @param tags array of n tags
+ * @param valid_mask valid bits of the n ways (bit i % 32 of word i / 32 : way i is valid)
+ * @param n number of ways
+ * @param key tag to look for
+ * @param first_invalid (modified) the first invalid way (n if all are valid), meaningful on a miss only
+ * @return the way of the hit, or n on a miss
+ */
+size_t simd_probe_u32(const uint32_t* tags, const uint32_t* valid_mask, size_t n, uint32_t key, size_t* first_invalid);
@@ -19,10 +19,20 @@
 #include "commands.h"
 #include "memory.h"
 #include "page_walk.h"
+#include "simd_util.h"
+#include "write_buffer.h"
+#include "miss_class.h"
+#include "prefetch.h"
+#include "timing.h"
+#include "mshr.h"
+#include "partition.h"
+#include "multicore.h"
+#include "checkpoint.h"
 
 // #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <inttypes.h> // for PRIu64
 // #include <ctype.h> // for isspace()
 // #include <inttypes.h> // for SCNx macro
 
@@ -32,45 +42,86 @@ static void error(const char* pgm, const char* msg)
     assert(msg != NULL);
     fputs("ERROR: ", stderr);
     fputs(msg, stderr);
-    fprintf(stderr, "\nusage:    %s (dump|desc) mem_filename command_filename\n", pgm);
+    fprintf(stderr, "\nusage:    %s (dump|desc) mem_filename command_filename [l1_lines l1_ways l2_lines l2_ways line_bytes] [scalar|sse2|avx2] [writeback] [noallocate] [wbufN] [l3=LINES,WAYS] [prefetch=KIND[,DEGREE[,LEVEL[,LATENCY]]]] [policy] [traffic] [classify] [timing] [core=COMMAND_FILE]... [quantum=N] [block=BYTES] [victim=N] [inclusive|exclusive|nine] [checkpoint=FILE,N] [restore=FILE] [sectors=N] [mshr=N] [partition=CORE,FIRST,WAYS]...\n", pgm);
     fprintf(stderr, "examples: %s dump memory_dump.bin commands01.txt\n", pgm);
     fprintf(stderr, "          %s desc memory_description.txt commands01.txt\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 64 4 512 8 16\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt scalar\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 64 4 512 8 16 writeback tree-plru traffic\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 64 4 512 8 16 l3=4096,16 traffic\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 2 2 4 2 16 classify\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 2 2 4 2 16 prefetch=stream,2,1\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 64 4 512 8 16 l3=4096,16 timing\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 2 2 4 2 16 writeback core=commands02.txt quantum=2\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 2 2 4 4 16 core=commands02.txt partition=0,0,1 partition=1,1,3\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 2 2 4 2 16 block=40 traffic\n", pgm);
+    fprintf(stderr, "          %s dump memory_dump.bin commands01.txt 2 1 4 2 16 victim=2 writeback traffic\n", pgm);
 }
 
 // ======================================================================
+#define MAX_BLOCK_BYTES 4096 // bytes of a block access, at most
 #define phy_to_int(phy) (uint32_t)(((phy)->phy_page_num << 12) | (phy)->page_offset)
 //=======================================================================
 void execute_command(void *mem_space,
                      const command_t* command,
-                     l1_icache_entry_t *l1_icache,
-                     l1_icache_entry_t *l1_dcache,
-                     l2_cache_entry_t *l2_cache)
+                     cache_store_t *l1_icache,
+                     cache_store_t *l1_dcache,
+                     cache_store_t *l2_cache,
+                     const cache_hrchy_t *hrchy,
+                     size_t block)
 {
     phy_addr_t paddr;
     assert(page_walk(mem_space, &command->vaddr, &paddr) == ERR_NONE);
     uint8_t byte;
     uint32_t word;
-    void *l1_cache;
+    cache_store_t *l1_cache;
     uint32_t phy_addr = phy_to_int(&paddr);
+    cache_replace_t replace = l2_cache->desc.replace; // policy of the caches
     
 	//printf("=== phyaddr %x, type = %s\n", phy_addr, (command->order == READ)? "READ": "WRITE");
+    if (block > 0) { // block access of block bytes, the data of a write being repeated
+        uint8_t bytes[MAX_BLOCK_BYTES];
+        for (size_t i = 0; command->order == WRITE && i < block; i++)
+            bytes[i] = (uint8_t) (command->write_data >> (8 * (i % command->data_size)));
+        l1_cache = (command->type == INSTRUCTION)? l1_icache: l1_dcache;
+        if (hrchy != NULL && command->order == READ)
+            cache_hrchy_read_block(mem_space, hrchy, &paddr, command->type, bytes, block);
+        else if (hrchy != NULL)
+            cache_hrchy_write_block(mem_space, hrchy, &paddr, bytes, block);
+        else if (command->order == READ)
+            cache_read_block(mem_space, &paddr, command->type, l1_cache, l2_cache, bytes, block, replace);
+        else
+            cache_write_block(mem_space, &paddr, l1_dcache, l2_cache, bytes, block, replace);
+        return;
+    }
+    if (hrchy != NULL) { // deeper hierarchy
+        if (command->order == READ && command->data_size == 4)
+            cache_hrchy_read(mem_space, hrchy, &paddr, command->type, &word);
+        else if (command->order == READ)
+            cache_hrchy_read_byte(mem_space, hrchy, &paddr, command->type, &byte);
+        else if (command->data_size == 4)
+            cache_hrchy_write(mem_space, hrchy, &paddr, &command->write_data);
+        else
+            cache_hrchy_write_byte(mem_space, hrchy, &paddr, (uint8_t)command->write_data);
+        return;
+    }
     switch (command->order) {
     case READ:
         l1_cache = (command->type == INSTRUCTION)? l1_icache: l1_dcache;
         if(command->data_size == 4)
             cache_read(mem_space, &paddr, command->type, l1_cache,
-                       l2_cache, &word, LRU);
+                       l2_cache, &word, replace);
         else
             cache_read_byte(mem_space, &paddr, command->type, l1_cache,
-                            l2_cache, &byte, LRU);
+                            l2_cache, &byte, replace);
         break;
     case WRITE:
         if(command->data_size == 4)
             cache_write(mem_space, &paddr, l1_dcache,
-                        l2_cache, &command->write_data, LRU);
+                        l2_cache, &command->write_data, replace);
         else
             cache_write_byte(mem_space, &paddr, l1_dcache,
-                             l2_cache, (uint8_t)command->write_data, LRU);
+                             l2_cache, (uint8_t)command->write_data, replace);
         break;
     default:
         assert(0);
@@ -93,6 +144,165 @@ int main(int argc, char *argv[])
         dump = 0;
     }
 
+    /* optional last arguments, in any order :
+     *  - highest instruction set of the set probes (scalar, sse2 or avx2)
+     *  - writeback : write-back caches instead of write-through
+     *  - noallocate : no-write-allocate L1 DCACHE (stores that miss go around the caches)
+     *  - wbufN     : coalescing write buffer of N entries between the caches and memory
+     *  - l3=LINES,WAYS : unified L3 CACHE below L2 (same line size and policies)
+     *  - traffic   : print the memory traffic of each cache at the end
+     *  - classify  : classify the misses of each cache (compulsory, capacity, conflict) and print them at the end
+     *  - timing    : print the cycles of the accesses (default latencies) at the end
+     *  - prefetch=KIND[,DEGREE[,LEVEL[,LATENCY]]] : prefetcher (next-line, stride or stream on L1 DCACHE,
+     *              next-n on L1 ICACHE) filling level LEVEL (0 : L1), printed at the end
+     *  - core=FILE : one more core (repeatable), with its own L1s and the program of FILE, the other levels
+     *              being shared ; the cores run their programs in turn, the caches and the coherence events
+     *              of each core being printed at the end
+     *  - quantum=N : commands a core executes before the next one runs (default : 1)
+     *  - block=BYTES : each command accesses BYTES bytes from its address in one block access
+     *              (its data repeated for a write), the block counters being printed at the end
+     *  - victim=N  : victim cache of N entries below each L1 (single core), dumped with it, its counters being printed at the end
+     *  - inclusive, exclusive or nine : inclusion policy of the hierarchy (single core, exclusive by default),
+     *              the fills, evictions and copies of each cache being printed at the end
+     *  - checkpoint=FILE,N : save the state of the caches, timing model and memory to FILE after N commands (single core)
+     *  - restore=FILE : restore that state from FILE, then execute the commands following its position (single core)
+     *  - sectors=N : lines of every cache split into N sectors, read from memory when first accessed (exclusive
+     *              hierarchy, without victim caches), the sector counters of each cache being printed at the end
+     *  - mshr=N    : non-blocking L1s, with N MSHRs each (with timing), their activity being printed at the end
+     *  - partition=CORE,FIRST,WAYS : (repeatable) the fills of core CORE (0 : the core of command_filename) only take
+     *              the WAYS ways of L2 from way FIRST on, the other cores all its ways ; the ways, fills and
+     *              evictions of each core in L2 being printed at the end
+     *  - a replacement policy (lru, tree-plru, bit-plru, fifo, random, srrip, brrip or lfu) */
+    const char* levels[] = { "scalar", "sse2", "avx2" };
+    const char* policies[CACHE_REPLACE_NB] = { "lru", "tree-plru", "bit-plru", "fifo", "random", "srrip", "brrip", "lfu" };
+    cache_replace_t replace = LRU;
+    int write_back = 0, no_allocate = 0, traffic = 0, classify = 0, timed = 0, found = 1;
+    uint32_t wbuf_size = 0, l3_lines = 0, l3_ways = 0;
+    const char* prefetchers[PREFETCH_KIND_NB] = { "next-line", "stride", "stream", "next-n" };
+    int prefetch = -1;
+    uint32_t pf_degree = 1, pf_level = 0, pf_latency = 0;
+    const char* core_files[MULTICORE_MAX_CORES - 1];
+    size_t nb_others = 0, quantum = 1, block = 0;
+    uint32_t victim_entries = 0;
+    const char* inclusions[] = { "exclusive", "inclusive", "nine" };
+    int inclusion = -1;
+    const char* checkpoint_file = NULL;
+    const char* restore_file = NULL;
+    uint64_t checkpoint_at = 0;
+    uint32_t sectors = 1;
+    uint32_t mshr_size = 0;
+    uint32_t part_ways[MULTICORE_MAX_CORES][3]; // core, first way, ways
+    size_t nb_parts = 0;
+    while (found && argc > 4) {
+        found = 0;
+        for (int l = SIMD_SCALAR; l <= SIMD_AVX2 && !found; l++) {
+            if (!strcmp(argv[argc - 1], levels[l])) {
+                simd_force_level((simd_level_t) l);
+                found = 1;
+            }
+        }
+        if (!strcmp(argv[argc - 1], "writeback")) write_back = found = 1;
+        if (!strcmp(argv[argc - 1], "traffic")) traffic = found = 1;
+        if (!strcmp(argv[argc - 1], "classify")) classify = found = 1;
+        if (!strcmp(argv[argc - 1], "timing")) timed = found = 1;
+        for (int i = CACHE_EXCLUSIVE; i <= CACHE_NINE && !found; i++) {
+            if (!strcmp(argv[argc - 1], inclusions[i])) {
+                inclusion = i;
+                found = 1;
+            }
+        }
+        for (int p = LRU; p < CACHE_REPLACE_NB && !found; p++) {
+            if (!strcmp(argv[argc - 1], policies[p])) {
+                replace = (cache_replace_t) p;
+                found = 1;
+            }
+        }
+        if (!strcmp(argv[argc - 1], "noallocate")) no_allocate = found = 1;
+        if (!strncmp(argv[argc - 1], "wbuf", 4)) {
+            wbuf_size = (uint32_t) strtoul(argv[argc - 1] + 4, NULL, 0);
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "l3=", 3)) {
+            if (sscanf(argv[argc - 1] + 3, "%" SCNu32 ",%" SCNu32, &l3_lines, &l3_ways) != 2) {
+                error(argv[0], "invalid L3 geometry.");
+                return 2;
+            }
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "prefetch=", 9)) {
+            const char* kind = argv[argc - 1] + 9;
+            for (int k = PREFETCH_NEXT_LINE; k < PREFETCH_KIND_NB && prefetch < 0; k++) {
+                size_t len = strlen(prefetchers[k]);
+                if (!strncmp(kind, prefetchers[k], len) && (kind[len] == '\0' || kind[len] == ',')) {
+                    prefetch = k;
+                    if (kind[len] == ',') sscanf(kind + len + 1, "%" SCNu32 ",%" SCNu32 ",%" SCNu32, &pf_degree, &pf_level, &pf_latency);
+                }
+            }
+            if (prefetch < 0) {
+                error(argv[0], "unknown prefetcher.");
+                return 2;
+            }
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "core=", 5)) {
+            if (nb_others == MULTICORE_MAX_CORES - 1) {
+                error(argv[0], "too many cores.");
+                return 2;
+            }
+            core_files[nb_others++] = argv[argc - 1] + 5;
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "block=", 6)) {
+            block = (size_t) strtoul(argv[argc - 1] + 6, NULL, 0);
+            if (block > MAX_BLOCK_BYTES) {
+                error(argv[0], "block too large.");
+                return 2;
+            }
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "victim=", 7)) {
+            victim_entries = (uint32_t) strtoul(argv[argc - 1] + 7, NULL, 0);
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "checkpoint=", 11)) {
+            char* comma = strrchr(argv[argc - 1], ',');
+            if (comma == NULL) {
+                error(argv[0], "missing checkpoint position.");
+                return 2;
+            }
+            *comma = '\0';
+            checkpoint_file = argv[argc - 1] + 11;
+            checkpoint_at = strtoull(comma + 1, NULL, 0);
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "restore=", 8)) {
+            restore_file = argv[argc - 1] + 8;
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "sectors=", 8)) {
+            sectors = (uint32_t) strtoul(argv[argc - 1] + 8, NULL, 0);
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "mshr=", 5)) {
+            mshr_size = (uint32_t) strtoul(argv[argc - 1] + 5, NULL, 0);
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "partition=", 10)) {
+            if (nb_parts == MULTICORE_MAX_CORES || sscanf(argv[argc - 1] + 10, "%" SCNu32 ",%" SCNu32 ",%" SCNu32,
+                                                          &part_ways[nb_parts][0], &part_ways[nb_parts][1], &part_ways[nb_parts][2]) != 3) {
+                error(argv[0], "invalid partition.");
+                return 2;
+            }
+            nb_parts++;
+            found = 1;
+        }
+        if (!strncmp(argv[argc - 1], "quantum=", 8)) {
+            quantum = (size_t) strtoul(argv[argc - 1] + 8, NULL, 0);
+            found = 1;
+        }
+        if (found) argc--;
+    }
+
     void* mem_space = NULL;
     size_t mem_size = 0;
     int err = ERR_NONE;
@@ -105,29 +315,326 @@ int main(int argc, char *argv[])
     program_t pgm;
     if (err == ERR_NONE) {
         if(program_read(argv[3], &pgm) == ERR_NONE) {
-            l1_icache_entry_t l1_icache[L1_ICACHE_LINES * L1_ICACHE_WAYS];
-            l1_icache_entry_t l1_dcache[L1_DCACHE_LINES * L1_DCACHE_WAYS];
-            l2_cache_entry_t l2_cache[L2_CACHE_LINES * L2_CACHE_WAYS];
-            memset(l1_icache, 0, sizeof(l1_icache));
-            memset(l1_dcache, 0, sizeof(l1_dcache));
-            memset(l2_cache,  0, sizeof(l2_cache));
+            /* Geometry : the presets, or the one given on the command line */
+            cache_desc_t l1_desc, l2_desc, l3_desc;
+            assert(cache_desc_preset(&l1_desc, L1_ICACHE) == ERR_NONE);
+            assert(cache_desc_preset(&l2_desc, L2_CACHE) == ERR_NONE);
+            if (argc >= 9) {
+                uint32_t line_bytes = (uint32_t) strtoul(argv[8], NULL, 0);
+                if (cache_desc_init(&l1_desc, (uint32_t) strtoul(argv[4], NULL, 0), (uint32_t) strtoul(argv[5], NULL, 0), line_bytes, replace) != ERR_NONE
+                    || cache_desc_init(&l2_desc, (uint32_t) strtoul(argv[6], NULL, 0), (uint32_t) strtoul(argv[7], NULL, 0), line_bytes, replace) != ERR_NONE) {
+                    error(argv[0], "invalid cache geometry.");
+                    return 2;
+                }
+            } else if (replace != LRU) {
+                assert(cache_desc_init(&l1_desc, l1_desc.lines, l1_desc.ways, l1_desc.line_bytes, replace) == ERR_NONE);
+                assert(cache_desc_init(&l2_desc, l2_desc.lines, l2_desc.ways, l2_desc.line_bytes, replace) == ERR_NONE);
+            }
+            if (l3_lines > 0 && cache_desc_init(&l3_desc, l3_lines, l3_ways, l2_desc.line_bytes, replace) != ERR_NONE) {
+                error(argv[0], "invalid L3 geometry.");
+                return 2;
+            }
+            if (write_back) {
+                assert(cache_desc_set_write(&l1_desc, WRITE_BACK) == ERR_NONE);
+                assert(cache_desc_set_write(&l2_desc, WRITE_BACK) == ERR_NONE);
+                if (l3_lines > 0) assert(cache_desc_set_write(&l3_desc, WRITE_BACK) == ERR_NONE);
+            }
+            if (no_allocate) assert(cache_desc_set_alloc(&l1_desc, NO_WRITE_ALLOCATE) == ERR_NONE);
+            if (cache_desc_set_sectors(&l1_desc, sectors) != ERR_NONE || cache_desc_set_sectors(&l2_desc, sectors) != ERR_NONE
+                || (l3_lines > 0 && cache_desc_set_sectors(&l3_desc, sectors) != ERR_NONE)) {
+                error(argv[0], "invalid number of sectors.");
+                return 2;
+            }
+            if (sectors > 1 && (victim_entries > 0 || inclusion > CACHE_EXCLUSIVE)) {
+                error(argv[0], "sectored caches need an exclusive hierarchy, without victim caches.");
+                return 2;
+            }
+            cache_store_t l1_icache, l1_dcache, l2_cache;
+            if (cache_init(&l1_icache, &l1_desc) != ERR_NONE || cache_init(&l1_dcache, &l1_desc) != ERR_NONE
+                || cache_init(&l2_cache, &l2_desc) != ERR_NONE) {
+                error(argv[0], "cannot allocate the caches.");
+                return 3;
+            }
+            cache_store_t l3_cache;
+            if (l3_lines > 0 && cache_init(&l3_cache, &l3_desc) != ERR_NONE) {
+                error(argv[0], "cannot allocate the caches.");
+                return 3;
+            }
+            write_buffer_t wbuf;
+            if (wbuf_size > 0) {
+                if (write_buffer_init(&wbuf, wbuf_size, l1_desc.line_bytes) != ERR_NONE) {
+                    error(argv[0], "invalid write buffer size.");
+                    return 2;
+                }
+                assert(cache_set_write_buffer(&l1_icache, &wbuf) == ERR_NONE);
+                assert(cache_set_write_buffer(&l1_dcache, &wbuf) == ERR_NONE);
+                assert(cache_set_write_buffer(&l2_cache, &wbuf) == ERR_NONE);
+                if (l3_lines > 0) assert(cache_set_write_buffer(&l3_cache, &wbuf) == ERR_NONE);
+            }
+            if ((checkpoint_file != NULL || restore_file != NULL) && nb_others > 0) {
+                error(argv[0], "checkpoints need a single core.");
+                return 2;
+            }
+            victim_cache_t victims[2]; // of L1 ICACHE and L1 DCACHE
+            const char* victim_names[] = { "L1_ICACHE_VICTIM", "L1_DCACHE_VICTIM" };
+            if (victim_entries > 0) {
+                if (nb_others > 0) {
+                    error(argv[0], "victim caches need a single core.");
+                    return 2;
+                }
+                if (cache_victim_init(&victims[0], victim_entries, &l1_desc) != ERR_NONE
+                    || cache_victim_init(&victims[1], victim_entries, &l1_desc) != ERR_NONE) {
+                    error(argv[0], "invalid victim cache size.");
+                    return 2;
+                }
+                if (wbuf_size > 0) {
+                    assert(cache_set_write_buffer(&victims[0].store, &wbuf) == ERR_NONE);
+                    assert(cache_set_write_buffer(&victims[1].store, &wbuf) == ERR_NONE);
+                }
+                assert(cache_set_victim(&l1_icache, &victims[0]) == ERR_NONE);
+                assert(cache_set_victim(&l1_dcache, &victims[1]) == ERR_NONE);
+            }
+            cache_store_t* caches[] = { &l1_icache, &l1_dcache, &l2_cache, &l3_cache };
+            const char* names[] = { "L1_ICACHE", "L1_DCACHE", "L2_CACHE", "L3_CACHE" };
+            int nb_caches = l3_lines > 0 ? 4 : 3;
+            miss_class_t mclass[4];
+            for (int c = 0; classify && c < nb_caches; c++) {
+                if (miss_class_init(&mclass[c], &caches[c]->desc) != ERR_NONE) {
+                    error(argv[0], "cannot allocate the miss classifiers.");
+                    return 3;
+                }
+                assert(cache_set_miss_class(caches[c], &mclass[c]) == ERR_NONE);
+            }
+            prefetcher_t pf;
+            cache_store_t* pf_cache = prefetch == PREFETCH_NEXT_N ? &l1_icache : &l1_dcache;
+            if (prefetch >= 0) {
+                if (prefetcher_init(&pf, (prefetch_kind_t) prefetch, pf_degree, pf_level, pf_latency, l1_desc.line_bytes) != ERR_NONE) {
+                    error(argv[0], "invalid prefetcher.");
+                    return 2;
+                }
+                assert(cache_set_prefetcher(pf_cache, &pf) == ERR_NONE);
+            }
+            timing_latencies_t latencies;
+            timing_t timing;
+            if (timed) {
+                assert(timing_latencies_default(&latencies) == ERR_NONE);
+                assert(timing_init(&timing, &latencies) == ERR_NONE);
+                assert(cache_set_timing(&l1_icache, &timing) == ERR_NONE);
+                assert(cache_set_timing(&l1_dcache, &timing) == ERR_NONE);
+            }
+            mshr_t mshrs[2]; // of L1 ICACHE and L1 DCACHE
+            if (mshr_size > 0) {
+                if (!timed) {
+                    error(argv[0], "MSHRs need the timing model.");
+                    return 2;
+                }
+                if (mshr_init(&mshrs[0], mshr_size, l1_desc.line_bytes) != ERR_NONE
+                    || mshr_init(&mshrs[1], mshr_size, l1_desc.line_bytes) != ERR_NONE) {
+                    error(argv[0], "invalid number of MSHRs.");
+                    return 2;
+                }
+                assert(cache_set_mshr(&l1_icache, &mshrs[0]) == ERR_NONE);
+                assert(cache_set_mshr(&l1_dcache, &mshrs[1]) == ERR_NONE);
+            }
+            way_partition_t part; // of L2, between the cores
+            if (nb_parts > 0) {
+                assert(partition_init(&part, (uint32_t) nb_others + 1, l2_desc.ways) == ERR_NONE);
+                for (size_t p = 0; p < nb_parts; p++) {
+                    if (partition_set_ways(&part, part_ways[p][0], part_ways[p][1], part_ways[p][2]) != ERR_NONE) {
+                        error(argv[0], "invalid partition.");
+                        return 2;
+                    }
+                }
+                assert(cache_set_partition(&l2_cache, &part) == ERR_NONE);
+            }
+            /* L1 ICACHE and L1 DCACHE, then unified L2 and L3 */
+            cache_hrchy_t hrchy;
+            int use_hrchy = l3_lines > 0 || inclusion >= 0;
+            if (use_hrchy) {
+                assert(cache_hrchy_init(&hrchy) == ERR_NONE);
+                assert(cache_hrchy_add_level(&hrchy, &l1_icache, &l1_dcache) == ERR_NONE);
+                assert(cache_hrchy_add_level(&hrchy, &l2_cache, &l2_cache) == ERR_NONE);
+                if (l3_lines > 0) assert(cache_hrchy_add_level(&hrchy, &l3_cache, &l3_cache) == ERR_NONE);
+                if (inclusion >= 0 && cache_hrchy_set_inclusion(&hrchy, (cache_inclusion_t) inclusion) != ERR_NONE) {
+                    error(argv[0], "invalid inclusion policy.");
+                    return 2;
+                }
+                if (inclusion > CACHE_EXCLUSIVE && (victim_entries > 0 || nb_others > 0)) {
+                    error(argv[0], "inclusive and NINE hierarchies need a single core, without victim caches.");
+                    return 2;
+                }
+            }
 
             /* Flush caches before use */
-            assert(cache_flush(l1_icache, L1_ICACHE) == ERR_NONE);
-            assert(cache_flush(l1_dcache, L1_DCACHE) == ERR_NONE);
-            assert(cache_flush(l2_cache, L2_CACHE) == ERR_NONE);
+            assert(cache_flush(&l1_icache) == ERR_NONE);
+            assert(cache_flush(&l1_dcache) == ERR_NONE);
+            assert(cache_flush(&l2_cache) == ERR_NONE);
+            if (l3_lines > 0) assert(cache_flush(&l3_cache) == ERR_NONE);
 			
-            for_all_lines(line, &pgm) {
-                execute_command(mem_space, line, l1_icache, l1_dcache, l2_cache);
-
-                printf("L1_ICACHE: \n\n");
-                cache_dump(stdout, l1_icache, L1_ICACHE);
-                printf("L1_DCACHE: \n\n");
-                cache_dump(stdout, l1_dcache, L1_DCACHE);
+            /* Other cores : their own L1s and program, L2 (and L3) being shared */
+            multicore_t mc;
+            program_t programs[MULTICORE_MAX_CORES];
+            cache_store_t icaches[MULTICORE_MAX_CORES], dcaches[MULTICORE_MAX_CORES];
+            if (nb_others > 0) {
+                assert(multicore_init(&mc) == ERR_NONE);
+                programs[0] = pgm;
+                assert(multicore_add_core(&mc, &l1_icache, &l1_dcache, NULL) == ERR_NONE);
+                for (size_t c = 1; c <= nb_others; c++) {
+                    if (program_read(core_files[nb_others - c], &programs[c]) != ERR_NONE) { // parsed from the last one
+                        error(argv[0], "problem initializing program from provided file.");
+                        return 3;
+                    }
+                    if (cache_init(&icaches[c], &l1_desc) != ERR_NONE || cache_init(&dcaches[c], &l1_desc) != ERR_NONE) {
+                        error(argv[0], "cannot allocate the caches.");
+                        return 3;
+                    }
+                    if (wbuf_size > 0) {
+                        assert(cache_set_write_buffer(&icaches[c], &wbuf) == ERR_NONE);
+                        assert(cache_set_write_buffer(&dcaches[c], &wbuf) == ERR_NONE);
+                    }
+                    assert(multicore_add_core(&mc, &icaches[c], &dcaches[c], NULL) == ERR_NONE);
+                }
+                assert(multicore_add_shared_level(&mc, &l2_cache) == ERR_NONE);
+                if (l3_lines > 0) assert(multicore_add_shared_level(&mc, &l3_cache) == ERR_NONE);
+                if (multicore_run(&mc, mem_space, programs, quantum) != ERR_NONE) {
+                    error(argv[0], "cannot run the cores.");
+                    return 3;
+                }
+                for (size_t c = 0; c < mc.nb_cores; c++) {
+                    printf("CORE %zu L1_ICACHE: \n\n", c);
+                    cache_dump(stdout, mc.core[c].icache);
+                    printf("CORE %zu L1_DCACHE: \n\n", c);
+                    cache_dump(stdout, mc.core[c].dcache);
+                }
                 printf("L2_CACHE: \n\n");
-                cache_dump(stdout, l2_cache, L2_CACHE);
+                cache_dump(stdout, &l2_cache);
+                if (l3_lines > 0) {
+                    printf("L3_CACHE: \n\n");
+                    cache_dump(stdout, &l3_cache);
+                }
                 printf("\n=======================================\n\n");
+                assert(multicore_print(stdout, &mc) == ERR_NONE);
+            } else {
+                /* State saved and restored by checkpoints : the caches (and victim caches), timing model and memory */
+                sim_state_t state = { { &l1_icache, &l1_dcache, &l2_cache, &l3_cache }, l3_lines > 0 ? 4 : 3,
+                                      NULL, timed ? &timing : NULL, mem_space, mem_size, 0 };
+                if (restore_file != NULL && sim_checkpoint_load(restore_file, &state) != ERR_NONE) {
+                    error(argv[0], "cannot restore the checkpoint.");
+                    return 3;
+                }
+                uint64_t executed = 0;
+                for_all_lines(line, &pgm) {
+                    if (executed++ < state.position) continue; // executed before the checkpoint
+                    execute_command(mem_space, line, &l1_icache, &l1_dcache, &l2_cache, use_hrchy ? &hrchy : NULL, block);
+
+                    printf("L1_ICACHE: \n\n");
+                    cache_dump(stdout, &l1_icache);
+                    printf("L1_DCACHE: \n\n");
+                    cache_dump(stdout, &l1_dcache);
+                    for (int v = 0; victim_entries > 0 && v < 2; v++) {
+                        printf("%s: \n\n", victim_names[v]);
+                        cache_dump(stdout, &victims[v].store);
+                    }
+                    printf("L2_CACHE: \n\n");
+                    cache_dump(stdout, &l2_cache);
+                    if (l3_lines > 0) {
+                        printf("L3_CACHE: \n\n");
+                        cache_dump(stdout, &l3_cache);
+                    }
+                    printf("\n=======================================\n\n");
+                    if (checkpoint_file != NULL && executed == checkpoint_at) {
+                        if (wbuf_size > 0) assert(write_buffer_drain(mem_space, &wbuf) == ERR_NONE);
+                        state.position = executed;
+                        if (sim_checkpoint_save(checkpoint_file, &state) != ERR_NONE) {
+                            error(argv[0], "cannot save the checkpoint.");
+                            return 3;
+                        }
+                    }
+                }
+            }
+            if (traffic) {
+                /* write-back : flush the dirty lines left in the caches (L1 first, they are the most recent) */
+                if (nb_others > 0) {
+                    assert(multicore_writeback_all(mem_space, &mc) == ERR_NONE);
+                } else if (use_hrchy) {
+                    assert(cache_hrchy_writeback_all(mem_space, &hrchy) == ERR_NONE);
+                } else {
+                    assert(cache_writeback_all(mem_space, &l1_dcache) == ERR_NONE);
+                    assert(cache_writeback_all(mem_space, &l2_cache) == ERR_NONE);
+                }
+                for (int c = 0; c < nb_caches; c++) {
+                    printf("%s: memory reads %" PRIu64 ", memory writes %" PRIu64 ", write-backs %" PRIu64 "\n", names[c],
+                           caches[c]->counters.mem_reads, caches[c]->counters.mem_writes, caches[c]->counters.writebacks);
+                }
+                for (int v = 0; victim_entries > 0 && v < 2; v++) {
+                    const cache_counters_t* counters = &victims[v].store.counters;
+                    printf("%s: memory reads %" PRIu64 ", memory writes %" PRIu64 ", write-backs %" PRIu64 "\n", victim_names[v],
+                           counters->mem_reads, counters->mem_writes, counters->writebacks);
+                }
+                if (wbuf_size > 0) {
+                    assert(write_buffer_drain(mem_space, &wbuf) == ERR_NONE);
+                    printf("WRITE_BUFFER: stores %" PRIu64 ", merges %" PRIu64 ", memory writes %" PRIu64 "\n",
+                           wbuf.counters.stores, wbuf.counters.merges, wbuf.counters.drains);
+                }
+            }
+            for (int c = 0; classify && c < nb_caches; c++) {
+                const miss_class_counters_t* counters = &mclass[c].counters;
+                printf("%s: accesses %" PRIu64 ", hits %" PRIu64 ", compulsory misses %" PRIu64 ", capacity misses %" PRIu64
+                       ", conflict misses %" PRIu64 "\n", names[c], counters->accesses, counters->hits,
+                       counters->misses[MISS_COMPULSORY], counters->misses[MISS_CAPACITY], counters->misses[MISS_CONFLICT]);
+                miss_class_free(&mclass[c]);
+            }
+            if (prefetch >= 0) {
+                const prefetch_counters_t* counters = &pf.counters;
+                printf("PREFETCHER (%s on %s): issued %" PRIu64 ", fills %" PRIu64 ", useful %" PRIu64 ", late %" PRIu64 ", misses %" PRIu64 "\n",
+                       prefetchers[prefetch], names[pf_cache == &l1_icache ? 0 : 1], counters->issued, counters->fills,
+                       counters->useful, counters->late, counters->misses);
+            }
+            for (int c = 0; block > 0 && c < 2; c++) {
+                const cache_block_counters_t* counters = &caches[c]->blocks;
+                printf("%s: block reads %" PRIu64 ", block writes %" PRIu64 ", bytes %" PRIu64 ", lines %" PRIu64 "\n", names[c],
+                       counters->reads, counters->writes, counters->bytes, counters->lines);
+            }
+            for (int v = 0; victim_entries > 0 && v < 2; v++) {
+                const cache_victim_counters_t* counters = &victims[v].counters;
+                printf("%s: probes %" PRIu64 ", hits %" PRIu64 ", fills %" PRIu64 ", evictions %" PRIu64 "\n", victim_names[v],
+                       counters->probes, counters->hits, counters->fills, counters->evictions);
+            }
+            for (int c = 0; inclusion >= 0 && c < nb_caches; c++) {
+                const cache_inclusion_counters_t* counters = &caches[c]->inclusion;
+                printf("%s: fills %" PRIu64 ", evictions %" PRIu64 ", back-invalidations %" PRIu64 ", victim fills %" PRIu64
+                       ", promotions %" PRIu64 ", copies %" PRIu64 "\n", names[c], counters->fills, counters->evictions,
+                       counters->back_invalidations, counters->victim_fills, counters->promotions, counters->copies);
+            }
+            for (int c = 0; sectors > 1 && c < nb_caches; c++) {
+                const cache_sector_counters_t* counters = &caches[c]->sectors;
+                printf("%s: sector misses %" PRIu64 ", sector reads %" PRIu64 ", sector write-backs %" PRIu64 "\n", names[c],
+                       counters->misses, counters->reads, counters->writebacks);
+            }
+            if (nb_parts > 0) assert(partition_print(stdout, names[2], &part) == ERR_NONE);
+            if (timed) assert(timing_print(stdout, &timing) == ERR_NONE);
+            for (int c = 0; mshr_size > 0 && c < 2; c++) {
+                const mshr_counters_t* counters = &mshrs[c].counters;
+                uint64_t drain = mshr_drain(&mshrs[c], timing_cycles(&timing));
+                printf("%s MSHRs: primary misses %" PRIu64 ", secondary misses %" PRIu64 ", stalls %" PRIu64 ", stall cycles %" PRIu64
+                       ", peak %" PRIu32 ", MLP %.2f, drain cycles %" PRIu64 "\n", names[c], counters->primary, counters->secondary,
+                       counters->stalls, counters->stall_cycles, counters->peak, mshr_mlp(&mshrs[c]), drain);
+            }
+            if (wbuf_size > 0) {
+                (void) write_buffer_drain(mem_space, &wbuf);
+                write_buffer_free(&wbuf);
+            }
+            cache_free(&l1_icache);
+            cache_free(&l1_dcache);
+            cache_free(&l2_cache);
+            if (l3_lines > 0) cache_free(&l3_cache);
+            for (int v = 0; victim_entries > 0 && v < 2; v++) cache_victim_free(&victims[v]);
+            for (size_t c = 1; c <= nb_others; c++) {
+                cache_free(&icaches[c]);
+                cache_free(&dcaches[c]);
+                (void) program_free(&programs[c]);
             }
+            if (nb_others > 0) multicore_free(&mc);
         } else {
             error(argv[0], "problem initializing program from provided file.");
             return 3;
@@ -20,6 +20,8 @@
 #include "tlb_hrchy_mng.h"
 
 #include <inttypes.h> // for PRIx macros
+#include <string.h> // for strcmp()
+#include <stdlib.h> // for strtoul()
 
 // --------------------------------------------------
 #define print_all_tlb_entries(tlb, TYPE, N)                                      \
@@ -38,6 +40,21 @@
                 );                                                               \
         }} while(0)
 
+// --------------------------------------------------
+#define print_all_hrchy_entries(hrchy, TLB_INDEX)                                \
+    do {                                                                         \
+        fputc('\n', f_out); fputc('\n', f_out);                                  \
+        size_t n_ = (size_t) (hrchy)->desc.tlb[TLB_INDEX].lines                  \
+                    * (hrchy)->desc.tlb[TLB_INDEX].ways;                         \
+        for (size_t i_ = 0; i_ < n_; i_++) {                                     \
+            const tlb_hrchy_entry_t* e_ = (hrchy)->tlb[TLB_INDEX] + i_;          \
+            if (e_->v)                                                           \
+                fprintf(f_out, "%d; %08" PRIX64 "; %05X;\n",                     \
+                        e_->v, (uint64_t) e_->tag, e_->phy_page_num);            \
+            else                                                                 \
+                fprintf(f_out, "%d; --------; -----;\n", e_->v);                 \
+        }} while(0)
+
 // ======================================================================
 static void usage()
 {
@@ -45,6 +62,36 @@ static void usage()
     fputs("\t- one (txt) to read commands from;\n", stderr);
     fputs("\t- one (bin) to memory content from;\n", stderr);
     fputs("\t- one to write output to.\n", stderr);
+    fputs("and optionally \"desc\" to use a hierarchy configured at runtime,\n", stderr);
+    fputs("followed by lines and ways of L1 ITLB, L1 DTLB and L2 TLB (e.g. desc 16 1 16 1 64 1)\n", stderr);
+    fputs("the inclusion policy (inclusive, exclusive or nine),\n", stderr);
+    fputs("and lines and ways of further shared levels (e.g. 512 4 for an L3 TLB).\n", stderr);
+}
+
+// ======================================================================
+/**
+ * @brief read the geometry of a runtime hierarchy from the command line
+ */
+static int read_desc(int argc, char* argv[], tlb_hrchy_desc_t* desc)
+{
+    int err = tlb_hrchy_desc_default(desc);
+    if (err != ERR_NONE || argc < 11) return err;
+    for (tlb_t t = L1_ITLB; t <= L2_TLB; t++) {
+        uint32_t lines = (uint32_t) strtoul(argv[5 + 2 * t], NULL, 10);
+        uint32_t ways  = (uint32_t) strtoul(argv[6 + 2 * t], NULL, 10);
+        if ((err = tlb_hrchy_desc_set(desc, t, lines, ways)) != ERR_NONE) return err;
+    }
+    if (argc < 12) return ERR_NONE;
+    if (!strcmp(argv[11], "inclusive"))      err = tlb_hrchy_desc_set_policy(desc, TLB_INCLUSIVE);
+    else if (!strcmp(argv[11], "exclusive")) err = tlb_hrchy_desc_set_policy(desc, TLB_EXCLUSIVE);
+    else if (!strcmp(argv[11], "nine"))      err = tlb_hrchy_desc_set_policy(desc, TLB_NINE);
+    else return ERR_POLICY;
+    for (int arg = 12; err == ERR_NONE && arg + 1 < argc; arg += 2) {
+        uint32_t lines = (uint32_t) strtoul(argv[arg], NULL, 10);
+        uint32_t ways  = (uint32_t) strtoul(argv[arg + 1], NULL, 10);
+        err = tlb_hrchy_desc_add(desc, (uint8_t) (desc->nb_levels + 1), TLB_SERVES_ALL, lines, ways);
+    }
+    return err;
 }
 
 // ======================================================================
@@ -84,6 +131,58 @@ int main(int argc, char* argv[])
      *  -- 16 lines for L1, 64 lines for L2
      */
 
+    if (argc > 4 && !strcmp(argv[4], "desc")) {
+        tlb_hrchy_desc_t desc;
+        tlb_hrchy_t hrchy;
+        if (read_desc(argc, argv, &desc) != ERR_NONE || tlb_hrchy_init(&hrchy, &desc) != ERR_NONE) {
+            usage();
+            fclose(f_out);
+            free(mem_space);
+            program_free(&pgm);
+            return 5;
+        }
+        tlb_stats_t stats;
+        tlb_stats_init(&stats, NULL, STATS_JSON, 0);
+        tlb_hrchy_stats_attach(&hrchy, &stats);
+        timing_latencies_t latencies;
+        timing_t timing;
+        timing_latencies_default(&latencies);
+        timing_init(&timing, &latencies);
+        tlb_hrchy_timing_attach(&hrchy, &timing);
+        phy_addr_t paddr;
+        zero_init_var(paddr);
+        for (size_t prog_line_index = 0; prog_line_index < pgm.nb_lines; prog_line_index++) {
+            int hit = 0;
+            mem_access_t access = pgm.listing[prog_line_index].type == DATA ? DATA : INSTRUCTION;
+            fprintf(f_out, "\n" SIZE_T_FMT ": DATA/INSTRUCTION = %d\n", prog_line_index, access);
+            tlb_hrchy_search(mem_space, &(pgm.listing[prog_line_index].vaddr), &paddr, access, &hrchy, &hit);
+
+            fprintf(f_out, "-------------------------------------------------------------------\n");
+            fprintf(f_out, "After program line " SIZE_T_FMT "...\n\n", prog_line_index);
+            fprintf(f_out, "VA = ");
+            print_virtual_address(f_out, &(pgm.listing[prog_line_index].vaddr));
+            fprintf(f_out, "; PA  = ");
+            print_physical_address(f_out, &paddr);
+            fprintf(f_out, "\n\n");
+            if (hit) fprintf(f_out, "HIT...\n\n");
+            else fprintf(f_out, "MISS...\n\n");
+
+            for (size_t t = 0; t < hrchy.desc.nb_tlbs; t++) {
+                fprintf(f_out, "\n\n%s:", hrchy.desc.tlb[t].name);
+                print_all_hrchy_entries(&hrchy, t);
+            }
+            fprintf(f_out, "-------------------------------------------------------------------\n");
+        }
+        tlb_hrchy_policy_stats_print(stderr, &hrchy);
+        tlb_stats_export(stderr, &stats, STATS_JSON, 1);
+        timing_print(stderr, &timing);
+        tlb_hrchy_free(&hrchy);
+        fclose(f_out);
+        free(mem_space);
+        program_free(&pgm);
+        return EXIT_SUCCESS;
+    }
+
     l1_itlb_entry_t l1_itlb[L1_ITLB_LINES];
     l1_dtlb_entry_t l1_dtlb[L1_DTLB_LINES];
     l2_tlb_entry_t l2_tlb[L2_TLB_LINES];
@@ -21,6 +21,8 @@
 #include "tlb_mng.h"
 
 #include <inttypes.h> // for PRIx macros
+#include <string.h> // for strcmp()
+#include <stdlib.h> // for strtoull()
 
 int main(int argc, char* argv[])
 {
@@ -29,9 +31,27 @@ int main(int argc, char* argv[])
         fprintf(stderr, "\t- one (txt) to read commands from;\n");
         fprintf(stderr, "\t- one (bin) to memory content from;\n");
         fprintf(stderr, "\t- one to write output to.\n");
+        fprintf(stderr, "and optionally \"simd\" to look tags up through the tag store,\n");
+        fprintf(stderr, "\"stats=json\" or \"stats=csv\" to choose the format of the statistics (csv by default)\n");
+        fprintf(stderr, "and \"period=N\" to also export them every N accesses.\n");
         return 1;
     }
 
+    // optional arguments after the 3 filenames
+    int simd = 0;
+    stats_format_t format = STATS_CSV;
+    uint64_t period = 0;
+    for (int arg = 4; arg < argc; arg++) {
+        if (!strcmp(argv[arg], "simd")) simd = 1;
+        else if (!strcmp(argv[arg], "stats=json")) format = STATS_JSON;
+        else if (!strcmp(argv[arg], "stats=csv")) format = STATS_CSV;
+        else if (!strncmp(argv[arg], "period=", 7)) period = strtoull(argv[arg] + 7, NULL, 0);
+        else {
+            fprintf(stderr, "Unknown option \"%s\".", argv[arg]);
+            return 1;
+        }
+    }
+
     program_t pgm;
     if (program_read(argv[1], &pgm) != ERR_NONE) {
         fprintf(stderr, "Cannot open \"%s\" for reading commands.", argv[1]);
@@ -74,6 +94,28 @@ int main(int argc, char* argv[])
         .push_back      = push_back
     };
 
+    // periodic exports go to stderr, before the export of the end of the run
+    tlb_stats_t stats;
+    tlb_stats_init(&stats, stderr, format, period);
+    for (size_t t = STATS_L1_ITLB; t <= STATS_L2_TLB; t++) tlb_stats_name(&stats, t, NULL); // only the TLB of tlb.h is used
+    replacement_policy.stats = &stats;
+
+    timing_latencies_t latencies;
+    timing_t timing;
+    timing_latencies_default(&latencies);
+    timing_init(&timing, &latencies);
+    replacement_policy.timing = &timing;
+
+    // "simd": look tags up through the tag store
+    tlb_tags_t tags;
+    if (simd) {
+        if (tlb_tags_init(&tags, tlb, &ll) != ERR_NONE) {
+            fprintf(stderr, "Cannot initialize the tag store.");
+            return 5;
+        }
+        replacement_policy.tags = &tags;
+    }
+
     phy_addr_t paddr;
     zero_init_var(paddr);
 
@@ -106,6 +148,9 @@ int main(int argc, char* argv[])
         fprintf(f_out, "-------------------------------------------------------------------\n");
     }
 
+    tlb_stats_export(stderr, &stats, format, !stats.header_printed);
+    timing_print(stderr, &timing);
+
     /**
      * Garbage collecting
      */
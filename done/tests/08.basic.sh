@@ -22,12 +22,19 @@ check_output_with_file() {
     refoutput="${ref}/$4"
     [ -f "$refoutput" ] || error "Expected output file \"$refoutput\" not found."
     
+    referror=''
+    if [ -n "${6:-}" ]; then
+        referror="${ref}/$6"
+        [ -f "$referror" ] || error "Expected error output file \"$referror\" not found."
+    fi
+
     mytmp1="$(new_tmp_file)"
     mytmp2="$(new_tmp_file)"
-    "$1" "$cmdfile" "$memfile" "$mytmp1" 2>"$mytmp2"
-    # we don't do anything with stderr yet, but may be useful sometime
+    "$1" "$cmdfile" "$memfile" "$mytmp1" ${5:-} 2>"$mytmp2"
+    # the statistics go to stderr : only compared when a reference is given
 
     diff -w "$mytmp1" "$refoutput" \
+        && ([ -z "$referror" ] || diff -w "$mytmp2" "$referror") \
         && echo "PASS" \
         || (echo "FAIL"; \
             exit 1)
@@ -38,5 +45,20 @@ check_output_with_file() {
 printf "Test %1d (test-tlb_simple 1): " $((++test))
 check_output_with_file test-tlb_simple commands02.txt memory-dump-01.mem output/tlb-simple-01-out.txt
 
+printf "Test %1d (test-tlb_simple 2, tag store): " $((++test))
+check_output_with_file test-tlb_simple commands02.txt memory-dump-01.mem output/tlb-simple-01-out.txt simd
+
+printf "Test %1d (test-tlb_simple 3, CSV statistics): " $((++test))
+check_output_with_file test-tlb_simple commands02.txt memory-dump-01.mem output/tlb-simple-01-out.txt "stats=csv" output/tlb-simple-01-csv.txt
+
+printf "Test %1d (test-tlb_simple 4, JSON statistics): " $((++test))
+check_output_with_file test-tlb_simple commands02.txt memory-dump-01.mem output/tlb-simple-01-out.txt "stats=json" output/tlb-simple-01-json.txt
+
+printf "Test %1d (test-tlb_simple 5, periodic CSV statistics): " $((++test))
+check_output_with_file test-tlb_simple commands02.txt memory-dump-01.mem output/tlb-simple-01-out.txt "stats=csv period=5" output/tlb-simple-01-csv-5.txt
+
+printf "Test %1d (test-tlb_simple 6, periodic JSON statistics): " $((++test))
+check_output_with_file test-tlb_simple commands02.txt memory-dump-01.mem output/tlb-simple-01-out.txt "simd stats=json period=5" output/tlb-simple-01-json-5.txt
+
 # ======================================================================
 echo "SUCCESS"
@@ -22,12 +22,19 @@ check_output_with_file() {
     refoutput="${ref}/$4"
     [ -f "$refoutput" ] || error "Expected output file \"$refoutput\" not found."
     
+    referror=''
+    if [ -n "${6:-}" ]; then
+        referror="${ref}/$6"
+        [ -f "$referror" ] || error "Expected error output file \"$referror\" not found."
+    fi
+
     mytmp1="$(new_tmp_file)"
     mytmp2="$(new_tmp_file)"
-    "$1" "$cmdfile" "$memfile" "$mytmp1" 2>"$mytmp2"
-    # we don't do anything with stderr yet, but may be useful sometime
+    "$1" "$cmdfile" "$memfile" "$mytmp1" ${5:-} 2>"$mytmp2"
+    # the statistics go to stderr : only compared when a reference is given
 
     diff -w "$mytmp1" "$refoutput" \
+        && ([ -z "$referror" ] || diff -w "$mytmp2" "$referror") \
         && echo "PASS" \
         || (echo "FAIL"; \
             exit 1)
@@ -38,5 +45,20 @@ check_output_with_file() {
 printf "Test %1d (test-tlb_hrchy 1): " $((++test))
 check_output_with_file test-tlb_hrchy commands02.txt memory-dump-01.mem output/tlb-hrchy-01-out.txt
 
+printf "Test %1d (test-tlb_hrchy 2, runtime geometry): " $((++test))
+check_output_with_file test-tlb_hrchy commands02.txt memory-dump-01.mem output/tlb-hrchy-01-out.txt "desc 16 1 16 1 64 1"
+
+printf "Test %1d (test-tlb_hrchy 3, exclusive): " $((++test))
+check_output_with_file test-tlb_hrchy commands08.txt memory-dump-01.mem output/tlb-hrchy-02-out.txt "desc 1 1 1 1 1 4 exclusive" output/tlb-hrchy-02-err.txt
+
+printf "Test %1d (test-tlb_hrchy 4, non-inclusive non-exclusive): " $((++test))
+check_output_with_file test-tlb_hrchy commands08.txt memory-dump-01.mem output/tlb-hrchy-03-out.txt "desc 1 1 1 1 1 3 nine" output/tlb-hrchy-03-err.txt
+
+printf "Test %1d (test-tlb_hrchy 5, L3 TLB): " $((++test))
+check_output_with_file test-tlb_hrchy commands02.txt memory-dump-01.mem output/tlb-hrchy-04-out.txt "desc 16 1 16 1 64 1 inclusive 512 4" output/tlb-hrchy-04-err.txt
+
+printf "Test %1d (test-tlb_hrchy 6, exclusive L3 TLB): " $((++test))
+check_output_with_file test-tlb_hrchy commands08.txt memory-dump-01.mem output/tlb-hrchy-05-out.txt "desc 1 1 1 1 1 1 exclusive 1 4" output/tlb-hrchy-05-err.txt
+
 # ======================================================================
 echo "SUCCESS"
@@ -24,7 +24,7 @@ check_output_with_file() {
     
     mytmp="$(new_tmp_file)"
     # gets stdout in case of success, stderr in case of error
-    ACTUAL_OUTPUT="$("$1" "$2" "$memfile" "$cmdfile" 2>"$mytmp" || cat "$mytmp")"
+    ACTUAL_OUTPUT="$("$1" "$2" "$memfile" "$cmdfile" ${6:-} 2>"$mytmp" || cat "$mytmp")"
 
     diff -w <(echo "$ACTUAL_OUTPUT") <(cat "$refoutput") \
         && echo "PASS" \
@@ -37,5 +37,97 @@ check_output_with_file() {
 printf "Test %1d (test-cache 1): " $((++test))
 check_output_with_file test-cache dump memory-dump-01.mem commands01.txt output/cache-01-out.txt
 
+# ======================================================================
+# same commands with a geometry given at runtime (generic code)
+printf "Test %1d (test-cache 2): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands01.txt output/cache-02-out.txt "16 2 64 4 32"
+
+# ======================================================================
+# highly associative caches : sets probed by the SIMD kernels (best one of the host, SSE2, scalar)
+for level in "" sse2 scalar; do
+    printf "Test %1d (test-cache 3 ${level}): " $((++test))
+    check_output_with_file test-cache dump memory-dump-01.mem commands01.txt output/cache-03-out.txt "4 32 8 64 16 $level"
+done
+
+# ======================================================================
+# write-back caches : same contents, memory written only when dirty lines leave the hierarchy
+printf "Test %1d (test-cache 4): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands01.txt output/cache-04-out.txt "16 2 64 4 32 writeback traffic"
+
+# ======================================================================
+# streaming stores : no-write-allocate (no line fills) and a coalescing write buffer (merged stores)
+printf "Test %1d (test-cache 5): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands04.txt output/cache-05-out.txt "16 2 64 4 32 noallocate wbuf2 traffic"
+
+# ======================================================================
+# replacement policies, on small caches with many conflicts
+for policy in lru tree-plru bit-plru fifo random srrip brrip lfu; do
+    printf "Test %1d (test-cache 6 ${policy}): " $((++test))
+    check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-06-${policy}-out.txt "2 2 4 2 16 $policy traffic"
+done
+
+# ======================================================================
+# three levels : the lines evicted from L2 spill into L3 instead of leaving the hierarchy
+printf "Test %1d (test-cache 7): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-07-out.txt "2 2 4 2 16 l3=8,4 writeback traffic"
+
+# ======================================================================
+# three C's : misses classified against a fully associative LRU cache of the same capacity
+printf "Test %1d (test-cache 8): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-08-out.txt "2 2 4 2 16 classify"
+
+# ======================================================================
+# prefetching : a stream of lines detected in L1 DCACHE and prefetched into L2 (V: 2 until used)
+printf "Test %1d (test-cache 9): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands06.txt output/cache-09-out.txt "2 2 4 2 16 prefetch=stream,2,1 traffic"
+
+# ======================================================================
+# timing model : cycles, average memory access time and histogram of the latencies of each type of access
+printf "Test %1d (test-cache 10): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-10-out.txt "2 2 4 2 16 l3=8,4 timing"
+
+# ======================================================================
+# two cores with private L1s and a shared L2 : MESI snooping (dirty copies cleaned, copies of other cores invalidated)
+printf "Test %1d (test-cache 11): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-11-out.txt "2 2 4 2 16 writeback traffic core=tests/files/commands07.txt quantum=2"
+
+# ======================================================================
+# block accesses : 40 bytes per command, split at the line boundaries (one lookup per line)
+printf "Test %1d (test-cache 12): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-12-out.txt "2 2 4 2 16 block=40 traffic"
+
+# ======================================================================
+# victim caches : the lines evicted from the direct-mapped L1s kept in 4 entries, swapped back on a hit
+printf "Test %1d (test-cache 13): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-13-out.txt "2 1 4 2 16 victim=4 writeback traffic timing"
+
+# ======================================================================
+# inclusive hierarchy : the lines evicted from the direct-mapped L2 are invalidated in L1 DCACHE, the L3 hits copied up
+printf "Test %1d (test-cache 14): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-14-out.txt "2 2 4 1 16 l3=16,4 writeback traffic inclusive"
+
+# ======================================================================
+# checkpoints : the warm state saved after 8 commands, then restored to execute the following ones only
+ckpt="$(new_tmp_file)"
+printf "Test %1d (test-cache 15): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-15-out.txt "2 2 4 2 16 l3=8,4 writeback traffic timing checkpoint=$ckpt,8"
+printf "Test %1d (test-cache 16): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-16-out.txt "2 2 4 2 16 l3=8,4 writeback traffic timing restore=$ckpt"
+
+# ======================================================================
+# sectored lines : 128 bytes lines of 4 sectors, a miss reading only the sector accessed, the other ones read when first accessed
+printf "Test %1d (test-cache 17): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-17-out.txt "2 1 2 2 128 sectors=4 writeback traffic"
+
+# ======================================================================
+# non-blocking L1s : 4 MSHRs, misses overlapping and merging, stalling when the MSHRs are all busy
+printf "Test %1d (test-cache 18): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-18-out.txt "2 2 4 2 16 timing mshr=4"
+
+# ======================================================================
+# way partitioning of the shared L2 : the fills of core 0 take way 0 only, the ones of core 1 ways 1 to 3
+printf "Test %1d (test-cache 19): " $((++test))
+check_output_with_file test-cache dump memory-dump-01.mem commands05.txt output/cache-19-out.txt "2 2 4 4 16 writeback traffic core=tests/files/commands07.txt quantum=2 partition=0,0,1 partition=1,1,3"
+
 # ======================================================================
 echo "SUCCESS"
@@ -0,0 +1,105 @@
+/**
+ * @file timing.c
+ * @brief timing model : a latency in cycles for each TLB level, memory reference of
+ *        a page walk, cache level and DRAM, and the cycles spent by each type of access
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "timing.h"
+#include "error.h"
+#include <inttypes.h> // for PRIu64
+#include <string.h>
+
+//=========================================================================
+int timing_latencies_default(timing_latencies_t * latencies){
+	M_REQUIRE_NON_NULL(latencies);
+	static const timing_latencies_t DEFAULT = {
+		.tlb = { 1, 7, 20, 30, 40, 50, 60, 70 },
+		.walk_ref = 30, // the page table entries mostly come from the caches
+		.cache = { 4, 12, 40, 60 },
+		.victim = 1, // a few entries, next to the L1
+		.dram = 200
+		};
+	*latencies = DEFAULT;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int timing_init(timing_t * timing, const timing_latencies_t * latencies){
+	M_REQUIRE_NON_NULL(timing);
+	M_REQUIRE_NON_NULL(latencies);
+	memset(timing, 0, sizeof(timing_t));
+	timing->latencies = *latencies;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+void timing_record(timing_t * timing, timing_access_t access, uint64_t cycles){
+	timing_record_overlapped(timing, access, cycles, cycles);
+	}
+
+//=========================================================================
+void timing_record_overlapped(timing_t * timing, timing_access_t access, uint64_t cycles, uint64_t busy){
+	timing->clock += busy;
+	timing_counters_t* counters = &timing->counters[access];
+	counters->accesses++;
+	counters->cycles += cycles;
+	uint32_t bucket = 0;
+	while (cycles > 0 && bucket < TIMING_HISTO_BUCKETS - 1){ // bucket b >= 1 : 2^(b-1) <= cycles < 2^b
+		cycles >>= 1;
+		bucket++;
+		}
+	counters->histogram[bucket]++;
+	}
+
+//=========================================================================
+uint64_t timing_tlb_cycles(const timing_t * timing, size_t looked_up, bool walked){
+	uint64_t cycles = 0;
+	for (size_t level = 0; level < looked_up && level < TIMING_MAX_TLBS; level++) cycles += timing->latencies.tlb[level];
+	if (walked) cycles += (uint64_t) TIMING_WALK_REFS * timing->latencies.walk_ref;
+	return cycles;
+	}
+
+//=========================================================================
+uint64_t timing_cache_cycles(const timing_t * timing, size_t level, size_t levels){
+	uint64_t cycles = 0;
+	for (size_t l = 0; l <= level && l < levels && l < CACHE_MAX_LEVELS; l++) cycles += timing->latencies.cache[l];
+	if (level >= levels) cycles += timing->latencies.dram;
+	return cycles;
+	}
+
+//=========================================================================
+uint64_t timing_cycles(const timing_t * timing){
+	return timing->clock;
+	}
+
+//=========================================================================
+double timing_average(const timing_t * timing, timing_access_t access){
+	const timing_counters_t* counters = &timing->counters[access];
+	return counters->accesses == 0 ? 0.0 : (double) counters->cycles / (double) counters->accesses;
+	}
+
+//=========================================================================
+int timing_print(FILE * output, const timing_t * timing){
+	M_REQUIRE_NON_NULL(output);
+	M_REQUIRE_NON_NULL(timing);
+	static const char* const NAMES[TIMING_ACCESS_NB] = { "translation", "fetch", "read", "write" };
+	for (timing_access_t access = TIMING_TRANSLATION; access < TIMING_ACCESS_NB; access++){
+		const timing_counters_t* counters = &timing->counters[access];
+		if (counters->accesses == 0) continue;
+		fprintf(output, "%s: accesses %" PRIu64 ", cycles %" PRIu64 ", average %.2f, histogram", NAMES[access],
+		        counters->accesses, counters->cycles, timing_average(timing, access));
+		for (uint32_t bucket = 0; bucket < TIMING_HISTO_BUCKETS; bucket++){
+			if (counters->histogram[bucket] == 0) continue;
+			if (bucket <= 1) fprintf(output, " [%u]", bucket);
+			else if (bucket == TIMING_HISTO_BUCKETS - 1) fprintf(output, " [%u+]", 1u << (bucket - 1));
+			else fprintf(output, " [%u-%u]", 1u << (bucket - 1), (1u << bucket) - 1);
+			fprintf(output, " %" PRIu64, counters->histogram[bucket]);
+			}
+		fputc('\n', output);
+		}
+	fprintf(output, "total cycles: %" PRIu64 "\n", timing_cycles(timing));
+	return ERR_NONE;
+	}
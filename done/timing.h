@@ -0,0 +1,165 @@
+#pragma once
+
+/**
+ * @file timing.h
+ * @brief timing model : a latency in cycles for each TLB level, memory reference of
+ *        a page walk, cache level and DRAM, and the cycles spent by each type of access
+ *        (total, average memory access time and histogram of the latencies)
+ *
+ * A timing model is attached to the TLBs (see tlb_mng.h, tlb_hrchy_mng.h) and to the
+ * L1 caches (see cache_set_timing()), each access they serve being then charged the
+ * latencies of the levels it went through.
+ * The clock of the model is the cycle at which the next access issues : each access holds
+ * the processor for its whole latency, except the ones served by a non-blocking L1 (see
+ * mshr.h) which overlap with the next accesses.
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h"     // for CACHE_MAX_LEVELS
+#include "tlb_stats.h" // for TLB_STATS_MAX
+#include <stdio.h>     // for FILE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>    // for size_t
+
+#define TIMING_MAX_TLBS TLB_STATS_MAX // TLB levels, at most
+#define TIMING_WALK_REFS 4u           // memory references of a page walk (PGD, PUD, PMD, PTE)
+#define TIMING_HISTO_BUCKETS 16u      // bucket 0 : 0 cycle, bucket b : [2^(b-1), 2^b[ cycles, the last one being open
+
+/*
+ * types of accesses timed
+ */
+typedef enum {
+	TIMING_TRANSLATION, TIMING_FETCH, TIMING_READ, TIMING_WRITE
+	} timing_access_t;
+
+#define TIMING_ACCESS_NB (TIMING_WRITE + 1)
+
+/*
+ * Latencies, in cycles :
+ *  - tlb      : lookup of each TLB level (0 : L1 TLB), in the order an access looks them up
+ *  - walk_ref : each memory reference of a page walk
+ *  - cache    : lookup of each cache level (0 : L1)
+ *  - victim   : lookup of the victim cache of an L1, after the L1 (see cache_set_victim())
+ *  - dram     : a line read from (or a word written to) memory
+ */
+typedef struct {
+	uint32_t tlb[TIMING_MAX_TLBS];
+	uint32_t walk_ref;
+	uint32_t cache[CACHE_MAX_LEVELS];
+	uint32_t victim;
+	uint32_t dram;
+	} timing_latencies_t;
+
+/*
+ * Time spent by one type of access :
+ *  - accesses  : accesses timed
+ *  - cycles    : their latencies, summed
+ *  - histogram : accesses by latency (see TIMING_HISTO_BUCKETS)
+ */
+typedef struct {
+	uint64_t accesses;
+	uint64_t cycles;
+	uint64_t histogram[TIMING_HISTO_BUCKETS];
+	} timing_counters_t;
+
+/*
+ * Timing model :
+ *  - latencies : of each component
+ *  - counters  : one set per type of access
+ *  - clock     : cycle at which the next access issues, the execution time so far
+ *                (the cycles of all the accesses, summed, if none overlapped)
+ */
+typedef struct timing {
+	timing_latencies_t latencies;
+	timing_counters_t counters[TIMING_ACCESS_NB];
+	uint64_t clock;
+	} timing_t;
+
+/**
+ * @brief charge an access, if timing is enabled (timing non NULL)
+ */
+#define timing_count(timing, ACCESS, CYCLES) \
+	do { if ((timing) != NULL) timing_record(timing, ACCESS, CYCLES); } while (0)
+
+//=========================================================================
+/**
+ * @brief Default latencies (orders of magnitude of a desktop processor).
+ * @param latencies the latencies to initialize
+ * @return error code
+ */
+int timing_latencies_default(timing_latencies_t * latencies);
+
+//=========================================================================
+/**
+ * @brief Initialize (reset) a timing model.
+ * @param timing the timing model to initialize
+ * @param latencies its latencies (copied)
+ * @return error code
+ */
+int timing_init(timing_t * timing, const timing_latencies_t * latencies);
+
+//=========================================================================
+/**
+ * @brief Charge an access, which holds the processor for its whole latency.
+ * @param timing the timing model
+ * @param access type of the access
+ * @param cycles its latency
+ */
+void timing_record(timing_t * timing, timing_access_t access, uint64_t cycles);
+
+//=========================================================================
+/**
+ * @brief Charge an access overlapping with the next ones (non-blocking cache).
+ * @param timing the timing model
+ * @param access type of the access
+ * @param cycles its latency
+ * @param busy the cycles it holds the processor, before the next access issues
+ */
+void timing_record_overlapped(timing_t * timing, timing_access_t access, uint64_t cycles, uint64_t busy);
+
+//=========================================================================
+/**
+ * @brief Latency of a translation.
+ * @param timing the timing model
+ * @param looked_up number of TLB levels looked up
+ * @param walked whether a page walk was needed
+ * @return cycles
+ */
+uint64_t timing_tlb_cycles(const timing_t * timing, size_t looked_up, bool walked);
+
+//=========================================================================
+/**
+ * @brief Latency of a cache access.
+ * @param timing the timing model
+ * @param level level where the line was found (levels : in memory)
+ * @param levels number of levels of the hierarchy
+ * @return cycles
+ */
+uint64_t timing_cache_cycles(const timing_t * timing, size_t level, size_t levels);
+
+//=========================================================================
+/**
+ * @brief The clock of the model : the cycle at which the next access issues (see mshr.h).
+ * @param timing the timing model
+ * @return cycles
+ */
+uint64_t timing_cycles(const timing_t * timing);
+
+//=========================================================================
+/**
+ * @brief Average latency of a type of access (average memory access time), 0 if none.
+ */
+double timing_average(const timing_t * timing, timing_access_t access);
+
+//=========================================================================
+/**
+ * @brief Print the cycles, average and histogram of each type of access
+ *        (the types never timed are skipped), then the total cycles (the clock).
+ * @param output the stream to print to
+ * @param timing the timing model
+ * @return error code
+ */
+int timing_print(FILE * output, const timing_t * timing);
@@ -2,16 +2,24 @@
 
 /**
  * @file tlb_hrchy.h
- * @brief definitions associated to a two-level hierarchy of TLBs
+ * @brief definitions associated to a hierarchy of TLBs
  *
  * @author Mirjana Stojilovic
  * @date 2018-19
  */
 
 #include "addr.h"
+#include "tlb_stats.h"
+#include "timing.h"
+#include "mem_access.h"
 
 #include <stdint.h>
 
+/*
+ * Fixed configuration, used by the l1_itlb_entry_t/l1_dtlb_entry_t/l2_tlb_entry_t
+ * based functions. A hierarchy with another geometry is described at runtime
+ * by a tlb_hrchy_desc_t (see below).
+ */
 #define L1_ITLB_WAYS    1   // Direct mapped
 // Do not modify the number of lines.
 // It directly affects the tag field size.
@@ -58,3 +66,114 @@ typedef struct {
 typedef enum {
 	L1_ITLB, L1_DTLB, L2_TLB
 	} tlb_t;
+
+#define TLB_HRCHY_NB (L2_TLB + 1) // number of TLBs in the fixed hierarchy
+#define TLB_HRCHY_MAX TLB_STATS_MAX // maximum number of TLBs (all levels together) in a runtime hierarchy
+#define TLB_HRCHY_ACCESS_NB (DATA + 1) // number of access types (mem_access_t)
+#define TLB_NAME_LEN 12 // e.g. "L1_ITLB", "L3_TLB"
+
+/*
+ * Access types served by a TLB, as a mask of mem_access_t
+ */
+#define TLB_SERVES(access) ((uint8_t) (1 << (access)))
+#define TLB_SERVES_ALL (TLB_SERVES(INSTRUCTION) | TLB_SERVES(DATA))
+
+/*
+ * One TLB of a hierarchy configured at runtime :
+ *  - lines      : number of sets (power of 2)
+ *  - ways       : associativity (1 = direct mapped)
+ *  - lines_bits : log_2(lines), derived
+ *  - tag_bits   : VIRT_PAGE_NUM - lines_bits, derived
+ *  - level      : its level in the hierarchy (1 = looked up first)
+ *  - serves     : the access types it translates (TLB_SERVES mask)
+ *  - name       : its name in dumps and statistics, derived (e.g. "L1_ITLB", "L3_TLB")
+ */
+typedef struct {
+	uint32_t lines;
+	uint32_t ways;
+	uint8_t lines_bits;
+	uint8_t tag_bits;
+	uint8_t level;
+	uint8_t serves;
+	char name[TLB_NAME_LEN];
+	} tlb_geometry_t;
+
+/*
+ * Inclusion policy between the levels of a hierarchy :
+ *  - TLB_INCLUSIVE : a page walk fills every level; an entry evicted from a level
+ *                    is invalidated in all the levels above it (back-invalidation)
+ *  - TLB_EXCLUSIVE : a page walk fills L1 only; an entry evicted from a level is moved
+ *                    into the next one (victim fill); a hit below L1 moves the entry up into L1
+ *  - TLB_NINE      : non-inclusive non-exclusive, a page walk fills every level
+ *                    and the levels are never invalidated by each other
+ */
+typedef enum {
+	TLB_INCLUSIVE, TLB_EXCLUSIVE, TLB_NINE
+	} tlb_inclusion_t;
+
+/*
+ * Descriptor of a hierarchy of TLBs, as a table :
+ *  - tlb       : the TLBs, in any order (the fixed hierarchy uses the order of tlb_t)
+ *  - nb_tlbs   : number of TLBs of the table
+ *  - nb_levels : number of levels, derived
+ *  - path      : for each access type, the TLB serving it at each level, derived
+ *                (every level must have exactly one TLB serving each access type)
+ *  - policy    : the inclusion policy between levels
+ */
+typedef struct {
+	tlb_geometry_t tlb[TLB_HRCHY_MAX];
+	uint8_t nb_tlbs;
+	uint8_t nb_levels;
+	uint8_t path[TLB_HRCHY_ACCESS_NB][TLB_HRCHY_MAX];
+	tlb_inclusion_t policy;
+	} tlb_hrchy_desc_t;
+
+/*
+ * Counters of the events that depend on the inclusion policy :
+ *  - page_walks         : translations found in no TLB
+ *  - lower_fills        : entries written into a level below L1 (walk fills, refills or victim fills)
+ *  - lower_evictions    : valid entries replaced in a level below L1
+ *  - back_invalidations : entries invalidated because a lower level evicted them (inclusive)
+ *  - victim_fills       : victims moved into the next level (exclusive)
+ *  - promotions         : hits below L1 moved up into L1 and removed from their level (exclusive)
+ *  - duplicates         : copies of a victim already in the level it moves down to, left there by the
+ *                         other L1 and invalidated before the victim fills the level (exclusive)
+ */
+typedef struct {
+	uint64_t page_walks;
+	uint64_t lower_fills;
+	uint64_t lower_evictions;
+	uint64_t back_invalidations;
+	uint64_t victim_fills;
+	uint64_t promotions;
+	uint64_t duplicates;
+	} tlb_policy_stats_t;
+
+/*
+ * Entry of a TLB configured at runtime : the tag field is wide enough for any number of lines.
+ * age is used for LRU replacement among the ways of a set (0 = most recently used).
+ */
+typedef struct {
+	uint64_t tag : VIRT_PAGE_NUM;
+	uint32_t phy_page_num : PHY_PAGE_NUM;
+	uint8_t v : 1;
+	uint8_t age;
+	} tlb_hrchy_entry_t;
+
+/*
+ * Hierarchy of TLBs configured at runtime :
+ *  - desc         : its table of TLBs and inclusion policy
+ *  - fixed        : whether the table is the fixed configuration above (specialised code is then used)
+ *  - tlb          : entries of each TLB (lines * ways each, the ways of a set being contiguous)
+ *  - policy_stats : counters of the events of the inclusion policy
+ *  - stats        : optional per-TLB statistics (indexed as desc.tlb), NULL to not count
+ *  - timing       : optional timing model (translations charged the latencies of the levels looked up), NULL to not time
+ */
+typedef struct {
+	tlb_hrchy_desc_t desc;
+	uint8_t fixed;
+	tlb_hrchy_entry_t* tlb[TLB_HRCHY_MAX];
+	tlb_policy_stats_t policy_stats;
+	tlb_stats_t* stats;
+	timing_t* timing;
+	} tlb_hrchy_t;
@@ -309,3 +309,469 @@ int tlb_search( const void * mem_space,const virt_addr_t * vaddr, phy_addr_t * p
 		}
 		return ERR_NONE;
 		}
+
+//=========================================================================
+//================= TLB hierarchy with a runtime geometry =================
+//=========================================================================
+/**
+ * @brief helpers of the runtime hierarchy are forced inline so that the code
+ *        called with the fixed descriptor below is specialised by the compiler
+ *        (constant number of levels, lines and ways, no way loop for direct mapped TLBs)
+ */
+#define TLB_HRCHY_INLINE static inline __attribute__((always_inline))
+
+/**
+ * the fixed configuration of tlb_hrchy.h, as a descriptor
+ */
+#define fixed_geometry(TLB_TYPE, LEVEL, SERVES) \
+	{ TLB_TYPE ## _LINES, TLB_TYPE ## _WAYS, TLB_TYPE ## _LINES_BITS, VIRT_PAGE_NUM - TLB_TYPE ## _LINES_BITS, LEVEL, SERVES, #TLB_TYPE }
+static const tlb_hrchy_desc_t TLB_HRCHY_FIXED = {
+	.tlb = {
+		[L1_ITLB] = fixed_geometry(L1_ITLB, 1, TLB_SERVES(INSTRUCTION)),
+		[L1_DTLB] = fixed_geometry(L1_DTLB, 1, TLB_SERVES(DATA)),
+		[L2_TLB]  = fixed_geometry(L2_TLB,  2, TLB_SERVES_ALL)
+		},
+	.nb_tlbs = TLB_HRCHY_NB,
+	.nb_levels = 2,
+	.path = {
+		[INSTRUCTION] = { L1_ITLB, L2_TLB },
+		[DATA]        = { L1_DTLB, L2_TLB }
+		},
+	.policy = TLB_INCLUSIVE
+	};
+
+/**
+ * @brief pointer to the first way of the set at LINE of the TLB at index TLB_INDEX
+ */
+#define hrchy_set(hrchy, desc, tlb_index, line) \
+	((hrchy)->tlb[tlb_index] + (size_t)(line) * (desc)->tlb[tlb_index].ways)
+
+/**
+ * @brief check that tlb_index is the index of a TLB of the hierarchy
+ */
+#define valid_tlb_index(hrchy, tlb_index) ((tlb_index) < (hrchy)->desc.nb_tlbs)
+
+//=========================================================================
+/**
+ * @brief mark a way of a set as the most recently used one (LRU, as in lru.h) :
+ *        valid entries that were more recent than it get one step older
+ * @param set   : first way of the set
+ * @param ways  : number of ways of the set
+ * @param way   : the way that has been used
+ */
+TLB_HRCHY_INLINE void set_touch(tlb_hrchy_entry_t* set, uint32_t ways, uint32_t way){
+	if (ways == 1) return; //direct mapped, nothing to age
+	uint8_t age = set[way].age;
+	for (uint32_t w = 0; w < ways; w++){
+		if (w == way) set[w].age = 0;
+		else if (set[w].v && set[w].age < age) set[w].age++;
+		}
+	}
+
+/**
+ * @brief find the way of a set holding a valid entry with the given tag
+ * @return the way, or ways on miss
+ */
+TLB_HRCHY_INLINE uint32_t set_find(const tlb_hrchy_entry_t* set, uint32_t ways, uint64_t tag){
+	for (uint32_t w = 0; w < ways; w++){
+		if (set[w].v && set[w].tag == tag) return w;
+		}
+	return ways;
+	}
+
+/**
+ * @brief the way to replace in a set : the first invalid way, otherwise the least recently used one
+ */
+TLB_HRCHY_INLINE uint32_t set_victim(const tlb_hrchy_entry_t* set, uint32_t ways){
+	uint32_t victim = 0;
+	for (uint32_t w = 0; w < ways; w++){
+		if (!set[w].v) return w;
+		if (set[w].age > set[victim].age) victim = w;
+		}
+	return victim;
+	}
+
+//=========================================================================
+/**
+ * @brief look a virtual page number up in one TLB of the hierarchy
+ * @return HIT (paddr is then updated and the entry marked as most recently used) or MISS
+ */
+TLB_HRCHY_INLINE int hit_core(tlb_hrchy_t* hrchy, const tlb_hrchy_desc_t* desc, const virt_addr_t* vaddr,
+                              phy_addr_t* paddr, size_t tlb_index){
+	const tlb_geometry_t* geo = &desc->tlb[tlb_index];
+	uint64_t vpn = virt_addr_t_to_virtual_page_number(vaddr);
+	tlb_hrchy_entry_t* set = hrchy_set(hrchy, desc, tlb_index, vpn & (geo->lines - 1));
+	uint32_t way = set_find(set, geo->ways, vpn >> geo->lines_bits);
+	tlb_stats_count(hrchy->stats, tlb_index, lookups);
+	if (way == geo->ways){
+		tlb_stats_count(hrchy->stats, tlb_index, misses);
+		return MISS;
+		}
+	tlb_stats_count(hrchy->stats, tlb_index, hits);
+	if (init_phy_addr(paddr, set[way].phy_page_num << PAGE_OFFSET, vaddr->page_offset) != ERR_NONE) return MISS;
+	set_touch(set, geo->ways, way);
+	return HIT;
+	}
+
+/**
+ * @brief place a translation into one TLB of the hierarchy, replacing the LRU way of its set
+ * @param victim_vpn : (modified) virtual page number of the replaced entry, if it was valid
+ * @param victim_ppn : (modified) physical page number of the replaced entry, if it was valid
+ * @return whether a valid entry has been replaced
+ */
+TLB_HRCHY_INLINE bool fill_core(tlb_hrchy_t* hrchy, const tlb_hrchy_desc_t* desc, uint64_t vpn,
+                                uint32_t phy_page_num, size_t tlb_index, uint64_t* victim_vpn, uint32_t* victim_ppn){
+	const tlb_geometry_t* geo = &desc->tlb[tlb_index];
+	uint32_t line = vpn & (geo->lines - 1);
+	tlb_hrchy_entry_t* set = hrchy_set(hrchy, desc, tlb_index, line);
+	uint32_t way = set_victim(set, geo->ways);
+	bool evicted = set[way].v;
+	tlb_stats_count(hrchy->stats, tlb_index, fills);
+	if (evicted) tlb_stats_count(hrchy->stats, tlb_index, evictions);
+	*victim_vpn = ((uint64_t) set[way].tag << geo->lines_bits) | line;
+	*victim_ppn = set[way].phy_page_num;
+	set[way].tag = vpn >> geo->lines_bits;
+	set[way].phy_page_num = phy_page_num;
+	set[way].v = 1;
+	set[way].age = (uint8_t)(geo->ways - 1); //oldest, so that set_touch ages every other entry
+	set_touch(set, geo->ways, way);
+	return evicted;
+	}
+
+/**
+ * @brief invalidate the entry of a virtual page number in one TLB of the hierarchy, if any
+ * @return whether an entry has been invalidated
+ */
+TLB_HRCHY_INLINE bool invalidate_core(tlb_hrchy_t* hrchy, const tlb_hrchy_desc_t* desc, uint64_t vpn, size_t tlb_index){
+	const tlb_geometry_t* geo = &desc->tlb[tlb_index];
+	tlb_hrchy_entry_t* set = hrchy_set(hrchy, desc, tlb_index, vpn & (geo->lines - 1));
+	uint32_t way = set_find(set, geo->ways, vpn >> geo->lines_bits);
+	if (way == geo->ways) return false;
+	set[way].v = 0;
+	return true;
+	}
+
+/**
+ * @brief fill the TLB at position level of a lookup path, counting the fills
+ *        (and the evictions they cause) of the levels below L1
+ * @return whether a valid entry has been evicted
+ */
+TLB_HRCHY_INLINE bool fill_level(tlb_hrchy_t* hrchy, const tlb_hrchy_desc_t* desc, uint64_t vpn, uint32_t phy_page_num,
+                                 size_t tlb_index, uint8_t level, uint64_t* victim_vpn, uint32_t* victim_ppn){
+	bool evicted = fill_core(hrchy, desc, vpn, phy_page_num, tlb_index, victim_vpn, victim_ppn);
+	if (level > 0){
+		hrchy->policy_stats.lower_fills++;
+		if (evicted) hrchy->policy_stats.lower_evictions++;
+		}
+	return evicted;
+	}
+
+/**
+ * @brief search a translation in a hierarchy described by desc, following its inclusion policy.
+ *        The TLBs serving the access type are looked up level by level :
+ *        L1 hit    => done;
+ *        lower hit => refill every level above it (exclusive : only L1, the entry leaves its level);
+ *        miss      => page walk, refill every level (exclusive : only L1).
+ *        Levels are refilled from the lowest one up. Under the inclusive policy, the entries
+ *        evicted from a level are then invalidated in all the TLBs above it;
+ *        under the exclusive one, the entry evicted from L1 moves down from level to level
+ *        until a level has room for it, the victim of the last level being dropped.
+ */
+TLB_HRCHY_INLINE int search_core(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr, mem_access_t access,
+                                 tlb_hrchy_t* hrchy, const tlb_hrchy_desc_t* desc, int* hit_or_miss){
+	tlb_inclusion_t policy = hrchy->desc.policy;
+	tlb_policy_stats_t* policy_stats = &hrchy->policy_stats;
+	const uint8_t* path = desc->path[access];
+	uint8_t nb_levels = desc->nb_levels;
+
+	uint8_t level = 0; //position in path of the level that hit, nb_levels if none did
+	while (level < nb_levels && hit_core(hrchy, desc, vaddr, paddr, path[level]) == MISS) ++level;
+	*hit_or_miss = (level < nb_levels) ? HIT : MISS;
+	timing_count(hrchy->timing, TIMING_TRANSLATION, timing_tlb_cycles(hrchy->timing, level < nb_levels ? level + 1u : nb_levels, level == nb_levels));
+	if (level == 0) return ERR_NONE;
+
+	uint64_t vpn = virt_addr_t_to_virtual_page_number(vaddr);
+	if (level < nb_levels && policy == TLB_EXCLUSIVE){ //the entry moves up : it leaves its level
+		(void) invalidate_core(hrchy, desc, vpn, path[level]);
+		policy_stats->promotions++;
+		}
+	else if (level == nb_levels){ //found nowhere : page walk
+		int err = ERR_NONE;
+		if ((err = page_walk(mem_space, vaddr, paddr)) != ERR_NONE) return err;
+		policy_stats->page_walks++;
+		for (uint8_t l = 0; l < nb_levels; l++) tlb_stats_count(hrchy->stats, path[l], page_walks);
+		}
+
+	uint64_t victim_vpn[TLB_HRCHY_MAX];
+	uint32_t victim_ppn[TLB_HRCHY_MAX];
+	bool evicted[TLB_HRCHY_MAX];
+	uint8_t top = (policy == TLB_EXCLUSIVE) ? 1 : level; //number of levels to refill
+	for (uint8_t l = top; l-- > 0;){
+		evicted[l] = fill_level(hrchy, desc, vpn, paddr->phy_page_num, path[l], l, &victim_vpn[l], &victim_ppn[l]);
+		}
+
+	switch (policy){
+		case TLB_INCLUSIVE : //keep every level included in the levels below it
+			for (uint8_t l = 1; l < top; l++){
+				if (!evicted[l]) continue;
+				for (size_t t = 0; t < desc->nb_tlbs; t++){
+					if (desc->tlb[t].level <= l && invalidate_core(hrchy, desc, victim_vpn[l], t)){
+						policy_stats->back_invalidations++;
+						tlb_stats_count(hrchy->stats, t, invalidations);
+						}
+					}
+				}
+			break;
+		case TLB_EXCLUSIVE : //lower levels only hold what the levels above evicted
+			if (evicted[0]){
+				uint64_t moved_vpn = victim_vpn[0];
+				uint32_t moved_ppn = victim_ppn[0];
+				for (uint8_t l = 1; l < nb_levels; l++){
+					if (invalidate_core(hrchy, desc, moved_vpn, path[l])){ //another L1 may have left a copy there
+						policy_stats->duplicates++;
+						tlb_stats_count(hrchy->stats, path[l], invalidations);
+						}
+					policy_stats->victim_fills++;
+					if (!fill_level(hrchy, desc, moved_vpn, moved_ppn, path[l], l, &moved_vpn, &moved_ppn)) break;
+					}
+				}
+			break;
+		default : //TLB_NINE : evictions are silent and never invalidate another level
+			break;
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+/**
+ * @brief whether two TLBs of a table are the same (the other fields being derived)
+ */
+static bool geometry_equal(const tlb_geometry_t* a, const tlb_geometry_t* b){
+	return a->lines == b->lines && a->ways == b->ways && a->level == b->level && a->serves == b->serves;
+	}
+
+/**
+ * @brief check the table of a descriptor and derive its number of levels and lookup paths :
+ *        levels are numbered from 1 without gap, and each level has exactly
+ *        one TLB serving each access type
+ */
+static int desc_derive(tlb_hrchy_desc_t* desc){
+	M_REQUIRE(1 <= desc->nb_tlbs && desc->nb_tlbs <= TLB_HRCHY_MAX, ERR_SIZE, "a hierarchy has between 1 and %d TLBs", TLB_HRCHY_MAX);
+	desc->nb_levels = 0;
+	for (size_t t = 0; t < desc->nb_tlbs; t++){
+		const tlb_geometry_t* geo = &desc->tlb[t];
+		M_REQUIRE(geo->lines != 0 && geo->ways != 0, ERR_SIZE, "geometry of tlb %zu is not set", t);
+		M_REQUIRE(geo->lines <= SIZE_MAX / geo->ways / sizeof(tlb_hrchy_entry_t), ERR_SIZE, "tlb %zu is too large", t);
+		M_REQUIRE(1 <= geo->level && geo->level <= TLB_HRCHY_MAX, ERR_BAD_PARAMETER, "level of tlb %zu is not valid", t);
+		if (geo->level > desc->nb_levels) desc->nb_levels = geo->level;
+		}
+	for (int access = INSTRUCTION; access <= DATA; access++){
+		for (uint8_t l = 0; l < desc->nb_levels; l++){
+			size_t served = 0;
+			for (size_t t = 0; t < desc->nb_tlbs; t++){
+				if (desc->tlb[t].level == l + 1 && (desc->tlb[t].serves & TLB_SERVES(access))){
+					desc->path[access][l] = (uint8_t) t;
+					served++;
+					}
+				}
+			M_REQUIRE(served == 1, ERR_BAD_PARAMETER, "level %d must have exactly one TLB serving access type %d", l + 1, access);
+			}
+		}
+	return ERR_NONE;
+	}
+
+/**
+ * @brief set the geometry of one TLB of a table and derive its tag width
+ */
+static int geometry_set(tlb_geometry_t* geo, uint32_t lines, uint32_t ways){
+	M_REQUIRE(lines != 0 && (lines & (lines - 1)) == 0, ERR_SIZE, "number of lines (%"PRIu32") must be a power of 2", lines);
+	M_REQUIRE(1 <= ways && ways <= TLB_HRCHY_MAX_WAYS, ERR_SIZE, "number of ways (%"PRIu32") must be between 1 and %d", ways, TLB_HRCHY_MAX_WAYS);
+	uint8_t lines_bits = 0;
+	while (((uint32_t) 1 << lines_bits) < lines) ++lines_bits; //log_2(lines)
+	geo->lines = lines;
+	geo->ways = ways;
+	geo->lines_bits = lines_bits;
+	geo->tag_bits = (uint8_t)(VIRT_PAGE_NUM - lines_bits); //the tag is what remains of the virtual page number
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_desc_default(tlb_hrchy_desc_t * desc){
+	M_REQUIRE_NON_NULL(desc);
+	*desc = TLB_HRCHY_FIXED;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_desc_clear(tlb_hrchy_desc_t * desc){
+	M_REQUIRE_NON_NULL(desc);
+	memset(desc, 0, sizeof(tlb_hrchy_desc_t));
+	desc->policy = TLB_INCLUSIVE;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_desc_set_policy(tlb_hrchy_desc_t * desc, tlb_inclusion_t policy){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(TLB_INCLUSIVE <= policy && policy <= TLB_NINE, ERR_POLICY, "%d is not a valid inclusion policy", policy);
+	desc->policy = policy;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_desc_set(tlb_hrchy_desc_t * desc, size_t tlb_index, uint32_t lines, uint32_t ways){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(tlb_index < desc->nb_tlbs, ERR_BAD_PARAMETER, "%zu is not a valid tlb index \n", tlb_index);
+	return geometry_set(&desc->tlb[tlb_index], lines, ways);
+	}
+
+//=========================================================================
+int tlb_hrchy_desc_add(tlb_hrchy_desc_t * desc, uint8_t level, uint8_t serves, uint32_t lines, uint32_t ways){
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(desc->nb_tlbs < TLB_HRCHY_MAX, ERR_SIZE, "a hierarchy has at most %d TLBs", TLB_HRCHY_MAX);
+	M_REQUIRE(1 <= level && level <= TLB_HRCHY_MAX, ERR_BAD_PARAMETER, "level %d should be between 1 and %d", level, TLB_HRCHY_MAX);
+	M_REQUIRE(serves != 0 && (serves & ~TLB_SERVES_ALL) == 0, ERR_BAD_PARAMETER, "%d is not a valid mask of access types", serves);
+	tlb_geometry_t* geo = &desc->tlb[desc->nb_tlbs];
+	int err = ERR_NONE;
+	if ((err = geometry_set(geo, lines, ways)) != ERR_NONE) return err;
+	geo->level = level;
+	geo->serves = serves;
+	snprintf(geo->name, TLB_NAME_LEN, "L%d_%sTLB", level,
+	         serves == TLB_SERVES(INSTRUCTION) ? "I" : serves == TLB_SERVES(DATA) ? "D" : "");
+	desc->nb_tlbs++;
+	if (level > desc->nb_levels) desc->nb_levels = level; //checked again by tlb_hrchy_init()
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_init(tlb_hrchy_t * hrchy, const tlb_hrchy_desc_t * desc){
+	M_REQUIRE_NON_NULL(hrchy);
+	M_REQUIRE_NON_NULL(desc);
+	M_REQUIRE(TLB_INCLUSIVE <= desc->policy && desc->policy <= TLB_NINE, ERR_POLICY, "%d is not a valid inclusion policy", desc->policy);
+	memset(hrchy, 0, sizeof(tlb_hrchy_t));
+	hrchy->desc = *desc;
+	int err = ERR_NONE;
+	if ((err = desc_derive(&hrchy->desc)) != ERR_NONE) return err;
+	hrchy->fixed = (desc->nb_tlbs == TLB_HRCHY_FIXED.nb_tlbs);
+	for (size_t t = 0; t < hrchy->desc.nb_tlbs; t++){
+		const tlb_geometry_t* geo = &hrchy->desc.tlb[t];
+		hrchy->fixed = hrchy->fixed && geometry_equal(geo, &TLB_HRCHY_FIXED.tlb[t]);
+		size_t size = (size_t) geo->lines * geo->ways * sizeof(tlb_hrchy_entry_t);
+		hrchy->tlb[t] = calloc(1, size);
+		if (hrchy->tlb[t] == NULL){
+			tlb_hrchy_free(hrchy);
+			M_EXIT_ERR(ERR_MEM, ", cannot allocate %zu bytes for tlb %zu", size, t);
+			}
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+void tlb_hrchy_free(tlb_hrchy_t * hrchy){
+	if (hrchy == NULL) return;
+	for (size_t t = 0; t < TLB_HRCHY_MAX; t++){
+		free(hrchy->tlb[t]);
+		hrchy->tlb[t] = NULL;
+		}
+	}
+
+//=========================================================================
+int tlb_hrchy_flush(tlb_hrchy_t * hrchy){
+	M_REQUIRE_NON_NULL(hrchy);
+	for (size_t t = 0; t < hrchy->desc.nb_tlbs; t++){
+		M_REQUIRE_NON_NULL(hrchy->tlb[t]);
+		memset(hrchy->tlb[t], 0, (size_t) hrchy->desc.tlb[t].lines * hrchy->desc.tlb[t].ways * sizeof(tlb_hrchy_entry_t));
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_stats_attach(tlb_hrchy_t * hrchy, tlb_stats_t * stats){
+	M_REQUIRE_NON_NULL(hrchy);
+	hrchy->stats = stats;
+	if (stats == NULL) return ERR_NONE;
+	for (size_t t = 0; t < TLB_STATS_MAX; t++){
+		(void) tlb_stats_name(stats, t, t < hrchy->desc.nb_tlbs ? hrchy->desc.tlb[t].name : NULL);
+		}
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_timing_attach(tlb_hrchy_t * hrchy, timing_t * timing){
+	M_REQUIRE_NON_NULL(hrchy);
+	hrchy->timing = timing;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_hit(tlb_hrchy_t * hrchy, const virt_addr_t * vaddr, phy_addr_t * paddr, size_t tlb_index){
+	if (hrchy == NULL || vaddr == NULL || paddr == NULL) return MISS;
+	if (!valid_tlb_index(hrchy, tlb_index) || hrchy->tlb[tlb_index] == NULL) return MISS;
+	return hit_core(hrchy, &hrchy->desc, vaddr, paddr, tlb_index);
+	}
+
+//=========================================================================
+int tlb_hrchy_insert(tlb_hrchy_t * hrchy, uint32_t line_index, uint32_t way, const tlb_hrchy_entry_t * tlb_entry, size_t tlb_index){
+	M_REQUIRE_NON_NULL(hrchy);
+	M_REQUIRE_NON_NULL(tlb_entry);
+	M_REQUIRE(valid_tlb_index(hrchy, tlb_index), ERR_BAD_PARAMETER, "%zu is not a valid tlb index \n", tlb_index);
+	M_REQUIRE_NON_NULL(hrchy->tlb[tlb_index]);
+	const tlb_geometry_t* geo = &hrchy->desc.tlb[tlb_index];
+	M_REQUIRE(line_index < geo->lines, ERR_BAD_PARAMETER, "%"PRIx32" should be smaller than %"PRIu32, line_index, geo->lines);
+	M_REQUIRE(way < geo->ways, ERR_BAD_PARAMETER, "%"PRIx32" should be smaller than %"PRIu32, way, geo->ways);
+	tlb_hrchy_entry_t* set = hrchy_set(hrchy, &hrchy->desc, tlb_index, line_index);
+	set[way] = *tlb_entry;
+	set[way].age = (uint8_t)(geo->ways - 1);
+	set_touch(set, geo->ways, way); //the inserted entry is the most recently used one
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_entry_init(const tlb_hrchy_t * hrchy, const virt_addr_t * vaddr, const phy_addr_t * paddr,
+                         tlb_hrchy_entry_t * tlb_entry, size_t tlb_index){
+	M_REQUIRE_NON_NULL(hrchy);
+	M_REQUIRE_NON_NULL(vaddr);
+	M_REQUIRE_NON_NULL(paddr);
+	M_REQUIRE_NON_NULL(tlb_entry);
+	M_REQUIRE(valid_tlb_index(hrchy, tlb_index), ERR_BAD_PARAMETER, "%zu is not a valid tlb index \n", tlb_index);
+	tlb_entry->tag = virt_addr_t_to_virtual_page_number(vaddr) >> hrchy->desc.tlb[tlb_index].lines_bits;
+	tlb_entry->phy_page_num = paddr->phy_page_num;
+	tlb_entry->v = 1;
+	tlb_entry->age = 0;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_hrchy_search(const void * mem_space, const virt_addr_t * vaddr, phy_addr_t * paddr, mem_access_t access,
+                     tlb_hrchy_t * hrchy, int* hit_or_miss){
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(vaddr);
+	M_REQUIRE_NON_NULL(paddr);
+	M_REQUIRE_NON_NULL(hrchy);
+	M_REQUIRE_NON_NULL(hit_or_miss);
+	M_REQUIRE(access == INSTRUCTION || access == DATA, ERR_BAD_PARAMETER, "access is not a valid instance of mem_access_t %c", ' ');
+	for (size_t t = 0; t < hrchy->desc.nb_tlbs; t++) M_REQUIRE_NON_NULL(hrchy->tlb[t]);
+	M_REQUIRE(tlb_stats_access(hrchy->stats) == ERR_NONE, ERR_IO, "cannot export statistics %c", ' ');
+
+	if (hrchy->fixed) //specialised code : the table is known at compile time
+		return search_core(mem_space, vaddr, paddr, access, hrchy, &TLB_HRCHY_FIXED, hit_or_miss);
+	return search_core(mem_space, vaddr, paddr, access, hrchy, &hrchy->desc, hit_or_miss);
+	}
+
+//=========================================================================
+int tlb_hrchy_policy_stats_print(FILE * output, const tlb_hrchy_t * hrchy){
+	M_REQUIRE_NON_NULL(output);
+	M_REQUIRE_NON_NULL(hrchy);
+	static const char* const POLICY_NAMES[] = { "inclusive", "exclusive", "nine" };
+	const tlb_policy_stats_t* stats = &hrchy->policy_stats;
+	fprintf(output, "policy: %s\n", POLICY_NAMES[hrchy->desc.policy]);
+	fprintf(output, "levels: %d\n", hrchy->desc.nb_levels);
+	fprintf(output, "page walks: %"PRIu64"\n", stats->page_walks);
+	fprintf(output, "lower-level fills: %"PRIu64"\n", stats->lower_fills);
+	fprintf(output, "lower-level evictions: %"PRIu64"\n", stats->lower_evictions);
+	fprintf(output, "back-invalidations: %"PRIu64"\n", stats->back_invalidations);
+	fprintf(output, "victim fills: %"PRIu64"\n", stats->victim_fills);
+	fprintf(output, "promotions: %"PRIu64"\n", stats->promotions);
+	fprintf(output, "duplicate invalidations: %"PRIu64"\n", stats->duplicates);
+	return ERR_NONE;
+	}
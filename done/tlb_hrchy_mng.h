@@ -2,7 +2,7 @@
 
 /**
  * @file tlb_hrchy_mng.h
- * @brief TLB management functions for two-level hierarchy of TLBs
+ * @brief TLB management functions for hierarchies of TLBs
  *
  * @author Mirjana Stojilovic
  * @date 2018-19
@@ -11,6 +11,7 @@
 #include "tlb_hrchy.h"
 #include "mem_access.h"
 #include "addr.h"
+#include <stdio.h> // for FILE
 
 //=========================================================================
 /**
@@ -97,3 +98,198 @@ int tlb_search( const void * mem_space,
                 l1_dtlb_entry_t * l1_dtlb,
                 l2_tlb_entry_t * l2_tlb,
                 int* hit_or_miss);
+
+//=========================================================================
+//================= TLB hierarchy with a runtime geometry =================
+//=========================================================================
+/**
+ * @brief Initialize a descriptor to the fixed configuration of tlb_hrchy.h,
+ *        with the inclusive policy of tlb_search().
+ * @param desc the descriptor to initialize
+ * @return error code
+ */
+int tlb_hrchy_desc_default(tlb_hrchy_desc_t * desc);
+
+//=========================================================================
+/**
+ * @brief Initialize a descriptor to an empty table of TLBs, with the inclusive policy.
+ * @param desc the descriptor to initialize
+ * @return error code
+ */
+int tlb_hrchy_desc_clear(tlb_hrchy_desc_t * desc);
+
+//=========================================================================
+/**
+ * @brief Set the geometry of one TLB of a descriptor, and derive its tag width.
+ * @param desc the descriptor to modify
+ * @param tlb_index the TLB to configure (a tlb_t for the default descriptor)
+ * @param lines number of sets, must be a power of 2
+ * @param ways associativity, between 1 and TLB_HRCHY_MAX_WAYS
+ * @return error code
+ */
+int tlb_hrchy_desc_set(tlb_hrchy_desc_t * desc,
+                       size_t tlb_index,
+                       uint32_t lines,
+                       uint32_t ways);
+
+//=========================================================================
+/**
+ * @brief Append a TLB to the table of a descriptor (its index is the previous number of TLBs).
+ *
+ * For instance, a shared L3 TLB (STLB) is added to the default descriptor with
+ * tlb_hrchy_desc_add(desc, 3, TLB_SERVES_ALL, lines, ways).
+ *
+ * @param desc the descriptor to modify
+ * @param level its level, 1 being looked up first
+ * @param serves the access types it translates (TLB_SERVES mask)
+ * @param lines number of sets, must be a power of 2
+ * @param ways associativity, between 1 and TLB_HRCHY_MAX_WAYS
+ * @return error code
+ */
+int tlb_hrchy_desc_add(tlb_hrchy_desc_t * desc,
+                       uint8_t level,
+                       uint8_t serves,
+                       uint32_t lines,
+                       uint32_t ways);
+
+#define TLB_HRCHY_MAX_WAYS 255 // ages are stored on 8 bits
+
+//=========================================================================
+/**
+ * @brief Set the inclusion policy of a descriptor.
+ * @param desc the descriptor to modify
+ * @param policy the inclusion policy between the levels
+ * @return error code
+ */
+int tlb_hrchy_desc_set_policy(tlb_hrchy_desc_t * desc, tlb_inclusion_t policy);
+
+//=========================================================================
+/**
+ * @brief Check the table of a descriptor, then allocate and flush the TLBs of a hierarchy.
+ *
+ * Levels must be numbered from 1 without gap, and each level must have
+ * exactly one TLB serving each access type.
+ *
+ * @param hrchy the hierarchy to initialize
+ * @param desc its table of TLBs
+ * @return error code
+ */
+int tlb_hrchy_init(tlb_hrchy_t * hrchy, const tlb_hrchy_desc_t * desc);
+
+//=========================================================================
+/**
+ * @brief Free the TLBs of a hierarchy.
+ * @param hrchy the hierarchy to free
+ */
+void tlb_hrchy_free(tlb_hrchy_t * hrchy);
+
+//=========================================================================
+/**
+ * @brief Clean all TLBs of a hierarchy (invalidate, reset...).
+ * @param hrchy the hierarchy
+ * @return error code
+ */
+int tlb_hrchy_flush(tlb_hrchy_t * hrchy);
+
+//=========================================================================
+/**
+ * @brief Count the events of a hierarchy into statistics, the counters
+ *        being named after its TLBs (the names belong to hrchy).
+ * @param hrchy the hierarchy
+ * @param stats the statistics (indexed as the table of TLBs), NULL to not count
+ * @return error code
+ */
+int tlb_hrchy_stats_attach(tlb_hrchy_t * hrchy, tlb_stats_t * stats);
+
+//=========================================================================
+/**
+ * @brief Charge the translations of a hierarchy to a timing model : the latencies of the
+ *        levels looked up (tlb[0] for the first level of the path of the access, ...),
+ *        plus the memory references of the page walk on a miss.
+ * @param hrchy the hierarchy
+ * @param timing the timing model, NULL to not time
+ * @return error code
+ */
+int tlb_hrchy_timing_attach(tlb_hrchy_t * hrchy, timing_t * timing);
+
+//=========================================================================
+/**
+ * @brief Check if a TLB entry exists in one TLB of a hierarchy.
+ *
+ * On hit, return success (1), update the physical page number passed
+ * as the pointer to the function and mark the entry as most recently used.
+ * On miss, return miss (0).
+ *
+ * @param hrchy the hierarchy
+ * @param vaddr pointer to virtual address
+ * @param paddr (modified) pointer to physical address
+ * @param tlb_index the TLB to look into
+ * @return hit (1) or miss (0)
+ */
+int tlb_hrchy_hit(tlb_hrchy_t * hrchy,
+                  const virt_addr_t * vaddr,
+                  phy_addr_t * paddr,
+                  size_t tlb_index);
+
+//=========================================================================
+/**
+ * @brief Insert an entry into one TLB of a hierarchy.
+ * @param hrchy the hierarchy
+ * @param line_index the set where to insert
+ * @param way the way of the set to overwrite
+ * @param tlb_entry pointer to the tlb entry to insert
+ * @param tlb_index the TLB to insert into
+ * @return error code
+ */
+int tlb_hrchy_insert(tlb_hrchy_t * hrchy,
+                     uint32_t line_index,
+                     uint32_t way,
+                     const tlb_hrchy_entry_t * tlb_entry,
+                     size_t tlb_index);
+
+//=========================================================================
+/**
+ * @brief Initialize an entry for one TLB of a hierarchy.
+ * @param hrchy the hierarchy
+ * @param vaddr pointer to virtual address, to extract tlb tag
+ * @param paddr pointer to physical address, to extract physical page number
+ * @param tlb_entry pointer to the entry to be initialized
+ * @param tlb_index the TLB the entry is meant for
+ * @return error code
+ */
+int tlb_hrchy_entry_init(const tlb_hrchy_t * hrchy,
+                         const virt_addr_t * vaddr,
+                         const phy_addr_t * paddr,
+                         tlb_hrchy_entry_t * tlb_entry,
+                         size_t tlb_index);
+
+//=========================================================================
+/**
+ * @brief Ask a hierarchy of TLBs for the translation : the TLBs serving the access type
+ *        are looked up level by level and the levels above the one holding the translation
+ *        are refilled, following the inclusion policy of its descriptor
+ *        (the default descriptor with TLB_INCLUSIVE behaves as tlb_search()).
+ *
+ * @param mem_space pointer to the memory space
+ * @param vaddr pointer to virtual address
+ * @param paddr (modified) pointer to physical address (returned from TLB)
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param hrchy the hierarchy
+ * @param hit_or_miss (modified) hit (1, found in some level) or miss (0, page walk)
+ * @return error code
+ */
+int tlb_hrchy_search(const void * mem_space,
+                     const virt_addr_t * vaddr,
+                     phy_addr_t * paddr,
+                     mem_access_t access,
+                     tlb_hrchy_t * hrchy,
+                     int* hit_or_miss);
+
+//=========================================================================
+/**
+ * @brief Print the counters of the inclusion policy of a hierarchy to a stream.
+ * @param output the stream to print to
+ * @param hrchy the hierarchy
+ * @return error code
+ */
+int tlb_hrchy_policy_stats_print(FILE * output, const tlb_hrchy_t * hrchy);
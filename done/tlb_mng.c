@@ -13,6 +13,7 @@
 #include "tlb_mng.h"
 #include "page_walk.h"
 #include "list.h"
+#include "simd_util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,6 +37,30 @@ int tlb_flush(tlb_entry_t * tlb){
 	return ERR_NONE;
 }
 
+//=========================================================================
+/**
+ * @brief Initialize a tag store from the content of a TLB and its LRU list.
+ *
+ * @param tags pointer to the tag store to initialize, must be non null
+ * @param tlb pointer to the TLB, must be non null
+ * @param ll LRU list holding every line index of the TLB, must be non null
+ * @return error code
+ */
+int tlb_tags_init(tlb_tags_t * tags, const tlb_entry_t * tlb, const list_t * ll){
+	M_REQUIRE_NON_NULL(tags);
+	M_REQUIRE_NON_NULL(tlb);
+	M_REQUIRE_NON_NULL(ll);
+	memset(tags, 0, sizeof(tlb_tags_t));
+	for(size_t line = 0; line < TLB_LINES; line++){ //fold the valid bit into the tag, invalid lines keep key 0
+		if(tlb[line].v) tags->key[line] = tlb_tag_key(tlb[line].tag);
+	}
+	for_all_nodes(n, ll){ //map each line index to the node holding it
+		M_REQUIRE(n->value < TLB_LINES, ERR_BAD_PARAMETER, "Index in list has to be inferior to TLBLINES, actual value : %"PRIu32, n->value);
+		tags->node[n->value] = n;
+	}
+	return ERR_NONE;
+}
+
 //=========================================================================
 /**
  * @brief Check if a TLB entry exists in the TLB.
@@ -54,14 +79,21 @@ int tlb_hit(const virt_addr_t * vaddr, phy_addr_t * paddr,const tlb_entry_t * tl
 				}
 				//cant propagate an error with this function since it is supposed to return a uint64 anyways
 				uint64_t tag = virt_addr_t_to_virtual_page_number(vaddr); //first we extract the tag from the virt addr
+				if(replacement_policy->tags != NULL){ //compare all the tags at once instead of walking the list
+					tlb_tags_t* tags = replacement_policy->tags;
+					size_t line = simd_find_u64(tags->key, TLB_LINES, tlb_tag_key(tag));
+					if(line == TLB_LINES) return 0; //miss
+					if(init_phy_addr(paddr, tlb[line].phy_page_num << PAGE_OFFSET, vaddr->page_offset) != ERR_NONE) return 0; //a miss : the page walk reports the error
+					replacement_policy->move_back((replacement_policy->ll), tags->node[line]);
+					return 1; //hit
+				}
 				node_t* n = (replacement_policy->ll)->back; //we get the last node in the list
 				while(n != NULL){ //iterate on the full list, each time going to the previous one in order to end at the first
 					list_content_t value = n->value; //get the value corresponding to this node
 					if (!(value < TLB_LINES)) return 0; // ERR_BAD_PARAMETER : Index to set has to be inferior to TLBLINES //the value in the node corresponds to an index : must be inferior to tlblines
 					
 					if(tlb[value].tag == tag && tlb[value].v == 1){ //we got a hit
-						int err;
-						if((err = init_phy_addr(paddr, tlb[value].phy_page_num << PAGE_OFFSET, vaddr->page_offset)) != ERR_NONE) return err; //if we hit, initialize a paddr to the value found
+						if(init_phy_addr(paddr, tlb[value].phy_page_num << PAGE_OFFSET, vaddr->page_offset) != ERR_NONE) return 0; //if we hit, initialize a paddr to the value found (an error is a miss : the page walk reports it)
 						replacement_policy->move_back((replacement_policy->ll), n); //move back the node, method has no return so we cant propagate err
 						return 1; //hit
 					}
@@ -134,17 +166,30 @@ int tlb_search( const void * mem_space, const virt_addr_t * vaddr,  phy_addr_t *
 		M_REQUIRE_NON_NULL(hit_or_miss);
 		M_REQUIRE_NON_NULL((replacement_policy->ll)->front);
 		
+		tlb_stats_t* stats = replacement_policy->stats;
+		if(tlb_stats_access(stats) != ERR_NONE) return ERR_IO; //periodic export of the statistics
 		*hit_or_miss = tlb_hit(vaddr, paddr, tlb, replacement_policy); //checks if we have a hit or a miss
+		tlb_stats_count(stats, STATS_TLB, lookups);
+		if(*hit_or_miss) tlb_stats_count(stats, STATS_TLB, hits);
 		if(*hit_or_miss == 0){ //if we have a hit we dont do anything, if hit == 0 (just to be clearer than !hit), then we miss and update the tlb
 			int err;
 			if((err = page_walk(mem_space, vaddr, paddr)) != ERR_NONE) return err; //modifies paddr to be the good value corresponding to vadddr
 			list_content_t head = ((replacement_policy->ll)->front)->value; //creates the new head for the list
 			M_REQUIRE(0 <= head && head < TLB_LINES, ERR_BAD_PARAMETER, "Head should be in TLB , actual value : %zu" , head);
+			tlb_stats_count(stats, STATS_TLB, misses);
+			tlb_stats_count(stats, STATS_TLB, page_walks);
+			tlb_stats_count(stats, STATS_TLB, fills);
+			if(tlb[head].v) tlb_stats_count(stats, STATS_TLB, evictions);
 			tlb_entry_t tlb_entr; //initalizes the new entry corresponding to the paddr we just computed
 			if ((err = tlb_entry_init(vaddr,paddr, &tlb_entr))!= ERR_NONE) return err ;
 			
 			tlb_insert(head, &tlb_entr,tlb);//places the entry we initialized into the head we created
+			if(replacement_policy->tags != NULL){ //keep the tag store in sync with the line we just replaced
+				replacement_policy->tags->key[head] = tlb_tag_key(tlb_entr.tag);
+				replacement_policy->tags->node[head] = (replacement_policy->ll)->front;
+			}
 			replacement_policy->move_back(replacement_policy->ll, (replacement_policy->ll)->front); //moves back the head we created into the linked list, void method so no error propagation
 		}
+		timing_count(replacement_policy->timing, TIMING_TRANSLATION, timing_tlb_cycles(replacement_policy->timing, 1, *hit_or_miss == 0));
 		return ERR_NONE;
 		}
@@ -11,14 +11,52 @@
 #include "tlb.h"
 #include "addr.h"
 #include "list.h"
+#include "tlb_stats.h"
+#include "timing.h"
 
 
+/*
+ * Valid bit folded into the tag of a tlb_tags_t key : an invalid line has key 0,
+ * which never matches a searched key (that always has this bit set).
+ */
+#define TLB_TAG_KEY_VALID ((uint64_t)1 << VIRT_PAGE_NUM)
+#define tlb_tag_key(tag) (((uint64_t)(tag)) | TLB_TAG_KEY_VALID)
+
+/*
+ * Structure-of-arrays copy of the TLB tags, so that a lookup can compare
+ * the requested virtual page number against several tags per instruction
+ * (see simd_util.h) instead of walking the LRU list.
+ *
+ * - key  : tag of each line with the valid bit folded in (0 if the line is invalid)
+ * - node : node of the LRU list holding each line index
+ */
+typedef struct {
+	uint64_t key[TLB_LINES];
+	node_t* node[TLB_LINES];
+} tlb_tags_t;
+
 typedef struct {
 	list_t* ll;
 	node_t* (*push_back)(list_t* this, const list_content_t* value);
 	void (*move_back)(list_t* this, node_t* node);
+	tlb_tags_t* tags; // optional tag store, NULL to walk the list on each lookup
+	tlb_stats_t* stats; // optional statistics (counted as STATS_TLB), NULL to not count
+	timing_t* timing; // optional timing model (charged as TIMING_TRANSLATION), NULL to not time
 }
 replacement_policy_t;
+//=========================================================================
+/**
+ * @brief Initialize a tag store from the content of a TLB and its LRU list.
+ *
+ * Must be called again whenever the TLB is modified other than through tlb_search
+ * (e.g. after tlb_flush or tlb_insert).
+ * @param tags pointer to the tag store to initialize
+ * @param tlb pointer to the TLB
+ * @param ll LRU list holding every line index of the TLB
+ * @return error code
+ */
+int tlb_tags_init(tlb_tags_t * tags, const tlb_entry_t * tlb, const list_t * ll);
+
 //=========================================================================
 /**
  * @brief Clean a TLB (invalidate, reset...).
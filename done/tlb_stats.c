@@ -0,0 +1,83 @@
+/**
+ * @file tlb_stats.c
+ * @brief per-TLB statistics counters, exported as JSON or CSV
+ *        at the end of a run or every N accesses
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "tlb_stats.h"
+#include "error.h"
+#include <inttypes.h>
+#include <string.h>
+
+/**
+ * names of the TLBs, indexed by tlb_stats_level_t
+ */
+static const char* const TLB_STATS_NAMES[STATS_TLB_NB] = { "L1_ITLB", "L1_DTLB", "L2_TLB", "TLB" };
+
+//=========================================================================
+int tlb_stats_init(tlb_stats_t * stats, FILE * output, stats_format_t format, uint64_t period){
+	M_REQUIRE_NON_NULL(stats);
+	M_REQUIRE(format == STATS_JSON || format == STATS_CSV, ERR_BAD_PARAMETER, "%d is not a valid stats format", format);
+	M_REQUIRE(period == 0 || output != NULL, ERR_BAD_PARAMETER, "periodic exports need an output stream %c", ' ');
+	memset(stats, 0, sizeof(tlb_stats_t));
+	stats->output = output;
+	stats->format = format;
+	stats->period = period;
+	for (int t = 0; t < STATS_TLB_NB; t++) stats->names[t] = TLB_STATS_NAMES[t];
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_stats_name(tlb_stats_t * stats, size_t index, const char * name){
+	M_REQUIRE_NON_NULL(stats);
+	M_REQUIRE(index < TLB_STATS_MAX, ERR_BAD_PARAMETER, "%zu should be smaller than %d", index, TLB_STATS_MAX);
+	stats->names[index] = name;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+int tlb_stats_access(tlb_stats_t * stats){
+	if (stats == NULL) return ERR_NONE; //statistics disabled
+	int err = ERR_NONE;
+	if (stats->period != 0 && stats->accesses != 0 && stats->accesses % stats->period == 0){
+		//the accesses of the period are over : export before counting the new one
+		err = tlb_stats_export(stats->output, stats, stats->format, !stats->header_printed);
+		stats->header_printed = 1;
+		}
+	stats->accesses++;
+	return err;
+	}
+
+//=========================================================================
+int tlb_stats_export(FILE * output, const tlb_stats_t * stats, stats_format_t format, int print_header){
+	M_REQUIRE_NON_NULL(output);
+	M_REQUIRE_NON_NULL(stats);
+	switch (format){
+		case STATS_JSON :
+			fprintf(output, "{\"accesses\": %"PRIu64, stats->accesses);
+			for (int t = 0; t < TLB_STATS_MAX; t++){
+				if (stats->names[t] == NULL) continue;
+				const tlb_counters_t* c = &stats->counters[t];
+				fprintf(output, ", \"%s\": {\"lookups\": %"PRIu64", \"hits\": %"PRIu64", \"misses\": %"PRIu64
+				        ", \"fills\": %"PRIu64", \"evictions\": %"PRIu64", \"invalidations\": %"PRIu64", \"page_walks\": %"PRIu64"}",
+				        stats->names[t], c->lookups, c->hits, c->misses, c->fills, c->evictions, c->invalidations, c->page_walks);
+				}
+			fputs("}\n", output);
+			break;
+		case STATS_CSV :
+			if (print_header) fputs("accesses,tlb,lookups,hits,misses,fills,evictions,invalidations,page_walks\n", output);
+			for (int t = 0; t < TLB_STATS_MAX; t++){
+				if (stats->names[t] == NULL) continue;
+				const tlb_counters_t* c = &stats->counters[t];
+				fprintf(output, "%"PRIu64",%s,%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+				        stats->accesses, stats->names[t], c->lookups, c->hits, c->misses, c->fills, c->evictions, c->invalidations, c->page_walks);
+				}
+			break;
+		default :
+			return ERR_BAD_PARAMETER;
+		}
+	return ferror(output) ? ERR_IO : ERR_NONE;
+	}
@@ -0,0 +1,121 @@
+#pragma once
+
+/**
+ * @file tlb_stats.h
+ * @brief per-TLB statistics counters, exported as JSON or CSV
+ *        at the end of a run or every N accesses
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include <stdio.h> // for FILE
+#include <stdint.h>
+
+/*
+ * TLBs counted by default : the three TLBs of the fixed hierarchy (same order as tlb_t)
+ * and the fully-associative TLB of tlb.h. A hierarchy configured at runtime
+ * renames the counters after its own TLBs (see tlb_stats_name()).
+ */
+typedef enum {
+	STATS_L1_ITLB, STATS_L1_DTLB, STATS_L2_TLB, STATS_TLB, STATS_TLB_NB
+	} tlb_stats_level_t;
+
+#define TLB_STATS_MAX 8 // maximum number of TLBs that can be counted
+
+/*
+ * Counters of one TLB :
+ *  - lookups       : number of times the TLB was asked for a translation
+ *  - hits / misses : outcome of those lookups
+ *  - fills         : entries written into the TLB
+ *  - evictions     : valid entries replaced by a fill
+ *  - invalidations : entries invalidated by another TLB (cross-L1/back-invalidations)
+ *  - page_walks    : page walks caused by a miss of this TLB (for an L1 TLB,
+ *                    the page walks of its access type)
+ */
+typedef struct {
+	uint64_t lookups;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t fills;
+	uint64_t evictions;
+	uint64_t invalidations;
+	uint64_t page_walks;
+	} tlb_counters_t;
+
+typedef enum {
+	STATS_JSON, STATS_CSV
+	} stats_format_t;
+
+/*
+ * Statistics of a simulation :
+ *  - counters : one set of counters per TLB
+ *  - names    : name of each TLB, counters without a name are not exported
+ *  - accesses : number of translations asked to the simulator
+ *  - period   : export every period accesses to output (0 : only through tlb_stats_export())
+ *  - output   : stream of the periodic exports
+ *  - format   : format of the periodic exports
+ *  - header_printed : whether the CSV header has already been printed to output
+ */
+typedef struct {
+	tlb_counters_t counters[TLB_STATS_MAX];
+	const char* names[TLB_STATS_MAX];
+	uint64_t accesses;
+	uint64_t period;
+	FILE* output;
+	stats_format_t format;
+	int header_printed;
+	} tlb_stats_t;
+
+/**
+ * @brief increment one counter of a TLB, if statistics are enabled (stats non NULL)
+ */
+#define tlb_stats_count(stats, level, field) \
+	do { if ((stats) != NULL) ((stats)->counters[level].field)++; } while(0)
+
+//=========================================================================
+/**
+ * @brief Initialize (reset) statistics, with the default names (tlb_stats_level_t).
+ * @param stats the statistics to initialize
+ * @param output stream for periodic exports (may be NULL if period is 0)
+ * @param format format of the periodic exports
+ * @param period export every period accesses, 0 to disable periodic exports
+ * @return error code
+ */
+int tlb_stats_init(tlb_stats_t * stats, FILE * output, stats_format_t format, uint64_t period);
+
+//=========================================================================
+/**
+ * @brief Name (or rename) the counters of one TLB.
+ * @param stats the statistics
+ * @param index the index of the counters, smaller than TLB_STATS_MAX
+ * @param name its name (not copied), NULL to not export these counters
+ * @return error code
+ */
+int tlb_stats_name(tlb_stats_t * stats, size_t index, const char * name);
+
+//=========================================================================
+/**
+ * @brief Count one access (translation asked), to be called before its lookups.
+ *        If the accesses counted so far end a period, their statistics are exported first,
+ *        so that each periodic export describes completed accesses (the last period of a run
+ *        is left to tlb_stats_export()). Does nothing if stats is NULL.
+ * @param stats the statistics
+ * @return error code
+ */
+int tlb_stats_access(tlb_stats_t * stats);
+
+//=========================================================================
+/**
+ * @brief Export statistics to a stream.
+ *
+ * JSON : one object per export, on a single line ("JSON lines" for periodic exports).
+ * CSV  : one row per named TLB, preceded by a header if print_header is non zero.
+ *
+ * @param output the stream to print to
+ * @param stats the statistics
+ * @param format JSON or CSV
+ * @param print_header (CSV only) whether to print the header first
+ * @return error code
+ */
+int tlb_stats_export(FILE * output, const tlb_stats_t * stats, stats_format_t format, int print_header);
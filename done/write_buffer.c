@@ -0,0 +1,104 @@
+/**
+ * @file write_buffer.c
+ * @brief coalescing write buffer between a cache hierarchy and memory :
+ *        stores to the same line are merged before being drained to memory
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "write_buffer.h"
+#include "error.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define line_aligned(wbuf, phy_addr) ((phy_addr) & ~((wbuf)->line_bytes - 1))
+#define entry_at(wbuf, i) (&(wbuf)->entries[((wbuf)->head + (i)) % (wbuf)->size]) // i-th oldest entry
+
+//=========================================================================
+int write_buffer_init(write_buffer_t * wbuf, uint32_t size, uint32_t line_bytes){
+	M_REQUIRE_NON_NULL(wbuf);
+	M_REQUIRE(1 <= size && size <= WRITE_BUFFER_MAX_ENTRIES, ERR_SIZE, "size (%u) must be between 1 and %u", size, WRITE_BUFFER_MAX_ENTRIES);
+	M_REQUIRE(line_bytes >= sizeof(word_t) && line_bytes <= CACHE_MAX_LINE_BYTES && (line_bytes & (line_bytes - 1)) == 0,
+	          ERR_SIZE, "line size (%u) must be a power of 2 between 4 and %u", line_bytes, CACHE_MAX_LINE_BYTES);
+	memset(wbuf, 0, sizeof(write_buffer_t));
+	wbuf->entries = calloc(size, sizeof(write_buffer_entry_t));
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(wbuf->entries, ERR_MEM);
+	wbuf->size = size;
+	wbuf->line_bytes = line_bytes;
+	return ERR_NONE;
+	}
+
+//=========================================================================
+void write_buffer_free(write_buffer_t * wbuf){
+	if (wbuf == NULL) return;
+	free(wbuf->entries);
+	wbuf->entries = NULL;
+	wbuf->size = wbuf->count = 0;
+	}
+
+/**
+ * @brief write the words of an entry to memory
+ */
+static void drain_entry(void * mem_space, write_buffer_t * wbuf, const write_buffer_entry_t * entry){
+	word_t* dest = (word_t*) mem_space + entry->line_addr / sizeof(word_t);
+	for (uint64_t mask = entry->mask; mask != 0; mask &= mask - 1){
+		int i = __builtin_ctzll(mask);
+		dest[i] = entry->words[i];
+		}
+	wbuf->counters.drains++;
+	}
+
+/**
+ * @brief find the entry of a line, NULL if it is not in the buffer
+ */
+static write_buffer_entry_t* find_entry(const write_buffer_t * wbuf, uint32_t line_addr){
+	for (uint32_t i = 0; i < wbuf->count; i++){
+		write_buffer_entry_t* entry = entry_at(wbuf, i);
+		if (entry->line_addr == line_addr) return entry;
+		}
+	return NULL;
+	}
+
+//=========================================================================
+void write_buffer_store(void * mem_space, write_buffer_t * wbuf, uint32_t phy_addr, const word_t * line, uint64_t mask){
+	uint32_t line_addr = line_aligned(wbuf, phy_addr);
+	wbuf->counters.stores++;
+	write_buffer_entry_t* entry = find_entry(wbuf, line_addr);
+	if (entry != NULL) wbuf->counters.merges++;
+	else {
+		if (wbuf->count == wbuf->size){ // full : drain the oldest entry
+			drain_entry(mem_space, wbuf, entry_at(wbuf, 0));
+			wbuf->head = (wbuf->head + 1) % wbuf->size;
+			wbuf->count--;
+			}
+		entry = entry_at(wbuf, wbuf->count);
+		wbuf->count++;
+		entry->line_addr = line_addr;
+		entry->mask = 0;
+		}
+	for (uint64_t m = mask; m != 0; m &= m - 1){ // the most recent words win
+		int i = __builtin_ctzll(m);
+		entry->words[i] = line[i];
+		}
+	entry->mask |= mask;
+	}
+
+//=========================================================================
+void write_buffer_forward(const write_buffer_t * wbuf, uint32_t phy_addr, word_t * line){
+	const write_buffer_entry_t* entry = find_entry(wbuf, line_aligned(wbuf, phy_addr));
+	if (entry == NULL) return;
+	for (uint64_t mask = entry->mask; mask != 0; mask &= mask - 1){
+		int i = __builtin_ctzll(mask);
+		line[i] = entry->words[i];
+		}
+	}
+
+//=========================================================================
+int write_buffer_drain(void * mem_space, write_buffer_t * wbuf){
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(wbuf);
+	for (uint32_t i = 0; i < wbuf->count; i++) drain_entry(mem_space, wbuf, entry_at(wbuf, i));
+	wbuf->count = wbuf->head = 0;
+	return ERR_NONE;
+	}
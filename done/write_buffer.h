@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * @file write_buffer.h
+ * @brief coalescing write buffer between a cache hierarchy and memory :
+ *        stores to the same line are merged before being drained to memory
+ *
+ * @author Giordanno Lucas
+ * @date 2019
+ */
+
+#include "cache.h" // for word_t and CACHE_MAX_WORDS_PER_LINE
+#include <stdint.h>
+
+#define WRITE_BUFFER_MAX_ENTRIES 64u
+
+/*
+ * Entry of a write buffer : the words of one line waiting to be written to memory
+ *  - line_addr : physical address of the line (line aligned)
+ *  - mask      : bit i set if words[i] has to be written
+ *  - words     : the words of the line, only the ones in mask are meaningful
+ */
+typedef struct {
+	uint32_t line_addr;
+	uint64_t mask;
+	word_t words[CACHE_MAX_WORDS_PER_LINE];
+	} write_buffer_entry_t;
+
+/*
+ * Traffic of a write buffer :
+ *  - stores : stores received from the caches
+ *  - merges : stores merged into an entry already in the buffer (no new memory write)
+ *  - drains : entries written to memory, i.e. the memory writes actually done
+ */
+typedef struct {
+	uint64_t stores;
+	uint64_t merges;
+	uint64_t drains;
+	} write_buffer_counters_t;
+
+/*
+ * Write buffer, a FIFO of at most size lines :
+ *  - entries    : the entries, a ring starting at head with count entries
+ *  - size       : number of entries
+ *  - line_bytes : size of a line, as in the caches using the buffer
+ *  - counters   : its traffic
+ */
+typedef struct write_buffer {
+	write_buffer_entry_t* entries;
+	uint32_t size;
+	uint32_t count;
+	uint32_t head;
+	uint32_t line_bytes;
+	write_buffer_counters_t counters;
+	} write_buffer_t;
+
+//=========================================================================
+/**
+ * @brief Initialize an empty write buffer (allocates its entries).
+ * @param wbuf the write buffer to initialize
+ * @param size number of entries, between 1 and WRITE_BUFFER_MAX_ENTRIES
+ * @param line_bytes size of a line (power of 2, at most CACHE_MAX_LINE_BYTES)
+ * @return error code
+ */
+int write_buffer_init(write_buffer_t * wbuf, uint32_t size, uint32_t line_bytes);
+
+//=========================================================================
+/**
+ * @brief Free the entries of a write buffer (which must have been drained).
+ */
+void write_buffer_free(write_buffer_t * wbuf);
+
+//=========================================================================
+/**
+ * @brief Buffer a store : merged with the entry of the same line if any,
+ *        otherwise the oldest entry is drained when the buffer is full.
+ * @param mem_space pointer to the memory space
+ * @param wbuf the write buffer
+ * @param phy_addr a physical address in the line
+ * @param line the words of the line, indexed from the start of the line
+ * @param mask bit i set if line[i] has to be written
+ */
+void write_buffer_store(void * mem_space, write_buffer_t * wbuf, uint32_t phy_addr, const word_t * line, uint64_t mask);
+
+//=========================================================================
+/**
+ * @brief Forward the buffered words of a line read from memory
+ *        (the words still in the buffer are more recent than memory).
+ * @param wbuf the write buffer
+ * @param phy_addr a physical address in the line
+ * @param line (modified) the line as read from memory
+ */
+void write_buffer_forward(const write_buffer_t * wbuf, uint32_t phy_addr, word_t * line);
+
+//=========================================================================
+/**
+ * @brief Write every entry of a write buffer to memory.
+ * @param mem_space pointer to the memory space
+ * @param wbuf the write buffer
+ * @return error code
+ */
+int write_buffer_drain(void * mem_space, write_buffer_t * wbuf);